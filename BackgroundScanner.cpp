@@ -0,0 +1,87 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "BackgroundScanner.h"
+#include "DirScanner.h"
+#include <chrono>
+
+BackgroundScanner::BackgroundScanner(const QVector<Target> &targets, const QString &dstPrefix,
+                                     const QString &rarFolder, QObject *parent):
+    QObject(parent),
+    _targets(targets),
+    _dstPrefix(dstPrefix),
+    _rarFolder(rarFolder),
+    _queue(sQueueSize),
+    _stop(false),
+    _notified(false),
+    _thread()
+{}
+
+BackgroundScanner::~BackgroundScanner()
+{
+    _stop = true;
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void BackgroundScanner::start()
+{
+    _thread = std::thread(&BackgroundScanner::_run, this);
+}
+
+void BackgroundScanner::_run()
+{
+    DirScanner scanner;
+    for (int idx = 0 ; idx < _targets.size() && !_stop ; ++idx)
+    {
+        const Target &target = _targets.at(idx);
+        scanner.setDestination(target.dstPath);
+        // the filter is called before sizing so we don't walk what we skip
+        scanner.scan(target.srcFolder, [this, idx, &scanner](const PackEntry &entry){
+            if (_stop)
+                return false;
+            else if (scanner.existInDestination(_dstPrefix + entry.archiveFolderName()))
+            {
+                _push({entry, idx, true});
+                return false;
+            }
+            return entry.fi.fileName() != _rarFolder;
+        }, [this, idx](const PackEntry &entry){
+            _push({entry, idx, false});
+        });
+    }
+    if (!_stop)
+        emit finished();
+}
+
+void BackgroundScanner::_push(Scanned &&scanned)
+{
+    // full: the main thread is busy, it will drain it
+    while (!_queue.tryPush(std::move(scanned)))
+    {
+        if (_stop)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (!_notified.exchange(true))
+        emit entriesAvailable();
+}
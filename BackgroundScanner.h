@@ -0,0 +1,90 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef BACKGROUNDSCANNER_H
+#define BACKGROUNDSCANNER_H
+#include "MpmcQueue.h"
+#include "PackEntry.h"
+#include <QObject>
+#include <QVector>
+#include <atomic>
+#include <thread>
+
+//! scans the source folders on its own thread while the main one dispatches to the rar processes
+//! The entries are handed over as soon as they are sized through a lock-free queue
+//! (the DirScanner threads are the producers) and entriesAvailable is emitted once until it is drained
+class BackgroundScanner : public QObject
+{
+    Q_OBJECT
+public:
+    struct Target
+    {
+        QString srcFolder;
+        QString dstPath;   //!< where to look for the existing archives
+    };
+
+    struct Scanned
+    {
+        PackEntry entry;
+        int       target;  //!< index in the targets
+        bool      skipped; //!< already in the destination
+    };
+
+private:
+    const QVector<Target> _targets;
+    const QString         _dstPrefix; //!< prepended to the names of the destination folders
+    const QString         _rarFolder; //!< never packed
+
+    MpmcQueue<Scanned>    _queue;
+    std::atomic<bool>     _stop;
+    std::atomic<bool>     _notified;  //!< entriesAvailable emitted and not yet acknowledged
+    std::thread           _thread;
+
+public:
+    BackgroundScanner(const QVector<Target> &targets, const QString &dstPrefix, const QString &rarFolder,
+                      QObject *parent = nullptr);
+    ~BackgroundScanner() override; //!< stops and waits for the thread
+
+    BackgroundScanner(const BackgroundScanner &other) = delete;
+    BackgroundScanner & operator=(const BackgroundScanner &other) = delete;
+
+    void start();
+
+    inline void acknowledge(); //!< to call before draining so we get notified of the next entries
+    inline bool tryPop(Scanned &scanned);
+    inline const Target &target(int idx) const;
+
+signals:
+    void entriesAvailable();
+    void finished(); //!< not emitted if it is destroyed before the end
+
+private:
+    void _run();
+    void _push(Scanned &&scanned); //!< called from the DirScanner threads
+
+    static constexpr size_t sQueueSize = 1024;
+};
+
+void BackgroundScanner::acknowledge() { _notified = false; }
+bool BackgroundScanner::tryPop(Scanned &scanned) { return _queue.tryPop(scanned); }
+const BackgroundScanner::Target &BackgroundScanner::target(int idx) const { return _targets.at(idx); }
+
+#endif // BACKGROUNDSCANNER_H
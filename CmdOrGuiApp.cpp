@@ -20,27 +20,40 @@
 //========================================================================
 
 #include "CmdOrGuiApp.h"
+#ifndef __CLI_ONLY__
 #include "MainWindow.h"
 #include <QApplication>
+#else
+#include <QCoreApplication>
+#endif
 
 CmdOrGuiApp::CmdOrGuiApp(int &argc, char *argv[]):
     _app(nullptr),
+#ifndef __CLI_ONLY__
     _mode(argc > 1 ? AppMode::CMD : AppMode::HMI),
+#else
+    _mode(AppMode::CMD),
+#endif
     _hmi(nullptr)
 {
+    // in command line, no QApplication: the GUI libraries are not even initialised
     if (_mode == AppMode::CMD)
         _app =  new QCoreApplication(argc, argv);
+#ifndef __CLI_ONLY__
     else
     {
         _app = new QApplication(argc, argv);
         _hmi = new MainWindow();
     }
+#endif
 }
 
 CmdOrGuiApp::~CmdOrGuiApp()
 {
+#ifndef __CLI_ONLY__
     if (_hmi)
         delete  _hmi;
+#endif
 }
 
 void CmdOrGuiApp::checkForNewVersion()
@@ -52,7 +65,9 @@ void CmdOrGuiApp::checkForNewVersion()
 
 int CmdOrGuiApp::startHMI()
 {
+#ifndef __CLI_ONLY__
     _hmi->show();
+#endif
     return _app->exec();
 }
 
@@ -65,6 +65,7 @@ void CompressionSettings::init(ScenePacker *app)
     _ui->redundancySB->setValue(app->recoveryPct());
     _ui->lockCB->setChecked(app->lockArchive());
     _ui->levelSB->setValue(app->compressLevel());
+    _ui->autoLevelCB->setChecked(app->autoLevel());
 }
 
 QString CompressionSettings::rarPath()       const { return _ui->rarPathLE->text(); }
@@ -81,6 +82,7 @@ bool    CompressionSettings::addRecovery()   const { return _ui->redundancyCB->i
 int     CompressionSettings::recoveryPct()   const { return _ui->redundancySB->value(); }
 bool    CompressionSettings::lockArchive()   const { return _ui->lockCB->isChecked(); }
 int     CompressionSettings::compressLevel() const { return _ui->levelSB->value(); }
+bool    CompressionSettings::autoLevel()     const { return _ui->autoLevelCB->isChecked(); }
 
 #include <QFileDialog>
 void CompressionSettings::onRarPath()
@@ -121,5 +123,5 @@ void CompressionSettings::onFixedPass(bool checked)
 
 void CompressionSettings::onGenFixedPass()
 {
-    _ui->fixedPassLE->setText(_app->randomStr(_ui->passLengthSB->value()));
+    _ui->fixedPassLE->setText(_app->randomStr(_ui->passLengthSB->value(), _app->passChars()));
 }
@@ -53,6 +53,7 @@ public:
     int recoveryPct() const;
     bool lockArchive() const;
     int compressLevel() const;
+    bool autoLevel() const;
 
 public slots:
     void onRarPath();
@@ -0,0 +1,374 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "Coordinator.h"
+#include "RandomGenerator.h"
+#include <QMessageAuthenticationCode>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QHostInfo>
+
+namespace
+{
+void sendJson(QTcpSocket *socket, const QJsonObject &msg)
+{
+    socket->write(QJsonDocument(msg).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+}
+}
+
+Coordinator::Coordinator(const QByteArray &secret, QObject *parent):
+    QObject(parent),
+    _server(new QTcpServer(this)),
+    _options(), _entries(), _reissued(), _leases(),
+    _lastLeaseId(0),
+    _leaseTimer(),
+    _workerNames(),
+    _secret(secret), _nonces()
+{
+    connect(_server, &QTcpServer::newConnection, this, &Coordinator::onNewConnection);
+    _leaseTimer.setInterval(sLeaseCheckMs);
+    connect(&_leaseTimer, &QTimer::timeout, this, &Coordinator::onLeaseTimeout);
+}
+
+bool Coordinator::listen(const QHostAddress &address, quint16 port, QString &err)
+{
+    if (_server->listen(address, port))
+        return true;
+
+    err = _server->errorString();
+    return false;
+}
+
+QByteArray Coordinator::authCode(const QByteArray &secret, const QByteArray &nonce)
+{
+    return QMessageAuthenticationCode::hash(nonce, secret, QCryptographicHash::Sha256).toHex();
+}
+
+void Coordinator::serve(const PackQueue &entries, const QVariantHash &options)
+{
+    _entries = entries;
+    _options = options;
+    _leaseTimer.start();
+    _checkOver();
+}
+
+void Coordinator::onNewConnection()
+{
+    while (QTcpSocket *worker = _server->nextPendingConnection())
+    {
+        _workerNames.insert(worker, QString("%1:%2").arg(worker->peerAddress().toString()).arg(worker->peerPort()));
+        connect(worker, &QTcpSocket::readyRead,    this, &Coordinator::onWorkerReadyRead);
+        connect(worker, &QTcpSocket::disconnected, this, &Coordinator::onWorkerDisconnected);
+
+        QByteArray nonce = RandomGenerator::randomStr(sNonceSize).toLatin1();
+        _nonces.insert(worker, nonce);
+        sendJson(worker, QJsonObject{{"cmd", "challenge"}, {"nonce", QString::fromLatin1(nonce)}});
+        QTimer::singleShot(sAuthTimeoutMs, worker, [this, worker](){
+            if (_nonces.contains(worker))
+                _reject(worker, tr("no hello"));
+        });
+    }
+}
+
+void Coordinator::onWorkerReadyRead()
+{
+    QTcpSocket *worker = static_cast<QTcpSocket*>(sender());
+    if (!worker->canReadLine() && worker->bytesAvailable() > sMaxLineSize)
+    {
+        _reject(worker, tr("line too long"));
+        return;
+    }
+    while (worker->state() == QAbstractSocket::ConnectedState && worker->canReadLine())
+    {
+        QByteArray line = worker->readLine(sMaxLineSize + 1);
+        if (!line.endsWith('\n'))
+        {
+            _reject(worker, tr("line too long"));
+            return;
+        }
+
+        QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (!doc.isObject())
+        {
+            emit log(tr("invalid message from the worker %1").arg(_workerNames.value(worker)));
+            continue;
+        }
+
+        if (_nonces.contains(worker))
+        {
+            QJsonObject msg = doc.object();
+            QByteArray  auth = msg.value("auth").toString().toLatin1();
+            if (msg.value("cmd").toString() != "hello")
+                _reject(worker, tr("not authenticated"));
+            else if (auth != authCode(_secret, _nonces.value(worker)))
+                _reject(worker, tr("wrong secret"));
+            else
+            {
+                _nonces.remove(worker);
+                _handle(worker, msg);
+            }
+            continue; // the loop ends if it was rejected
+        }
+
+        // any message means the worker is alive
+        for (Lease &lease : _leases)
+        {
+            if (lease.worker == worker)
+                lease.renewed.restart();
+        }
+        _handle(worker, doc.object());
+    }
+}
+
+void Coordinator::_handle(QTcpSocket *worker, const QJsonObject &msg)
+{
+    QString cmd = msg.value("cmd").toString();
+    if (cmd == "hello")
+    {
+        QString name = QString("%1 (%2)").arg(msg.value("host").toString()).arg(_workerNames.value(worker));
+        _workerNames.insert(worker, name);
+        emit log(tr("Worker %1 connected with %2 threads").arg(name).arg(msg.value("threads").toInt()));
+        sendJson(worker, QJsonObject{{"cmd", "options"}, {"options", QJsonObject::fromVariantHash(_options)}});
+    }
+    else if (cmd == "lease")
+    {
+        if (!_entries.isEmpty())
+        {
+            Lease lease{_entries.dequeue(), worker, QElapsedTimer()};
+            lease.renewed.start();
+            int leaseId = ++_lastLeaseId;
+            _leases.insert(leaseId, lease);
+
+            const PackEntry &entry = lease.entry;
+            QString path = entry.fi.absoluteFilePath();
+            sendJson(worker, QJsonObject{
+                         {"cmd",      "entry"},
+                         {"lease",    leaseId},
+                         {"path",     path},
+                         {"isDir",    entry.isDir},
+                         {"size",     entry.size},
+                         {"nbFiles",  entry.nbFiles},
+                         {"reissued", _reissued.contains(path)}
+                     });
+        }
+        else if (!_leases.isEmpty())
+            sendJson(worker, QJsonObject{{"cmd", "wait"}});
+        else
+            sendJson(worker, QJsonObject{{"cmd", "done"}});
+    }
+    else if (cmd == "result")
+    {
+        int leaseId = msg.value("lease").toInt();
+        auto it = _leases.find(leaseId);
+        if (it == _leases.end() || it->worker != worker)
+        {
+            emit log(tr("Ignoring the result of the expired lease #%1 from %2").arg(leaseId).arg(_workerNames.value(worker)));
+            return;
+        }
+
+        QJsonObject result(msg);
+        result.insert("source", it->entry.fi.absoluteFilePath());
+        _reissued.remove(it->entry.fi.absoluteFilePath());
+        _leases.erase(it);
+        emit resultReceived(_workerNames.value(worker), result);
+        _checkOver();
+    }
+    else if (cmd != "renew")
+        emit log(tr("unknown command from the worker %1: %2").arg(_workerNames.value(worker)).arg(cmd));
+}
+
+void Coordinator::_reject(QTcpSocket *worker, const QString &reason)
+{
+    emit log(tr("Rejecting the worker %1: %2").arg(_workerNames.value(worker)).arg(reason));
+    worker->abort(); // onWorkerDisconnected re-issues its leases
+}
+
+void Coordinator::onWorkerDisconnected()
+{
+    QTcpSocket *worker = static_cast<QTcpSocket*>(sender());
+    _nonces.remove(worker);
+    for (int leaseId : _leases.keys())
+    {
+        if (_leases.value(leaseId).worker == worker)
+            _reissue(leaseId);
+    }
+    emit log(tr("Worker %1 disconnected").arg(_workerNames.value(worker)));
+    _workerNames.remove(worker);
+    worker->deleteLater();
+}
+
+void Coordinator::onLeaseTimeout()
+{
+    QSet<QTcpSocket*> deadWorkers;
+    for (int leaseId : _leases.keys())
+    {
+        const Lease &lease = _leases.value(leaseId);
+        if (lease.renewed.elapsed() > sLeaseTimeoutMs)
+        {
+            deadWorkers << lease.worker;
+            _reissue(leaseId);
+        }
+    }
+
+    // if it's only hung, it mustn't come back with results for entries given to others
+    for (QTcpSocket *worker : deadWorkers)
+        worker->abort();
+}
+
+void Coordinator::_reissue(int leaseId)
+{
+    Lease lease = _leases.take(leaseId);
+    QString path = lease.entry.fi.absoluteFilePath();
+    _reissued << path;
+    _entries.prepend(lease.entry);
+    emit leaseReissued(_workerNames.value(lease.worker), path);
+}
+
+void Coordinator::_checkOver()
+{
+    if (!isOver())
+        return;
+
+    _leaseTimer.stop();
+    for (QTcpSocket *worker : _workerNames.keys())
+    {
+        if (!_nonces.contains(worker))
+            sendJson(worker, QJsonObject{{"cmd", "done"}});
+    }
+    emit allDone();
+}
+
+
+
+CoordinatorClient::CoordinatorClient(int nbThreads, const QByteArray &secret, QObject *parent):
+    QObject(parent),
+    _socket(new QTcpSocket(this)),
+    _ready(false), _over(false),
+    _nbRequests(0),
+    _renewTimer(),
+    _nbThreads(nbThreads),
+    _secret(secret)
+{
+    connect(_socket, &QTcpSocket::readyRead,    this, &CoordinatorClient::onReadyRead);
+    connect(_socket, &QTcpSocket::disconnected, this, &CoordinatorClient::onDisconnected);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(_socket, &QAbstractSocket::errorOccurred, this, [this](){
+#else
+    connect(_socket, static_cast<void(QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error), this, [this](){
+#endif
+        if (_socket->state() != QAbstractSocket::ConnectedState)
+            _setOver(tr("connection error: %1").arg(_socket->errorString()));
+    });
+
+    _renewTimer.setInterval(sRenewMs);
+    connect(&_renewTimer, &QTimer::timeout, this, [this](){ sendJson(_socket, QJsonObject{{"cmd", "renew"}}); });
+}
+
+void CoordinatorClient::connectToCoordinator(const QString &host, quint16 port)
+{
+    _socket->connectToHost(host, port);
+}
+
+void CoordinatorClient::requestEntry()
+{
+    if (_over)
+        return;
+
+    if (_ready)
+        sendJson(_socket, QJsonObject{{"cmd", "lease"}});
+    else
+        ++_nbRequests;
+}
+
+void CoordinatorClient::onRetryRequest()
+{
+    requestEntry();
+}
+
+void CoordinatorClient::sendResult(int leaseId, bool success, const QString &dstFolder, const QString &archiveName,
+                                   const QString &password, const QStringList &crcs)
+{
+    if (_socket->state() != QAbstractSocket::ConnectedState)
+        return;
+
+    sendJson(_socket, QJsonObject{
+                 {"cmd",       "result"},
+                 {"lease",     leaseId},
+                 {"ok",        success},
+                 {"dstFolder", dstFolder},
+                 {"archive",   archiveName},
+                 {"password",  password},
+                 {"crcs",      QJsonArray::fromStringList(crcs)}
+             });
+}
+
+void CoordinatorClient::onReadyRead()
+{
+    while (_socket->canReadLine())
+    {
+        QJsonObject msg = QJsonDocument::fromJson(_socket->readLine()).object();
+        QString cmd = msg.value("cmd").toString();
+        if (cmd == "challenge")
+            sendJson(_socket, QJsonObject{{"cmd",     "hello"},
+                                          {"host",    QHostInfo::localHostName()},
+                                          {"threads", _nbThreads},
+                                          {"auth",    QString::fromLatin1(Coordinator::authCode(
+                                                          _secret, msg.value("nonce").toString().toLatin1()))}});
+        else if (cmd == "options")
+        {
+            _ready = true;
+            _renewTimer.start(); // nothing but the hello before we're authenticated
+            emit optionsReceived(msg.value("options").toObject().toVariantHash());
+            for ( ; _nbRequests > 0 ; --_nbRequests)
+                sendJson(_socket, QJsonObject{{"cmd", "lease"}});
+        }
+        else if (cmd == "entry")
+        {
+            PackEntry entry(QFileInfo(msg.value("path").toString()),
+                            msg.value("isDir").toBool(),
+                            static_cast<qint64>(msg.value("size").toDouble()),
+                            msg.value("nbFiles").toInt());
+            emit entryLeased(msg.value("lease").toInt(), entry, msg.value("reissued").toBool());
+        }
+        else if (cmd == "wait")
+            QTimer::singleShot(sWaitRetryMs, this, &CoordinatorClient::onRetryRequest);
+        else if (cmd == "done")
+            _setOver(tr("no more entries"));
+    }
+}
+
+void CoordinatorClient::onDisconnected()
+{
+    _setOver(tr("disconnected from the coordinator"));
+}
+
+void CoordinatorClient::_setOver(const QString &reason)
+{
+    if (_over)
+        return;
+
+    _over = true;
+    _renewTimer.stop();
+    emit over(reason);
+}
@@ -0,0 +1,155 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef COORDINATOR_H
+#define COORDINATOR_H
+#include "PackQueue.h"
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QVariantHash>
+#include <QHostAddress>
+class QTcpServer;
+class QTcpSocket;
+
+//! hands out the entries of a scan to remote workers over TCP (they must see the same paths, ex: NFS)
+//! protocol: one JSON object per line (of sMaxLineSize at most)
+//!   coordinator => {"cmd": "challenge", "nonce": random}               (on connection)
+//!   worker => {"cmd": "hello", "host": name, "threads": nb, "auth": hex(HMAC-SHA256(secret, nonce))}
+//!                                                                     coordinator => {"cmd": "options", "options": {...}}
+//!   worker => {"cmd": "lease"}    coordinator => {"cmd": "entry", "lease": id, "path": ..., "isDir": ..., "size": ..., "nbFiles": ..., "reissued": ...}
+//!                                             or {"cmd": "wait"} (some leases may come back) or {"cmd": "done"}
+//!   worker => {"cmd": "renew"}    (heartbeat, any message renews the leases of the worker)
+//!   worker => {"cmd": "result", "lease": id, "ok": ..., "dstFolder": ..., "archive": ..., "password": ..., "crcs": [...]}
+//! The leases of a worker are re-issued when it disconnects or stops renewing them.
+//! A worker is disconnected if its first message isn't a hello proving it knows the shared secret.
+class Coordinator : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Lease
+    {
+        PackEntry     entry;
+        QTcpSocket   *worker;
+        QElapsedTimer renewed;
+    };
+
+    QTcpServer          *_server;
+    QVariantHash         _options;   //!< job options sent to the workers
+    PackQueue            _entries;
+    QSet<QString>        _reissued;  //!< entries whose first lease expired
+    QHash<int, Lease>    _leases;
+    int                  _lastLeaseId;
+    QTimer               _leaseTimer;
+    QHash<QTcpSocket*, QString> _workerNames;
+    const QByteArray     _secret;
+    QHash<QTcpSocket*, QByteArray> _nonces; //!< challenge of the workers not authenticated yet
+
+public:
+    explicit Coordinator(const QByteArray &secret, QObject *parent = nullptr);
+    ~Coordinator() override = default;
+
+    bool listen(const QHostAddress &address, quint16 port, QString &err);
+
+    static QByteArray authCode(const QByteArray &secret, const QByteArray &nonce); //!< hex HMAC-SHA256
+
+    void serve(const PackQueue &entries, const QVariantHash &options);
+
+    inline bool isOver() const;
+
+signals:
+    void resultReceived(const QString &worker, const QJsonObject &result);
+    void leaseReissued(const QString &worker, const QString &path);
+    void log(const QString &msg);
+    void allDone();
+
+private slots:
+    void onNewConnection();
+    void onWorkerReadyRead();
+    void onWorkerDisconnected();
+    void onLeaseTimeout();
+
+private:
+    void _handle(QTcpSocket *worker, const QJsonObject &msg);
+    void _reject(QTcpSocket *worker, const QString &reason);
+    void _reissue(int leaseId);
+    void _checkOver();
+
+    static constexpr int sLeaseTimeoutMs = 60000;
+    static constexpr int sLeaseCheckMs   = 5000;
+    static constexpr int sNonceSize      = 32;
+    static constexpr int sAuthTimeoutMs  = 10000; //!< to say hello
+    static constexpr qint64 sMaxLineSize = 64 * 1024; //!< a result with the crcs of a lot of volumes fits
+};
+
+bool Coordinator::isOver() const { return _entries.isEmpty() && _leases.isEmpty(); }
+
+
+//! worker side: asks the coordinator for entries, one per idle rar process, and reports the results
+class CoordinatorClient : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTcpSocket  *_socket;
+    bool         _ready;       //!< options received
+    bool         _over;        //!< no more entries or connection lost
+    int          _nbRequests;  //!< lease requests waiting to be sent
+    QTimer       _renewTimer;
+    int          _nbThreads;
+    const QByteArray _secret;
+
+public:
+    CoordinatorClient(int nbThreads, const QByteArray &secret, QObject *parent = nullptr);
+    ~CoordinatorClient() override = default;
+
+    void connectToCoordinator(const QString &host, quint16 port);
+
+    void requestEntry();
+    void sendResult(int leaseId, bool success, const QString &dstFolder, const QString &archiveName,
+                    const QString &password, const QStringList &crcs);
+
+    inline bool isOver() const;
+
+signals:
+    void optionsReceived(const QVariantHash &options);
+    void entryLeased(int leaseId, const PackEntry &entry, bool reissued);
+    void over(const QString &reason);
+
+private slots:
+    void onReadyRead();
+    void onDisconnected();
+    void onRetryRequest();
+
+private:
+    void _setOver(const QString &reason);
+
+    static constexpr int sRenewMs      = 20000; //!< a third of the coordinator lease timeout
+    static constexpr int sWaitRetryMs  = 5000;
+};
+
+bool CoordinatorClient::isOver() const { return _over; }
+
+#endif // COORDINATOR_H
@@ -28,15 +28,20 @@ quint32 Crc32::getCRC32(const QString &filePath)
     if(!file.open(QIODevice::ReadOnly))
         return 0;
 
-    quint32 crc32 = 0xffffffff;
-    qint64 i = 0, n = 0;
+    quint32 crc32 = 0;
+    qint64 n = 0;
     while((n = file.read(crc32_buf, CRC32_BUFSIZE)) > 0)
-    {
-        for(i = 0; i < n; ++i)
-            crc32 = crc32_tab[(crc32 ^ static_cast<uchar>(crc32_buf[i])) & 0xFF] ^ (crc32 >> 8);
-    }
+        crc32 = update(crc32, crc32_buf, n);
     file.close();
 
+    return crc32;
+}
+
+quint32 Crc32::update(quint32 crc32, const char *data, qint64 size)
+{
+    crc32 ^= 0xffffffff;
+    for(qint64 i = 0; i < size; ++i)
+        crc32 = crc32_tab[(crc32 ^ static_cast<uchar>(data[i])) & 0xFF] ^ (crc32 >> 8);
     return crc32 ^ 0xffffffff;
 }
 
@@ -31,6 +31,9 @@ class Crc32 : public PureStaticClass
 public:
     static quint32 getCRC32(const QString &filePath);
 
+    //! like zlib crc32: start with 0 and give back the previous result for the next chunk
+    static quint32 update(quint32 crc32, const char *data, qint64 size);
+
 private:
     static char crc32_buf[CRC32_BUFSIZE];
     static const quint32 crc32_tab[256];
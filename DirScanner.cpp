@@ -0,0 +1,442 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "DirScanner.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <algorithm>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct LinuxDirent64
+{
+    quint64        d_ino;
+    qint64         d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[1];
+};
+
+enum class EntryType : char {Other = 0, File, Dir};
+
+//! calls fn(name, d_type) for each entry of the opened folder (except . and ..)
+template <typename Fn>
+void forEachDirEntry(int dirFd, Fn fn)
+{
+    alignas(LinuxDirent64) char buf[32768];
+    long nread;
+    while ((nread = ::syscall(SYS_getdents64, dirFd, buf, sizeof(buf))) > 0)
+    {
+        for (long pos = 0 ; pos < nread ; )
+        {
+            const LinuxDirent64 *dirent = reinterpret_cast<const LinuxDirent64 *>(buf + pos);
+            pos += dirent->d_reclen;
+
+            const char *name = dirent->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+            fn(name, dirent->d_type);
+        }
+    }
+}
+
+//! type and size of dirFd/name (symlinks are not followed)
+EntryType statEntry(int dirFd, const char *name, qint64 &size)
+{
+    mode_t mode;
+#ifdef STATX_SIZE
+    struct statx stx;
+    if (::statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE, &stx) == 0)
+    {
+        mode = stx.stx_mode;
+        size = static_cast<qint64>(stx.stx_size);
+    }
+    else
+#endif
+    {
+        struct stat st;
+        if (::fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            return EntryType::Other;
+        mode = st.st_mode;
+        size = static_cast<qint64>(st.st_size);
+    }
+
+    if (S_ISDIR(mode))
+        return EntryType::Dir;
+    else if (S_ISREG(mode))
+        return EntryType::File;
+    else
+        return EntryType::Other;
+}
+
+struct WalkTask
+{
+    int         top;     //!< index of the source entry the folder belongs to
+    std::string relPath; //!< relative to the root fd
+};
+
+//! folders still to walk, shared by the threads. It's over when it's empty and nobody is walking
+class WalkQueue
+{
+private:
+    std::mutex              _mutex;
+    std::condition_variable _cond;
+    std::vector<WalkTask>   _tasks;
+    int                     _nbBusy;
+
+public:
+    explicit WalkQueue(std::vector<WalkTask> &&tasks) : _tasks(std::move(tasks)), _nbBusy(0) {}
+
+    bool pop(WalkTask &task)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [this]{ return !_tasks.empty() || _nbBusy == 0; });
+        if (_tasks.empty())
+            return false;
+
+        task = std::move(_tasks.back());
+        _tasks.pop_back();
+        ++_nbBusy;
+        return true;
+    }
+
+    void done(std::vector<WalkTask> &subFolders)
+    {
+        size_t nbNew = subFolders.size();
+        bool   over;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (WalkTask &subFolder : subFolders)
+                _tasks.push_back(std::move(subFolder));
+            --_nbBusy;
+            over = _nbBusy == 0 && _tasks.empty();
+        }
+        subFolders.clear();
+        if (over)
+            _cond.notify_all();
+        else
+        {
+            for (size_t i = 1 ; i < nbNew ; ++i) // we'll take one ourselves
+                _cond.notify_one();
+        }
+    }
+};
+
+typedef std::function<void(int top, qint64 size, int nbFiles)> TopDone;
+
+//! recursive sizes and numbers of files of the tasks, grouped by their top index.
+//! topDone (if any) is called by the walking threads as soon as a top is fully walked
+void walk(int rootFd, std::vector<WalkTask> &&tasks, int nbTops, int nbThreads,
+          std::vector<qint64> &sizes, std::vector<int> &nbFiles, const TopDone &topDone = nullptr)
+{
+    sizes.assign(static_cast<size_t>(nbTops), 0);
+    nbFiles.assign(static_cast<size_t>(nbTops), 0);
+    if (tasks.empty())
+        return;
+
+    // folders of each top still to walk (or being walked)
+    std::vector<std::atomic<int>> nbPending(topDone ? static_cast<size_t>(nbTops) : 0);
+    if (topDone)
+    {
+        for (const WalkTask &task : tasks)
+            ++nbPending[static_cast<size_t>(task.top)];
+    }
+
+    nbThreads = std::max(1, std::min(nbThreads, 64));
+    WalkQueue queue(std::move(tasks));
+
+    // each thread has its own totals: no contention, we sum them at the end
+    std::vector<std::vector<qint64>> threadSizes(static_cast<size_t>(nbThreads), sizes);
+    std::vector<std::vector<int>>    threadFiles(static_cast<size_t>(nbThreads), nbFiles);
+    auto reportTop = [&](int top){
+        // the other threads are done with it: their writes happened before their decrement
+        qint64 size  = 0;
+        int    files = 0;
+        for (int i = 0 ; i < nbThreads ; ++i)
+        {
+            size  += threadSizes[static_cast<size_t>(i)][static_cast<size_t>(top)];
+            files += threadFiles[static_cast<size_t>(i)][static_cast<size_t>(top)];
+        }
+        topDone(top, size, files);
+    };
+    auto worker = [&](int idx){
+        std::vector<qint64>  &mySizes = threadSizes[static_cast<size_t>(idx)];
+        std::vector<int>     &myFiles = threadFiles[static_cast<size_t>(idx)];
+        std::vector<WalkTask> subFolders;
+        WalkTask task;
+        while (queue.pop(task))
+        {
+            int dirFd = ::openat(rootFd, task.relPath.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (dirFd != -1)
+            {
+                forEachDirEntry(dirFd, [&](const char *name, unsigned char dType){
+                    qint64 size = 0;
+                    EntryType type = EntryType::Other;
+                    if (dType == DT_DIR)
+                        type = EntryType::Dir;
+                    else if (dType == DT_REG || dType == DT_UNKNOWN)
+                        type = statEntry(dirFd, name, size);
+
+                    if (type == EntryType::Dir)
+                        subFolders.push_back({task.top, task.relPath + '/' + name});
+                    else if (type == EntryType::File)
+                    {
+                        mySizes[static_cast<size_t>(task.top)] += size;
+                        ++myFiles[static_cast<size_t>(task.top)];
+                    }
+                });
+                ::close(dirFd);
+            }
+            int top = task.top;
+            if (topDone)
+                nbPending[static_cast<size_t>(top)] += static_cast<int>(subFolders.size());
+            queue.done(subFolders);
+            if (topDone && nbPending[static_cast<size_t>(top)].fetch_sub(1) == 1)
+                reportTop(top);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1 ; i < nbThreads ; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for (std::thread &thread : threads)
+        thread.join();
+
+    for (int i = 0 ; i < nbThreads ; ++i)
+    {
+        for (size_t top = 0 ; top < sizes.size() ; ++top)
+        {
+            sizes[top]   += threadSizes[static_cast<size_t>(i)][top];
+            nbFiles[top] += threadFiles[static_cast<size_t>(i)][top];
+        }
+    }
+}
+
+} // namespace
+#endif
+
+
+DirScanner::DirScanner(int nbThreads):
+    _nbThreads(std::max(1, nbThreads)),
+    _dstFd(-1),
+    _dstPath()
+{}
+
+DirScanner::~DirScanner()
+{
+#if defined(Q_OS_LINUX)
+    if (_dstFd != -1)
+        ::close(_dstFd);
+#endif
+}
+
+QVector<PackEntry> DirScanner::scan(const QString &srcFolder, const EntryFilter &accept) const
+{
+    QVector<PackEntry> entries;
+    QDir srcDir(srcFolder);
+
+#if defined(Q_OS_LINUX)
+    int rootFd = ::open(QFile::encodeName(srcFolder).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (rootFd == -1)
+        return entries;
+
+    std::vector<WalkTask> tasks;
+    forEachDirEntry(rootFd, [&](const char *name, unsigned char dType){
+        if (dType == DT_LNK)
+            return;
+
+        qint64 size = 0;
+        EntryType type = statEntry(rootFd, name, size);
+        if (type == EntryType::Other || ::faccessat(rootFd, name, R_OK, 0) != 0)
+            return;
+
+        bool isDir = type == EntryType::Dir;
+        PackEntry entry(QFileInfo(srcDir.filePath(QFile::decodeName(name))), isDir, isDir ? 0 : size, isDir ? 0 : 1);
+        if (accept && !accept(entry))
+            return;
+
+        if (isDir)
+            tasks.push_back({entries.size(), name});
+        entries << entry;
+    });
+
+    std::vector<qint64> sizes;
+    std::vector<int>    nbFiles;
+    walk(rootFd, std::move(tasks), entries.size(), _nbThreads, sizes, nbFiles);
+    ::close(rootFd);
+
+    for (int i = 0 ; i < entries.size() ; ++i)
+    {
+        PackEntry &entry = entries[i];
+        if (entry.isDir)
+        {
+            entry.size    = sizes[static_cast<size_t>(i)];
+            entry.nbFiles = nbFiles[static_cast<size_t>(i)];
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const PackEntry &a, const PackEntry &b){
+        if (a.isDir != b.isDir)
+            return a.isDir;
+        return a.fi.fileName() < b.fi.fileName();
+    });
+#else
+    for (const QFileInfo &fi : srcDir.entryInfoList(
+             QDir::Dirs|QDir::Files|QDir::Readable|QDir::Hidden|QDir::NoDotAndDotDot|QDir::NoSymLinks,
+             QDir::Name|QDir::DirsFirst))
+    {
+        PackEntry entry(fi, fi.isDir(), fi.isDir() ? 0 : fi.size(), fi.isDir() ? 0 : 1);
+        if (accept && !accept(entry))
+            continue;
+
+        if (entry.isDir)
+            entry.size = folderSize(fi.absoluteFilePath(), &entry.nbFiles);
+        entries << entry;
+    }
+#endif
+
+    return entries;
+}
+
+void DirScanner::scan(const QString &srcFolder, const EntryFilter &accept, const EntrySized &sized) const
+{
+#if defined(Q_OS_LINUX)
+    int rootFd = ::open(QFile::encodeName(srcFolder).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (rootFd == -1)
+        return;
+
+    QDir srcDir(srcFolder);
+    QVector<PackEntry>    folders;
+    std::vector<WalkTask> tasks;
+    forEachDirEntry(rootFd, [&](const char *name, unsigned char dType){
+        if (dType == DT_LNK)
+            return;
+
+        qint64 size = 0;
+        EntryType type = statEntry(rootFd, name, size);
+        if (type == EntryType::Other || ::faccessat(rootFd, name, R_OK, 0) != 0)
+            return;
+
+        bool isDir = type == EntryType::Dir;
+        PackEntry entry(QFileInfo(srcDir.filePath(QFile::decodeName(name))), isDir, isDir ? 0 : size, isDir ? 0 : 1);
+        if (accept && !accept(entry))
+            return;
+
+        if (isDir)
+        {
+            tasks.push_back({folders.size(), name});
+            folders << entry;
+        }
+        else
+            sized(entry); // nothing more to know
+    });
+
+    std::vector<qint64> sizes;
+    std::vector<int>    nbFiles;
+    walk(rootFd, std::move(tasks), folders.size(), _nbThreads, sizes, nbFiles, [&folders, &sized](int top, qint64 size, int files){
+        PackEntry entry(folders.at(top)); // folders is not modified during the walk
+        entry.size    = size;
+        entry.nbFiles = files;
+        sized(entry);
+    });
+    ::close(rootFd);
+#else
+    for (const PackEntry &entry : scan(srcFolder, accept))
+        sized(entry);
+#endif
+}
+
+bool DirScanner::setDestination(const QString &dstPath)
+{
+    if (dstPath == _dstPath)
+        return true;
+
+    _dstPath = dstPath;
+#if defined(Q_OS_LINUX)
+    if (_dstFd != -1)
+        ::close(_dstFd);
+    _dstFd = ::open(QFile::encodeName(dstPath).constData(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    return _dstFd != -1;
+#else
+    return QFileInfo(dstPath).isDir();
+#endif
+}
+
+bool DirScanner::existInDestination(const QString &name) const
+{
+#if defined(Q_OS_LINUX)
+    struct stat st;
+    return _dstFd != -1 && ::fstatat(_dstFd, QFile::encodeName(name).constData(), &st, 0) == 0;
+#else
+    return QFileInfo(QString("%1/%2").arg(_dstPath).arg(name)).exists();
+#endif
+}
+
+qint64 DirScanner::folderSize(const QString &path, int *nbFiles)
+{
+#if defined(Q_OS_LINUX)
+    int rootFd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (rootFd == -1)
+    {
+        if (nbFiles)
+            *nbFiles = 0;
+        return 0;
+    }
+
+    std::vector<qint64> sizes;
+    std::vector<int>    files;
+    walk(rootFd, {{0, "."}}, 1, 1, sizes, files);
+    ::close(rootFd);
+
+    if (nbFiles)
+        *nbFiles = files.front();
+    return sizes.front();
+#else
+    qint64 size = 0;
+    if (nbFiles)
+        *nbFiles = 0;
+    QDirIterator it(path, QDir::Files|QDir::Hidden|QDir::NoSymLinks, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        size += it.fileInfo().size();
+        if (nbFiles)
+            ++(*nbFiles);
+    }
+    return size;
+#endif
+}
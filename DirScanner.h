@@ -0,0 +1,62 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef DIRSCANNER_H
+#define DIRSCANNER_H
+#include "PackEntry.h"
+#include <QVector>
+#include <QThread>
+#include <functional>
+
+//! lists the entries of a source folder and sizes them (total size and number of files)
+//! On Linux, it is done in one pass with openat/getdents64/statx on a pool of threads
+//! and the destination folder is kept open to check the existing archives with fstatat
+class DirScanner
+{
+public:
+    typedef std::function<bool(const PackEntry &entry)> EntryFilter; //!< called before sizing an entry
+    typedef std::function<void(const PackEntry &entry)> EntrySized;  //!< can be called from several threads at once
+
+private:
+    const int _nbThreads;
+    int       _dstFd;   //!< Linux only
+    QString   _dstPath;
+
+public:
+    explicit DirScanner(int nbThreads = QThread::idealThreadCount());
+    ~DirScanner();
+
+    DirScanner(const DirScanner &other) = delete;
+    DirScanner & operator=(const DirScanner &other) = delete;
+
+    //! readable files and folders (no symlinks) of srcFolder, folders first then sorted by name
+    QVector<PackEntry> scan(const QString &srcFolder, const EntryFilter &accept = nullptr) const;
+
+    //! same but streamed: each entry is given as soon as it is sized (in no particular order)
+    void scan(const QString &srcFolder, const EntryFilter &accept, const EntrySized &sized) const;
+
+    bool setDestination(const QString &dstPath);
+    bool existInDestination(const QString &name) const;
+
+    static qint64 folderSize(const QString &path, int *nbFiles = nullptr);
+};
+
+#endif // DIRSCANNER_H
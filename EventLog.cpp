@@ -0,0 +1,102 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "EventLog.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#if defined(Q_OS_UNIX)
+#include <csignal>
+#endif
+
+EventLog::EventLog(QObject *parent):
+    QObject(parent), _file(), _buffer(), _flushTimer()
+{
+    _buffer.reserve(sMaxBufferSize);
+    _flushTimer.setSingleShot(true);
+    _flushTimer.setInterval(sFlushMs);
+    connect(&_flushTimer, &QTimer::timeout, this, &EventLog::flush);
+}
+
+EventLog::~EventLog()
+{
+    flush();
+}
+
+bool EventLog::open(const QString &target, QString &err)
+{
+    bool opened = false;
+    if (target.startsWith("fd:"))
+    {
+        bool ok = false;
+        int  fd = target.mid(3).toInt(&ok);
+        if (!ok || fd < 0)
+        {
+            err = tr("invalid file descriptor: %1").arg(target);
+            return false;
+        }
+        opened = _file.open(fd, QIODevice::WriteOnly|QIODevice::Unbuffered, QFileDevice::DontCloseHandle);
+    }
+    else
+    {
+        _file.setFileName(target);
+        opened = _file.open(QIODevice::WriteOnly|QIODevice::Append|QIODevice::Unbuffered);
+    }
+    if (!opened)
+    {
+        err = _file.errorString();
+        return false;
+    }
+
+#if defined(Q_OS_UNIX)
+    // a supervisor going away shouldn't kill the run (the writes fail instead)
+    // the children of ExtProcess get back the default action
+    ::signal(SIGPIPE, SIG_IGN);
+#endif
+    return true;
+}
+
+void EventLog::write(const char *event, QJsonObject fields)
+{
+    if (!_file.isOpen())
+        return;
+
+    fields.insert("event", event);
+    fields.insert("ts",    QDateTime::currentMSecsSinceEpoch());
+    _buffer.append(QJsonDocument(fields).toJson(QJsonDocument::Compact));
+    _buffer.append('\n');
+
+    if (_buffer.size() >= sMaxBufferSize)
+        flush();
+    else if (!_flushTimer.isActive())
+        _flushTimer.start();
+}
+
+void EventLog::flush()
+{
+    _flushTimer.stop();
+    if (_buffer.isEmpty() || !_file.isOpen())
+        return;
+
+    if (_file.write(_buffer) != _buffer.size())
+        _file.close(); // reader gone: no more events rather than blocking or failing on each of them
+    _buffer.resize(0); // keeps its capacity
+}
@@ -0,0 +1,65 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QJsonObject>
+#include <QTimer>
+
+//! machine readable events of the runs: one compact JSON object per line with its "event" and "ts" (ms since epoch)
+//! They're buffered and written by chunks (when the buffer is full or sFlushMs after the first pending one)
+//! so a supervisor can follow a big run on a file, a fifo or an inherited fd without slowing it down
+class EventLog : public QObject
+{
+    Q_OBJECT
+private:
+    QFile      _file;
+    QByteArray _buffer;
+    QTimer     _flushTimer;
+
+public:
+    explicit EventLog(QObject *parent = nullptr);
+    ~EventLog() override; //!< flushes
+
+    EventLog(const EventLog &other) = delete;
+    EventLog & operator=(const EventLog &other) = delete;
+
+    //! target: path of a file (appended) or fd:N for an already open descriptor
+    bool open(const QString &target, QString &err);
+    inline bool isOpen() const;
+
+    void write(const char *event, QJsonObject fields = QJsonObject());
+
+public slots:
+    void flush();
+
+private:
+    static constexpr int sFlushMs       = 200;
+    static constexpr int sMaxBufferSize = 64 * 1024;
+};
+
+bool EventLog::isOpen() const { return _file.isOpen(); }
+
+#endif // EVENTLOG_H
@@ -0,0 +1,396 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ExtProcess.h"
+#include <QFileInfo>
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <csignal>
+#endif
+#if defined(Q_OS_LINUX)
+#include <sys/syscall.h>
+#endif
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+qint64 ExtProcess::sReapedCpuMs = -1;
+
+ExtProcess::ExtProcess(QObject *parent):
+    QProcess(parent),
+    _setNice(false), _nice(0),
+    _ioClass(IoClass::Default), _ioLevel(4),
+    _cpus(), _cgroupProcs(),
+    _numaNode(nullptr),
+    _spawnTimer(), _spawnMs(-1),
+    _runTimer(), _pauseTimer(), _pausedMs(0), _wallMs(0), _cpuMs(-1),
+    _inProcess(false), _held(false)
+{
+    // direct connections made before the ones of the users: the measures are ready for them
+    connect(this, &QProcess::stateChanged, this, &ExtProcess::_onStateChanged);
+    connect(this, &QProcess::started, this, &ExtProcess::_onStarted);
+    connect(this, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &ExtProcess::_onFinished);
+
+#if defined(Q_OS_LINUX)
+    CPU_ZERO(&_cpuSet);
+    NumaTopology::nodeMask(-1, _nodeMask);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0) && defined(Q_OS_UNIX)
+    setChildProcessModifier([this](){ _applyInChild(); });
+#endif
+}
+
+void ExtProcess::_onStateChanged(QProcess::ProcessState newState)
+{
+    if (newState == Starting)
+    {
+        _spawnTimer.start();
+        _spawnMs = -1;
+    }
+}
+
+void ExtProcess::_onStarted()
+{
+    _spawnMs = _spawnTimer.isValid() ? _spawnTimer.elapsed() : -1;
+    _runTimer.start();
+    _pauseTimer.invalidate();
+    _pausedMs = 0;
+    _wallMs   = 0;
+    _cpuMs    = -1;
+#if defined(Q_OS_UNIX)
+    if (sReapedCpuMs < 0)
+    {
+        struct rusage usage;
+        if (::getrusage(RUSAGE_CHILDREN, &usage) == 0)
+            sReapedCpuMs = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+                    + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+    }
+#endif
+}
+
+void ExtProcess::_onFinished()
+{
+    if (_pauseTimer.isValid()) // killed while stopped
+    {
+        _pausedMs += _pauseTimer.elapsed();
+        _pauseTimer.invalidate();
+    }
+    _wallMs = _runTimer.isValid() ? _runTimer.elapsed() - _pausedMs : 0;
+#if defined(Q_OS_UNIX)
+    // the usage of a child is only known in the total of the reaped ones and QProcess reaps it before
+    // (in the SIGCHLD handler of forkfd with Qt5), so other children may have been reaped since:
+    // what the total gained since the previous finished is taken as ours. It's exact when the processes
+    // end one at a time, else the cpu time of the ones ending together (rar, par2, verifications)
+    // is mixed up between them, their sum staying right.
+    struct rusage usage;
+    if (sReapedCpuMs >= 0 && ::getrusage(RUSAGE_CHILDREN, &usage) == 0)
+    {
+        qint64 reapedCpuMs = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+                + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+        _cpuMs       = reapedCpuMs - sReapedCpuMs;
+        sReapedCpuMs = reapedCpuMs;
+    }
+#endif
+}
+
+bool ExtProcess::pause()
+{
+    if (_inProcess)
+    {
+        if (_pauseTimer.isValid())
+            return false;
+        _held = true;
+        _pauseTimer.start();
+        return true;
+    }
+#if defined(Q_OS_UNIX)
+    if (state() != Running || _pauseTimer.isValid() || ::kill(static_cast<pid_t>(processId()), SIGSTOP) != 0)
+        return false;
+
+    _pauseTimer.start();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ExtProcess::resume()
+{
+    if (_inProcess)
+    {
+        if (!_pauseTimer.isValid())
+            return false;
+        _pauseTimer.invalidate();
+        _held = false;
+        return true;
+    }
+#if defined(Q_OS_UNIX)
+    if (!_pauseTimer.isValid())
+        return false;
+
+    _pausedMs += _pauseTimer.elapsed();
+    _pauseTimer.invalidate();
+    return state() == Running && ::kill(static_cast<pid_t>(processId()), SIGCONT) == 0;
+#else
+    return false;
+#endif
+}
+
+void ExtProcess::setInProcess(bool inProcess)
+{
+    _inProcess = inProcess;
+    _pauseTimer.invalidate();
+    _held = false;
+}
+
+void ExtProcess::setNice(int nice)
+{
+    _setNice = true;
+    _nice    = nice;
+
+#if defined(Q_OS_WIN)
+    // no nice on Windows, we map it on the priority classes
+    DWORD priorityClass = 0;
+    if (nice >= 10)
+        priorityClass = IDLE_PRIORITY_CLASS;
+    else if (nice > 0)
+        priorityClass = BELOW_NORMAL_PRIORITY_CLASS;
+    setCreateProcessArgumentsModifier([priorityClass](QProcess::CreateProcessArguments *args){
+        args->flags |= priorityClass;
+    });
+#endif
+}
+
+void ExtProcess::setIoPriority(IoClass ioClass, int level)
+{
+    _ioClass = ioClass;
+    _ioLevel = std::max(0, std::min(level, 7));
+}
+
+void ExtProcess::setCpuAffinity(const QVector<int> &cpus)
+{
+    _cpus = cpus;
+#if defined(Q_OS_LINUX)
+    CPU_ZERO(&_cpuSet);
+    for (int cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &_cpuSet);
+    }
+#endif
+}
+
+bool ExtProcess::setCGroup(const QString &cgroupPath)
+{
+    if (cgroupPath.isEmpty())
+    {
+        _cgroupProcs.clear();
+        return true;
+    }
+
+    QFileInfo fi(QString("%1/cgroup.procs").arg(cgroupPath));
+    if (!fi.exists() || !fi.isWritable())
+        return false;
+
+    _cgroupProcs = QFile::encodeName(fi.absoluteFilePath());
+    return true;
+}
+
+void ExtProcess::setNumaNode(const NumaNode *node)
+{
+    _numaNode = node;
+    if (!node)
+        return;
+
+#if defined(Q_OS_LINUX)
+    NumaTopology::nodeMask(node->id, _nodeMask);
+#endif
+
+    // restrict the user affinity to the node (they intersect cf NumaTopology::nodesWithCpus)
+    QVector<int> cpus;
+    for (int cpu : node->cpus)
+    {
+        if (_cpus.isEmpty() || _cpus.contains(cpu))
+            cpus << cpu;
+    }
+    setCpuAffinity(cpus);
+}
+
+qint64 ExtProcess::writtenBytes() const
+{
+#if defined(Q_OS_LINUX)
+    // a few lines from the kernel: cheap enough for the event loop, unlike walking the destination
+    if (state() != Running)
+        return -1;
+    QFile io(QString("/proc/%1/io").arg(processId()));
+    if (!io.open(QIODevice::ReadOnly))
+        return -1;
+    for (const QByteArray &line : io.readAll().split('\n'))
+    {
+        if (line.startsWith("wchar:"))
+        {
+            bool ok = false;
+            qint64 bytes = line.mid(6).trimmed().toLongLong(&ok);
+            return ok ? bytes : -1;
+        }
+    }
+#endif
+    return -1;
+}
+
+QString ExtProcess::schedulingStr() const
+{
+    QStringList sched;
+    if (_setNice)
+        sched << QString("nice: %1").arg(_nice);
+    if (_ioClass == IoClass::Idle)
+        sched << "io: idle";
+    else if (_ioClass == IoClass::BestEffort)
+        sched << QString("io: be:%1").arg(_ioLevel);
+    else if (_ioClass == IoClass::RealTime)
+        sched << QString("io: rt:%1").arg(_ioLevel);
+    if (!_cpus.isEmpty())
+    {
+        QStringList cpus;
+        for (int cpu : _cpus)
+            cpus << QString::number(cpu);
+        sched << QString("cpus: %1").arg(cpus.join(","));
+    }
+    if (_numaNode)
+        sched << QString("numa node: %1").arg(_numaNode->id);
+    if (!_cgroupProcs.isEmpty())
+        sched << QString("cgroup: %1").arg(QFileInfo(QFile::decodeName(_cgroupProcs)).absolutePath());
+    return sched.join(", ");
+}
+
+QVector<int> ExtProcess::parseCpuList(const QString &cpuList, bool *ok)
+{
+    QVector<int> cpus;
+    if (ok)
+        *ok = true;
+
+    for (const QString &range : cpuList.split(",", Qt::SkipEmptyParts))
+    {
+        bool okFirst = false, okLast = false;
+        int first, last;
+        int sep = range.indexOf('-');
+        if (sep == -1)
+        {
+            first = last = range.trimmed().toInt(&okFirst);
+            okLast = okFirst;
+        }
+        else
+        {
+            first = range.left(sep).trimmed().toInt(&okFirst);
+            last  = range.mid(sep + 1).trimmed().toInt(&okLast);
+        }
+
+        if (!okFirst || !okLast || first < 0 || last < first)
+        {
+            if (ok)
+                *ok = false;
+            return QVector<int>();
+        }
+        for (int cpu = first ; cpu <= last ; ++cpu)
+            cpus << cpu;
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+bool ExtProcess::parseIoClass(const QString &str, IoClass &ioClass, int &level)
+{
+    QStringList parts = str.toLower().split(":");
+    const QString &name = parts.first();
+    if (name == "idle")
+        ioClass = IoClass::Idle;
+    else if (name == "be")
+        ioClass = IoClass::BestEffort;
+    else if (name == "rt")
+        ioClass = IoClass::RealTime;
+    else if (name == "none" || name.isEmpty())
+        ioClass = IoClass::Default;
+    else
+        return false;
+
+    level = 4;
+    if (parts.size() > 1)
+    {
+        bool ok = false;
+        level = parts.at(1).toInt(&ok);
+        if (!ok || level < 0 || level > 7)
+            return false;
+    }
+    return true;
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0) && defined(Q_OS_UNIX)
+void ExtProcess::setupChildProcess()
+{
+    _applyInChild();
+}
+#endif
+
+void ExtProcess::_applyInChild()
+{
+#if defined(Q_OS_UNIX)
+    // we're between the fork and the exec: no allocation, no Qt, errors are silently ignored
+    ::signal(SIGPIPE, SIG_DFL); // an ignored signal survives the exec (cf EventLog::open)
+
+    if (!_cgroupProcs.isEmpty())
+    {
+        int fd = ::open(_cgroupProcs.constData(), O_WRONLY | O_CLOEXEC);
+        if (fd != -1)
+        {
+            ssize_t res = ::write(fd, "0", 1); // "0" moves the writer
+            Q_UNUSED(res)
+            ::close(fd);
+        }
+    }
+
+    if (_setNice)
+        ::setpriority(PRIO_PROCESS, 0, _nice);
+
+#if defined(Q_OS_LINUX)
+    if (_ioClass != IoClass::Default)
+    {
+        int ioprio = (static_cast<int>(_ioClass) << 13) | (_ioClass == IoClass::Idle ? 0 : _ioLevel);
+        ::syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0, ioprio);
+    }
+
+    if (!_cpus.isEmpty())
+        ::sched_setaffinity(0, sizeof(cpu_set_t), &_cpuSet);
+
+    // preferred rather than bind so a full node spills over instead of OOM killing rar
+    if (_numaNode)
+        ::syscall(SYS_set_mempolicy, SP_MPOL_PREFERRED, _nodeMask, NUMA_MAX_NODES);
+#endif
+#endif
+}
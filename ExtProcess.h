@@ -0,0 +1,136 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef EXTPROCESS_H
+#define EXTPROCESS_H
+
+#include "NumaTopology.h"
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QVector>
+#include <atomic>
+#if defined(Q_OS_LINUX)
+#include <sched.h>
+#endif
+
+//! QProcess that applies its scheduling settings (nice, io priority, cpu affinity, cgroup, NUMA node)
+//! inside the child between the fork and the exec, so rar never runs a single instruction unconstrained
+class ExtProcess : public QProcess
+{
+    Q_OBJECT
+public:
+    enum class IoClass : char {Default = 0, RealTime = 1, BestEffort = 2, Idle = 3}; //!< same values than the kernel IOPRIO_CLASS_*
+
+private:
+    bool        _setNice;
+    int         _nice;
+    IoClass     _ioClass;
+    int         _ioLevel;     //!< 0 (highest) to 7 (lowest) for RealTime and BestEffort
+    QVector<int> _cpus;
+    QByteArray  _cgroupProcs; //!< path of the cgroup.procs file (prepared in the parent, used in the child)
+    const NumaNode *_numaNode; //!< points into NumaTopology::nodes()
+
+    QElapsedTimer _spawnTimer; //!< from start() to started()
+    qint64      _spawnMs;     //!< of the last run, -1 if unknown
+    QElapsedTimer _runTimer;
+    QElapsedTimer _pauseTimer; //!< valid while stopped
+    qint64      _pausedMs;    //!< of the current run
+    qint64      _wallMs;      //!< of the last run (without the pauses)
+    qint64      _cpuMs;       //!< of the last run (user + system), approximation cf _onFinished, -1 if unknown
+    bool        _inProcess;   //!< its work runs in a thread of ours instead of a child
+    std::atomic<bool> _held;  //!< pause of the in-process work (checked between its chunks)
+
+    static qint64 sReapedCpuMs; //!< cpu time of the children reaped so far (RUSAGE_CHILDREN)
+
+#if defined(Q_OS_LINUX)
+    cpu_set_t   _cpuSet;
+    NumaTopology::NodeMask _nodeMask;
+#endif
+
+public:
+    explicit ExtProcess(QObject *parent = nullptr);
+    ~ExtProcess() override = default;
+
+    void setNice(int nice);
+    void setIoPriority(IoClass ioClass, int level = 4);
+    void setCpuAffinity(const QVector<int> &cpus);
+    bool setCGroup(const QString &cgroupPath);
+    void setNumaNode(const NumaNode *node); //!< after setCpuAffinity, on a node having some of those cpus
+
+    inline const NumaNode *numaNode() const;
+
+    bool pause();  //!< SIGSTOP (Unix only) or hold of the in-process work
+    bool resume(); //!< SIGCONT
+    inline bool isPaused() const;
+
+    void setInProcess(bool inProcess); //!< when its in-process work starts and ends
+    inline bool isInProcess() const;
+    inline bool isBusy() const; //!< running a child or in-process work
+    inline const std::atomic<bool> *held() const;
+
+    inline qint64 wallMs() const;
+    inline qint64 cpuMs()  const;
+    inline qint64 runningMs() const; //!< 0 if not running
+    inline qint64 spawnMs() const;   //!< fork, scheduling setup and exec of the last run
+    qint64 writtenBytes() const;     //!< by the running child so far (wchar of /proc/<pid>/io), -1 if unknown
+
+    inline bool hasScheduling() const;
+    QString schedulingStr() const;
+
+    static QVector<int> parseCpuList(const QString &cpuList, bool *ok = nullptr);
+    static bool parseIoClass(const QString &str, IoClass &ioClass, int &level);
+
+protected:
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0) && defined(Q_OS_UNIX)
+    void setupChildProcess() override;
+#endif
+
+private slots:
+    void _onStateChanged(QProcess::ProcessState newState);
+    void _onStarted();
+    void _onFinished();
+
+private:
+    void _applyInChild(); //!< only async-signal-safe calls in there!
+};
+
+bool ExtProcess::hasScheduling() const
+{
+    return _setNice || _ioClass != IoClass::Default || !_cpus.isEmpty() || !_cgroupProcs.isEmpty() || _numaNode;
+}
+
+const NumaNode *ExtProcess::numaNode() const { return _numaNode; }
+bool ExtProcess::isPaused() const { return _pauseTimer.isValid(); }
+bool ExtProcess::isInProcess() const { return _inProcess; }
+bool ExtProcess::isBusy() const { return _inProcess || state() != NotRunning; }
+const std::atomic<bool> *ExtProcess::held() const { return &_held; }
+
+qint64 ExtProcess::wallMs() const { return _wallMs; }
+qint64 ExtProcess::cpuMs()  const { return _cpuMs; }
+qint64 ExtProcess::spawnMs() const { return _spawnMs; }
+qint64 ExtProcess::runningMs() const
+{
+    if (state() == NotRunning || !_runTimer.isValid())
+        return 0;
+    return _runTimer.elapsed() - _pausedMs - (_pauseTimer.isValid() ? _pauseTimer.elapsed() : 0);
+}
+
+#endif // EXTPROCESS_H
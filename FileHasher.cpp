@@ -0,0 +1,153 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "FileHasher.h"
+#include "Crc32.h"
+#include "Xxh3.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QStringList>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+FileHasher::Digests FileHasher::hash(const QString &filePath, int digests)
+{
+    Digests result{false, 0, QByteArray(), QByteArray(), 0};
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return result;
+
+    QCryptographicHash md5(QCryptographicHash::Md5), sha1(QCryptographicHash::Sha1);
+    Xxh3 xxh3;
+    typedef std::function<void(const char *data, qint64 size)> Updater;
+    std::vector<Updater> updaters;
+    if (digests & CRC32)
+        updaters.push_back([&result](const char *data, qint64 size){ result.crc32 = Crc32::update(result.crc32, data, size); });
+    if (digests & MD5)
+        updaters.push_back([&md5](const char *data, qint64 size){ md5.addData(data, static_cast<int>(size)); });
+    if (digests & SHA1)
+        updaters.push_back([&sha1](const char *data, qint64 size){ sha1.addData(data, static_cast<int>(size)); });
+    if (digests & XXH3)
+        updaters.push_back([&xxh3](const char *data, qint64 size){ xxh3.update(data, size); });
+
+    std::vector<char> buffers[2] = {std::vector<char>(sBufferSize), std::vector<char>(sBufferSize)};
+    bool readOk = true;
+    if (updaters.size() == 1)
+    {
+        qint64 n;
+        while ((n = file.read(buffers[0].data(), sBufferSize)) > 0)
+            updaters.front()(buffers[0].data(), n);
+        readOk = n == 0;
+    }
+    else if (!updaters.empty())
+    {
+        // block b is in buffers[b%2]: it can only be overwritten once everybody is done with block b-2
+        std::mutex              mutex;
+        std::condition_variable cond;
+        qint64                  sizes[2] = {0, 0};
+        qint64                  nbPublished = 0;
+        bool                    over = false;
+        std::vector<qint64>     nbDone(updaters.size(), 0);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0 ; i < updaters.size() ; ++i)
+        {
+            threads.emplace_back([&, i](){
+                std::unique_lock<std::mutex> lock(mutex);
+                for (qint64 block = 0 ; ; ++block)
+                {
+                    cond.wait(lock, [&]{ return nbPublished > block || over; });
+                    if (nbPublished <= block)
+                        break;
+                    const std::vector<char> &buffer = buffers[block % 2];
+                    qint64 size = sizes[block % 2];
+                    lock.unlock();
+                    updaters[i](buffer.data(), size);
+                    lock.lock();
+                    nbDone[i] = block + 1;
+                    cond.notify_all();
+                }
+            });
+        }
+
+        for (qint64 block = 0 ; ; ++block)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]{
+                    for (qint64 done : nbDone)
+                        if (done < block - 1)
+                            return false;
+                    return true;
+                });
+            }
+            qint64 n = file.read(buffers[block % 2].data(), sBufferSize);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (n <= 0)
+            {
+                readOk = n == 0;
+                over   = true;
+                cond.notify_all();
+                break;
+            }
+            sizes[block % 2] = n;
+            nbPublished      = block + 1;
+            cond.notify_all();
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    result.ok = readOk;
+    if (digests & MD5)
+        result.md5 = md5.result();
+    if (digests & SHA1)
+        result.sha1 = sha1.result();
+    if (digests & XXH3)
+        result.xxh3 = xxh3.digest();
+    return result;
+}
+
+int FileHasher::parseDigests(const QString &list, bool *ok)
+{
+    int digests = 0;
+    bool allOk = true;
+    for (const QString &name : list.toLower().split(",", Qt::SkipEmptyParts))
+    {
+        QString digest = name.trimmed();
+        if (digest == "crc32")
+            digests |= CRC32;
+        else if (digest == "md5")
+            digests |= MD5;
+        else if (digest == "sha1")
+            digests |= SHA1;
+        else if (digest == "xxh3")
+            digests |= XXH3;
+        else
+            allOk = false;
+    }
+    if (ok)
+        *ok = allOk;
+    return digests;
+}
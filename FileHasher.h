@@ -0,0 +1,53 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef FILEHASHER_H
+#define FILEHASHER_H
+#include "PureStaticClass.h"
+#include <QByteArray>
+#include <QString>
+
+//! computes several digests of a file in a single read.
+//! Each digest has its own thread working on the block that has just been read
+//! while the next one is read in a second buffer.
+class FileHasher : public PureStaticClass
+{
+public:
+    enum Digest : int {CRC32 = 0x1, MD5 = 0x2, SHA1 = 0x4, XXH3 = 0x8};
+
+    struct Digests
+    {
+        bool       ok;
+        quint32    crc32;
+        QByteArray md5;  //!< raw
+        QByteArray sha1; //!< raw
+        quint64    xxh3;
+    };
+
+    static Digests hash(const QString &filePath, int digests);
+
+    static int parseDigests(const QString &list, bool *ok = nullptr); //!< ex: "crc32,md5"
+
+private:
+    static constexpr qint64 sBufferSize = 1024 * 1024;
+};
+
+#endif // FILEHASHER_H
@@ -0,0 +1,165 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "JobServer.h"
+#include "ScenePacker.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+
+JobServer::JobServer(ScenePacker &packer, QObject *parent):
+    QObject(parent),
+    _packer(packer),
+    _server(new QLocalServer(this))
+{
+    _server->setSocketOptions(QLocalServer::UserAccessOption); // only our user can submit jobs
+    connect(_server, &QLocalServer::newConnection, this, &JobServer::onNewConnection);
+}
+
+bool JobServer::listen(const QString &name, QString &err)
+{
+    if (!_server->listen(name))
+    {
+        // a crashed server may have left its socket, we only remove it if nobody answers
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(1000))
+        {
+            err = tr("a server is already listening on %1").arg(name);
+            return false;
+        }
+        QLocalServer::removeServer(name);
+        if (!_server->listen(name))
+        {
+            err = _server->errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+QString JobServer::fullServerName() const { return _server->fullServerName(); }
+
+void JobServer::onNewConnection()
+{
+    while (QLocalSocket *client = _server->nextPendingConnection())
+    {
+        connect(client, &QLocalSocket::readyRead,    this,   &JobServer::onClientReadyRead);
+        connect(client, &QLocalSocket::disconnected, client, &QObject::deleteLater);
+    }
+}
+
+void JobServer::onClientReadyRead()
+{
+    QLocalSocket *client = static_cast<QLocalSocket*>(sender());
+    while (client->canReadLine())
+    {
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(client->readLine(), &parseError);
+        QJsonObject reply;
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject())
+            reply = _errorReply(tr("invalid request: %1").arg(parseError.errorString()));
+        else
+            reply = _handle(doc.object());
+
+        client->write(QJsonDocument(reply).toJson(QJsonDocument::Compact));
+        client->write("\n");
+    }
+}
+
+QJsonObject JobServer::_handle(const QJsonObject &req)
+{
+    QString cmd = req.value("cmd").toString();
+    QString err;
+    if (cmd == "submit")
+    {
+        QStringList srcFolders;
+        for (const QJsonValue &input : req.value("inputs").toArray())
+            srcFolders << input.toString();
+        _packer.clearSourcePriorities(); // only the ones of this job
+        for (const QJsonValue &val : req.value("priorities").toArray())
+        {
+            QJsonObject priority = val.toObject();
+            _packer.setSourcePriority(priority.value("path").toString(),
+                                      priority.value("prio").toInt(),
+                                      static_cast<qint64>(priority.value("deadline").toDouble()));
+        }
+
+        int nbEntries = 0;
+        int jobId = _packer.submitJob(srcFolders, req.value("options").toObject().toVariantHash(), nbEntries, err);
+        if (jobId == 0)
+            return _errorReply(err);
+        return QJsonObject{{"ok", true}, {"job", jobId}, {"nbEntries", nbEntries}};
+    }
+    else if (cmd == "status")
+        return QJsonObject{{"ok", true}, {"jobs", _packer.jobsStatus()}};
+    else if (cmd == "cancel")
+    {
+        if (!_packer.cancelJob(req.value("job").toInt(), err))
+            return _errorReply(err);
+        return QJsonObject{{"ok", true}};
+    }
+    else
+        return _errorReply(tr("unknown command: %1").arg(cmd));
+}
+
+QJsonObject JobServer::_errorReply(const QString &err)
+{
+    return QJsonObject{{"ok", false}, {"error", err}};
+}
+
+bool JobServer::request(const QString &name, const QJsonObject &req, QJsonObject &reply, QString &err)
+{
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    if (!socket.waitForConnected(sClientTimeoutMs))
+    {
+        err = tr("couldn't connect to the server %1: %2").arg(name).arg(socket.errorString());
+        return false;
+    }
+
+    socket.write(QJsonDocument(req).toJson(QJsonDocument::Compact));
+    socket.write("\n");
+    if (!socket.waitForBytesWritten(sClientTimeoutMs))
+    {
+        err = tr("couldn't send the request: %1").arg(socket.errorString());
+        return false;
+    }
+
+    while (!socket.canReadLine())
+    {
+        if (!socket.waitForReadyRead(sClientTimeoutMs))
+        {
+            err = tr("no reply from the server: %1").arg(socket.errorString());
+            return false;
+        }
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(socket.readLine());
+    reply = doc.object();
+    if (!reply.value("ok").toBool())
+    {
+        err = reply.value("error").toString(tr("invalid reply"));
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+#include <QObject>
+#include <QJsonObject>
+class ScenePacker;
+class QLocalServer;
+class QLocalSocket;
+
+//! local socket server receiving the jobs of the scenePacker clients
+//! protocol: one JSON object per line, each request gets one reply
+//!   {"cmd": "submit", "inputs": [...], "priorities": [{"path": ..., "prio": ..., "deadline": ...}], "options": {...}}
+//!                                                        => {"ok": true, "job": id, "nbEntries": nb}
+//!   {"cmd": "status"}                                    => {"ok": true, "jobs": [...]}
+//!   {"cmd": "cancel", "job": id}                         => {"ok": true}
+//! on error: {"ok": false, "error": "..."}
+class JobServer : public QObject
+{
+    Q_OBJECT
+
+private:
+    ScenePacker  &_packer;
+    QLocalServer *_server;
+
+public:
+    explicit JobServer(ScenePacker &packer, QObject *parent = nullptr);
+    ~JobServer() override = default;
+
+    bool listen(const QString &name, QString &err);
+    QString fullServerName() const;
+
+    //! synchronous client request (no event loop needed)
+    static bool request(const QString &name, const QJsonObject &req, QJsonObject &reply, QString &err);
+
+private slots:
+    void onNewConnection();
+    void onClientReadyRead();
+
+private:
+    QJsonObject _handle(const QJsonObject &req);
+
+    static QJsonObject _errorReply(const QString &err);
+
+    static constexpr int sClientTimeoutMs = 30000;
+};
+
+#endif // JOBSERVER_H
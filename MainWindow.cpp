@@ -29,13 +29,19 @@
 #include <QMessageBox>
 #include <QProgressBar>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QTimer>
+#include <QHeaderView>
+#include <QTableView>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , _ui(new Ui::MainWindow),
       _progressBar(new QProgressBar(this)),
+      _status(new PackStatusModel(this)),
       _app(nullptr),
-      _state(STATE::IDLE)
+      _state(STATE::IDLE),
+      _closeWhenIdle(false)
 {
     _ui->setupUi(this);
     setAcceptDrops(true);
@@ -62,13 +68,22 @@ MainWindow::MainWindow(QWidget *parent)
     connect(_ui->clearLogButton, &QAbstractButton::clicked, _ui->logBrowser, &QTextBrowser::clear);
 
     connect(_ui->launchButton,   &QAbstractButton::clicked, this,            &MainWindow::onLaunch);
+    connect(_ui->pauseButton,    &QAbstractButton::clicked, this,            &MainWindow::onPause);
+    connect(_ui->nbThreadsSB, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onThreadsChanged);
 
     _ui->srcList->setSelectionMode(QAbstractItemView::ExtendedSelection);
     connect(_ui->srcList, &SignedListWidget::rightClick, this, &MainWindow::onAddSrc);
+    connect(_ui->srcList, &QAbstractItemView::doubleClicked, this, &MainWindow::onSrcDoubleClicked);
 
     connect(_ui->packInDestRB, &QAbstractButton::clicked, this, &MainWindow::onPackInDstFolder);
     connect(_ui->packInSrcRB,  &QAbstractButton::clicked, this, &MainWindow::onPackInSrcFolder);
 
+    _ui->entryTable->setModel(_status);
+    _initStatusTable(_ui->entryTable, PackStatusModel::ColEntry);
+    _ui->workerTable->setModel(_status->lanes());
+    _initStatusTable(_ui->workerTable, WorkerLaneModel::ColEntry);
+
     statusBar()->addPermanentWidget(_progressBar, 2);
 }
 
@@ -89,7 +104,7 @@ void MainWindow::init(ScenePacker *app)
     _ui->nbThreadsSB->setMaximum(QThread::idealThreadCount());
 
 #ifdef __DEBUG__
-    _ui->srcList->addPathIfNotInList("/tmp/testScenePacker", _ui->srcList->count(), true);
+    _ui->srcList->addPathIfNotInList("/tmp/testScenePacker", true);
 #endif
 
     setIDLE();
@@ -122,6 +137,20 @@ void MainWindow::setIDLE()
 {
     _state = STATE::IDLE;
     _ui->launchButton->setText(tr("Let's Pack!"));
+    _ui->pauseButton->setEnabled(false);
+    setPaused(false);
+    if (_closeWhenIdle)
+        QTimer::singleShot(0, this, &QWidget::close);
+}
+
+void MainWindow::setPaused(bool paused)
+{
+    _ui->pauseButton->setText(paused ? tr("Resume") : tr("Pause"));
+    _progressBar->setFormat(paused ? tr("%p% (paused)") : QString("%p%"));
+    if (paused)
+        statusBar()->showMessage(tr("Paused: the rar processes are stopped"));
+    else
+        statusBar()->clearMessage();
 }
 
 void MainWindow::setProgressMax(int max)
@@ -176,6 +205,7 @@ void MainWindow::saveParams()
                 _ui->compressionBox->lockArchive(),
                 _ui->compressionBox->compressLevel()
                 );
+    _app->setAutoLevel(_ui->compressionBox->autoLevel());
 }
 
 void MainWindow::onLaunch()
@@ -195,8 +225,15 @@ void MainWindow::onLaunch()
         }
 
         QStringList folders;
+        _app->clearSourcePriorities();
         for (int i = 0 ; i < _ui->srcList->count() ; ++i)
-            folders << _ui->srcList->item(i)->text();
+        {
+            QString   folder   = _ui->srcList->path(i);
+            QDateTime deadline = _ui->srcList->deadline(i);
+            folders << folder;
+            _app->setSourcePriority(folder, _ui->srcList->priority(i),
+                                    deadline.isValid() ? deadline.toMSecsSinceEpoch() : 0);
+        }
 
         if (folders.isEmpty())
             QMessageBox::warning(nullptr,
@@ -206,6 +243,8 @@ void MainWindow::onLaunch()
         {
             _state = STATE::RUNNING;
             _ui->launchButton->setText(tr("Stop"));
+            _ui->pauseButton->setEnabled(true);
+            _status->clear();
             _app->processFolders(folders);
         }
     }
@@ -214,6 +253,21 @@ void MainWindow::onLaunch()
 }
 
 
+void MainWindow::onPause()
+{
+    if (_app->isPaused())
+        _app->resumeProcessing();
+    else
+        _app->pauseProcessing();
+}
+
+void MainWindow::onThreadsChanged(int nbThreads)
+{
+    // can't add processes to a run but we can stop some of them
+    if (_state == STATE::RUNNING)
+        _app->throttle(nbThreads);
+}
+
 void MainWindow::onDebugToggled(bool checked)
 {
     _app->setDebug(checked);
@@ -262,12 +316,46 @@ void MainWindow::onAddSrc()
 
     if (!folder.isEmpty())
     {
-        _ui->srcList->addPathIfNotInList(folder, _ui->srcList->count(), true);
+        _ui->srcList->addPathIfNotInList(folder, true);
         _app->setSrcFolder(folder);
     }
 }
 
 
+void MainWindow::onSrcDoubleClicked(const QModelIndex &index)
+{
+    int row = index.row();
+    bool ok = false;
+    int priority = QInputDialog::getInt(this,
+                                        tr("Priority"),
+                                        tr("Priority of %1 (the higher the sooner):").arg(_ui->srcList->path(row)),
+                                        _ui->srcList->priority(row), -100, 100, 1, &ok);
+    if (!ok)
+        return;
+
+    QDateTime deadline = _ui->srcList->deadline(row);
+    QString deadlineStr = QInputDialog::getText(this,
+                                                tr("Deadline"),
+                                                tr("Deadline (yyyy/MM/dd hh:mm) or empty for none:"),
+                                                QLineEdit::Normal,
+                                                deadline.isValid() ? deadline.toString("yyyy/MM/dd hh:mm") : QString(),
+                                                &ok);
+    if (!ok)
+        return;
+
+    deadline = deadlineStr.trimmed().isEmpty() ? QDateTime()
+                                               : QDateTime::fromString(deadlineStr.trimmed(), "yyyy/MM/dd hh:mm");
+    if (!deadlineStr.trimmed().isEmpty() && !deadline.isValid())
+    {
+        QMessageBox::warning(nullptr,
+                             tr("Invalid deadline..."),
+                             tr("Please use the format yyyy/MM/dd hh:mm"));
+        return;
+    }
+    _ui->srcList->setPriority(row, priority, deadline);
+}
+
+
 void MainWindow::dragEnterEvent(QDragEnterEvent *e)
 {
     if (e->mimeData()->hasUrls())
@@ -276,13 +364,14 @@ void MainWindow::dragEnterEvent(QDragEnterEvent *e)
 
 void MainWindow::dropEvent(QDropEvent *e)
 {
-    int currentNbFiles = _ui->srcList->count();
+    QStringList folders;
     for (const QUrl &url : e->mimeData()->urls())
     {
         QString fileName = url.toLocalFile();
         if (QFileInfo(fileName).isDir()) // we only add folders
-            _ui->srcList->addPathIfNotInList(fileName, currentNbFiles, true);
+            folders << fileName;
     }
+    _ui->srcList->addPaths(folders, true); // in one batch
 }
 
 
@@ -298,10 +387,13 @@ void MainWindow::closeEvent(QCloseEvent *event)
                                         QMessageBox::Yes,
                                         QMessageBox::No);
         if (res == QMessageBox::Yes)
-        {            
+        {
+            // we're closed by setIDLE once the processes are stopped
+            _closeWhenIdle = true;
             _app->stopProcessing();
-            qApp->processEvents();
-            event->accept();
+            if (_state == STATE::RUNNING)
+                statusBar()->showMessage(tr("Stopping the rar processes..."));
+            event->ignore();
         }
         else
             event->ignore();
@@ -311,6 +403,18 @@ void MainWindow::closeEvent(QCloseEvent *event)
 }
 
 
+void MainWindow::_initStatusTable(QTableView *table, int stretchedColumn)
+{
+    // fixed row heights so the view never measures the rows of a big run
+    table->verticalHeader()->hide();
+    table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    table->verticalHeader()->setDefaultSectionSize(table->fontMetrics().height() + 6);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    table->horizontalHeader()->setSectionResizeMode(stretchedColumn, QHeaderView::Stretch);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setWordWrap(false);
+}
+
 bool MainWindow::_updateParams()
 {
     if (_ui->packInDestRB->isChecked())
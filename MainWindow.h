@@ -23,8 +23,11 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include "PackStatusModel.h"
 class ScenePacker;
 class QProgressBar;
+class QModelIndex;
+class QTableView;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -38,8 +41,10 @@ private:
 
     Ui::MainWindow   *_ui;
     QProgressBar     *_progressBar;
+    PackStatusModel  *_status;        //!< entries of the current run (Entries and Workers tabs)
     ScenePacker      *_app;
     STATE             _state;
+    bool              _closeWhenIdle; //!< close asked while running: once the processes are stopped
 
     static const QString sGroupBoxStyle;
     static const QString sSplitterStyle;
@@ -54,9 +59,13 @@ public:
     void init(ScenePacker *app);
 
     void setIDLE();
+    void setPaused(bool paused);
     void setProgressMax(int max);
     void setProgress(int value);
 
+    inline void entryStatus(const QString &path, PackStatusModel::State state, qint64 size,
+                            int worker = -1, qint64 expectedMs = 0);
+
 
     void log(const QString &msg);
     void success(const QString &msg);
@@ -66,12 +75,15 @@ public:
 
 public slots:
     void onLaunch();
+    void onPause();
+    void onThreadsChanged(int nbThreads);
     void onAddSrc();
     void onDebugToggled(bool checked);
     void onDstPath();
     void onDispCompressionPaths(bool display);
     void onPackInDstFolder();
     void onPackInSrcFolder();
+    void onSrcDoubleClicked(const QModelIndex &index);
 
 protected:
     void dragEnterEvent(QDragEnterEvent *e) override;
@@ -81,6 +93,12 @@ protected:
 
 private:
     bool _updateParams();
+    void _initStatusTable(QTableView *table, int stretchedColumn);
 };
 
+void MainWindow::entryStatus(const QString &path, PackStatusModel::State state, qint64 size, int worker, qint64 expectedMs)
+{
+    _status->update(path, state, size, worker, expectedMs);
+}
+
 #endif // MAINWINDOW_H
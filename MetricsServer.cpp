@@ -0,0 +1,132 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "MetricsServer.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+Histogram::Histogram(const QVector<double> &bounds):
+    _bounds(bounds), _counts(bounds.size() + 1, 0),
+    _sum(0.), _count(0)
+{}
+
+void Histogram::observe(double value)
+{
+    int bucket = 0;
+    while (bucket < _bounds.size() && value > _bounds.at(bucket))
+        ++bucket;
+    ++_counts[bucket];
+    _sum += value;
+    ++_count;
+}
+
+void Histogram::write(QByteArray &out, const char *name, const char *help) const
+{
+    out.append("# HELP ").append(name).append(' ').append(help).append('\n');
+    out.append("# TYPE ").append(name).append(" histogram\n");
+    quint64 cumulated = 0;
+    for (int bucket = 0 ; bucket < _bounds.size() ; ++bucket)
+    {
+        cumulated += _counts.at(bucket);
+        out.append(name).append("_bucket{le=\"").append(QByteArray::number(_bounds.at(bucket), 'g', 15))
+                .append("\"} ").append(QByteArray::number(cumulated)).append('\n');
+    }
+    out.append(name).append("_bucket{le=\"+Inf\"} ").append(QByteArray::number(_count)).append('\n');
+    out.append(name).append("_sum ").append(QByteArray::number(_sum, 'g', 15)).append('\n');
+    out.append(name).append("_count ").append(QByteArray::number(_count)).append('\n');
+}
+
+
+MetricsServer::MetricsServer(const Exposition &exposition, QObject *parent):
+    QObject(parent),
+    _server(new QTcpServer(this)),
+    _exposition(exposition)
+{
+    connect(_server, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen(quint16 port, QString &err)
+{
+    if (_server->listen(QHostAddress::LocalHost, port))
+        return true;
+
+    err = _server->errorString();
+    return false;
+}
+
+void MetricsServer::writeCounter(QByteArray &out, const char *name, const char *help, double value)
+{
+    _writeMetric(out, "counter", name, help, value);
+}
+
+void MetricsServer::writeGauge(QByteArray &out, const char *name, const char *help, double value)
+{
+    _writeMetric(out, "gauge", name, help, value);
+}
+
+void MetricsServer::_writeMetric(QByteArray &out, const char *type, const char *name, const char *help, double value)
+{
+    out.append("# HELP ").append(name).append(' ').append(help).append('\n');
+    out.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+    out.append(name).append(' ').append(QByteArray::number(value, 'g', 15)).append('\n');
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (QTcpSocket *client = _server->nextPendingConnection())
+    {
+        connect(client, &QTcpSocket::readyRead,    this,   &MetricsServer::onReadyRead);
+        connect(client, &QTcpSocket::disconnected, client, &QObject::deleteLater);
+        QTimer::singleShot(sRequestTimeoutMs, client, &QTcpSocket::abort); // clients that never ask anything
+    }
+}
+
+void MetricsServer::onReadyRead()
+{
+    QTcpSocket *client = static_cast<QTcpSocket*>(sender());
+    if (!client->canReadLine())
+    {
+        if (client->bytesAvailable() > sMaxRequestSize)
+            client->abort();
+        return;
+    }
+
+    // only the request line matters, we close after the answer
+    QList<QByteArray> request = client->readLine().trimmed().split(' ');
+    disconnect(client, &QTcpSocket::readyRead, this, &MetricsServer::onReadyRead);
+
+    QByteArray status = "200 OK", body;
+    if (request.size() < 2 || request.at(0) != "GET")
+        status = "405 Method Not Allowed";
+    else if (request.at(1) != "/metrics" && request.at(1) != "/")
+        status = "404 Not Found";
+    else
+        body = _exposition();
+
+    client->write(QByteArray("HTTP/1.0 ").append(status)
+                  .append("\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: ")
+                  .append(QByteArray::number(body.size()))
+                  .append("\r\nConnection: close\r\n\r\n")
+                  .append(body));
+    client->disconnectFromHost(); // once written
+}
@@ -0,0 +1,81 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <functional>
+class QTcpServer;
+
+//! distribution of a measure with the buckets of Prometheus (upper bounds, +Inf is implicit)
+class Histogram
+{
+private:
+    QVector<double>  _bounds;
+    QVector<quint64> _counts; //!< per bucket (not cumulated), the last one is +Inf
+    double           _sum;
+    quint64          _count;
+
+public:
+    explicit Histogram(const QVector<double> &bounds);
+
+    void observe(double value);
+
+    void write(QByteArray &out, const char *name, const char *help) const;
+};
+
+
+//! serves the metrics in the Prometheus text format on http://127.0.0.1:port/metrics
+//! The exposition is only built when it is scraped so it costs nothing to the dispatch in between
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<QByteArray()> Exposition;
+
+private:
+    QTcpServer *_server;
+    Exposition  _exposition;
+
+public:
+    explicit MetricsServer(const Exposition &exposition, QObject *parent = nullptr);
+    ~MetricsServer() override = default;
+
+    bool listen(quint16 port, QString &err); //!< localhost only
+
+    static void writeCounter(QByteArray &out, const char *name, const char *help, double value);
+    static void writeGauge(QByteArray &out, const char *name, const char *help, double value);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    static void _writeMetric(QByteArray &out, const char *type, const char *name, const char *help, double value);
+
+    static constexpr int sMaxRequestSize   = 8192;
+    static constexpr int sRequestTimeoutMs = 5000;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,142 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+//! bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's ring)
+//! each cell has a sequence number telling whether it is free for the producer
+//! or ready for the consumer of the current lap, so push and pop only contend on one atomic each
+//! the capacity is rounded up to a power of 2
+template <typename T>
+class MpmcQueue
+{
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T                   data;
+    };
+
+    const size_t            _mask;
+    std::unique_ptr<Cell[]> _cells;
+
+    // padded onto their own cache lines (alignas would need an aligned new for the owners before C++17)
+    char                    _pad1[64];
+    std::atomic<size_t>     _enqueuePos;
+    char                    _pad2[64];
+    std::atomic<size_t>     _dequeuePos;
+    char                    _pad3[64];
+
+public:
+    explicit MpmcQueue(size_t capacity = 1024);
+
+    MpmcQueue(const MpmcQueue &other) = delete;
+    MpmcQueue & operator=(const MpmcQueue &other) = delete;
+
+    bool tryPush(T &&data); //!< false if full
+    bool tryPop(T &data);   //!< false if empty
+
+    inline size_t capacity() const;
+
+private:
+    static size_t _roundUp(size_t capacity);
+};
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(size_t capacity):
+    _mask(_roundUp(capacity) - 1),
+    _cells(new Cell[_mask + 1]),
+    _pad1(), _enqueuePos(0),
+    _pad2(), _dequeuePos(0),
+    _pad3()
+{
+    for (size_t i = 0 ; i <= _mask ; ++i)
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool MpmcQueue<T>::tryPush(T &&data)
+{
+    Cell  *cell;
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &_cells[pos & _mask];
+        size_t    seq  = cell->sequence.load(std::memory_order_acquire);
+        ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+        if (diff == 0)
+        {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false; // the consumers haven't freed that cell yet
+        else
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+    }
+    cell->data = std::move(data);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool MpmcQueue<T>::tryPop(T &data)
+{
+    Cell  *cell;
+    size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &_cells[pos & _mask];
+        size_t    seq  = cell->sequence.load(std::memory_order_acquire);
+        ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos + 1);
+        if (diff == 0)
+        {
+            if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false; // nothing produced in that cell yet
+        else
+            pos = _dequeuePos.load(std::memory_order_relaxed);
+    }
+    data = std::move(cell->data);
+    cell->data = T(); // don't keep a copy alive in the ring
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t MpmcQueue<T>::capacity() const { return _mask + 1; }
+
+template <typename T>
+size_t MpmcQueue<T>::_roundUp(size_t capacity)
+{
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    return size;
+}
+
+#endif // MPMCQUEUE_H
@@ -0,0 +1,122 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NumaTopology.h"
+#include "ExtProcess.h"
+#include <QFile>
+#include <cstring>
+#include <algorithm>
+#if defined(Q_OS_LINUX)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const QVector<NumaNode> &NumaTopology::nodes()
+{
+    static const QVector<NumaNode> sNodes = _readNodes();
+    return sNodes;
+}
+
+QVector<const NumaNode*> NumaTopology::nodesWithCpus(const QVector<int> &cpus)
+{
+    QVector<const NumaNode*> nodesWithCpus;
+    for (const NumaNode &node : nodes())
+    {
+        if (cpus.isEmpty() || std::any_of(node.cpus.cbegin(), node.cpus.cend(), [&cpus](int cpu){ return cpus.contains(cpu); }))
+            nodesWithCpus << &node;
+    }
+    return nodesWithCpus;
+}
+
+void NumaTopology::nodeMask(int nodeId, NodeMask &mask)
+{
+    std::memset(mask, 0, sizeof(NodeMask));
+    if (nodeId >= 0 && nodeId < NUMA_MAX_NODES)
+    {
+        constexpr int bitsPerLong = 8 * sizeof(unsigned long);
+        mask[nodeId / bitsPerLong] |= 1UL << (nodeId % bitsPerLong);
+    }
+}
+
+QVector<NumaNode> NumaTopology::_readNodes()
+{
+    QVector<NumaNode> nodes;
+#if defined(Q_OS_LINUX)
+    QFile onlineFile(QString("%1/online").arg(sSysNodePath));
+    if (!onlineFile.open(QIODevice::ReadOnly|QIODevice::Text))
+        return nodes;
+
+    for (int id : ExtProcess::parseCpuList(QString::fromLatin1(onlineFile.readAll()).trimmed()))
+    {
+        QFile cpuFile(QString("%1/node%2/cpulist").arg(sSysNodePath).arg(id));
+        if (id >= NUMA_MAX_NODES || !cpuFile.open(QIODevice::ReadOnly|QIODevice::Text))
+            continue;
+
+        QVector<int> cpus = ExtProcess::parseCpuList(QString::fromLatin1(cpuFile.readAll()).trimmed());
+        if (!cpus.isEmpty()) // memory only nodes are useless for us
+            nodes << NumaNode{id, cpus};
+    }
+#endif
+    return nodes;
+}
+
+
+NumaBinder::NumaBinder(const NumaNode *node):
+    _bound(false)
+{
+#if defined(Q_OS_LINUX)
+    if (!node || node->cpus.isEmpty())
+        return;
+
+    if (::sched_getaffinity(0, sizeof(cpu_set_t), &_oldCpus) != 0
+            || ::syscall(SYS_get_mempolicy, &_oldPolicy, _oldNodes, NUMA_MAX_NODES, nullptr, 0) != 0)
+        return;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : node->cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &cpus);
+    }
+    if (::sched_setaffinity(0, sizeof(cpu_set_t), &cpus) != 0)
+        return;
+
+    NumaTopology::NodeMask mask;
+    NumaTopology::nodeMask(node->id, mask);
+    ::syscall(SYS_set_mempolicy, SP_MPOL_PREFERRED, mask, NUMA_MAX_NODES);
+    _bound = true;
+#else
+    Q_UNUSED(node)
+#endif
+}
+
+NumaBinder::~NumaBinder()
+{
+#if defined(Q_OS_LINUX)
+    if (_bound)
+    {
+        ::sched_setaffinity(0, sizeof(cpu_set_t), &_oldCpus);
+        ::syscall(SYS_set_mempolicy, _oldPolicy,
+                  _oldPolicy == SP_MPOL_DEFAULT ? nullptr : _oldNodes, NUMA_MAX_NODES);
+    }
+#endif
+}
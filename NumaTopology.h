@@ -0,0 +1,82 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef NUMATOPOLOGY_H
+#define NUMATOPOLOGY_H
+#include "PureStaticClass.h"
+#include <QVector>
+#if defined(Q_OS_LINUX)
+#include <sched.h>
+#endif
+
+#define NUMA_MAX_NODES 256
+
+// from numaif.h (we don't want to depend on libnuma)
+#define SP_MPOL_DEFAULT   0
+#define SP_MPOL_PREFERRED 1
+
+struct NumaNode
+{
+    int          id;   //!< kernel node id (they can be sparse)
+    QVector<int> cpus;
+};
+
+//! NUMA nodes of the host as exposed in /sys (Linux only, no nodes elsewhere)
+class NumaTopology : public PureStaticClass
+{
+public:
+    typedef unsigned long NodeMask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+
+    static const QVector<NumaNode> &nodes(); //!< online nodes having cpus (read once)
+    static QVector<const NumaNode*> nodesWithCpus(const QVector<int> &cpus); //!< having some of them (all if empty)
+    static inline int nbNodes();
+
+    static void nodeMask(int nodeId, NodeMask &mask);
+
+private:
+    static QVector<NumaNode> _readNodes();
+
+    static constexpr const char *sSysNodePath = "/sys/devices/system/node";
+};
+
+int NumaTopology::nbNodes() { return nodes().size(); }
+
+
+//! RAII binding of the calling thread (cpus + memory) on a NUMA node, restored on destruction
+class NumaBinder
+{
+private:
+    bool      _bound;
+#if defined(Q_OS_LINUX)
+    cpu_set_t _oldCpus;
+    int       _oldPolicy;
+    NumaTopology::NodeMask _oldNodes;
+#endif
+
+public:
+    explicit NumaBinder(const NumaNode *node); //!< nullptr: no binding
+    ~NumaBinder();
+
+    NumaBinder(const NumaBinder &other) = delete;
+    NumaBinder & operator=(const NumaBinder &other) = delete;
+};
+
+#endif // NUMATOPOLOGY_H
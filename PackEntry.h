@@ -0,0 +1,49 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef PACKENTRY_H
+#define PACKENTRY_H
+#include <QFileInfo>
+
+//! a file or folder of a source folder to pack in its own archive
+struct PackEntry
+{
+    QFileInfo fi;
+    bool      isDir;   //!< from the scan so we don't stat again
+    qint64    size;    //!< size of the file or total size of the folder content
+    int       nbFiles; //!< 1 for a file
+    int       jobId;   //!< job submitted to the server (0 for a local run)
+    int       leaseId; //!< lease of the coordinator when we're a worker (0 otherwise)
+    int       priority; //!< the higher the sooner
+    qint64    deadline; //!< ms since epoch (0: none)
+    int       attempts; //!< failed packings so far (the entry is queued again)
+
+    PackEntry(const QFileInfo &fileInfo = QFileInfo(), bool isFolder = false,
+              qint64 entrySize = 0, int nbEntryFiles = 0):
+        fi(fileInfo), isDir(isFolder), size(entrySize), nbFiles(nbEntryFiles), jobId(0), leaseId(0), priority(0), deadline(0),
+        attempts(0)
+    {}
+
+    //! name of its folder in the destination (without the rar prefix)
+    inline QString archiveFolderName() const { return isDir ? fi.fileName() : fi.completeBaseName(); }
+};
+
+#endif // PACKENTRY_H
@@ -0,0 +1,65 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef PACKJOB_H
+#define PACKJOB_H
+#include <QStringList>
+#include <QVariantHash>
+#include <QDateTime>
+
+//! set of source folders submitted to the job server with its own compression options
+struct PackJob
+{
+    enum class State : char {Queued = 0, Running, Done, Canceled};
+
+    int          id;
+    QStringList  srcFolders;
+    QVariantHash options;   //!< per job settings (keys from ScenePacker::sParamNames)
+    QDateTime    submitted;
+    State        state;
+    int          nbEntries;
+    int          nbRunning;
+    int          nbDone;
+    int          nbFailed;
+
+    PackJob(int jobId, const QStringList &folders, const QVariantHash &jobOptions):
+        id(jobId), srcFolders(folders), options(jobOptions), submitted(QDateTime::currentDateTime()),
+        state(State::Queued), nbEntries(0), nbRunning(0), nbDone(0), nbFailed(0)
+    {}
+
+    inline bool isFinished() const { return state == State::Done || state == State::Canceled; }
+
+    inline static const char *stateStr(State state);
+};
+
+const char *PackJob::stateStr(State state)
+{
+    switch (state)
+    {
+    case State::Queued:   return "queued";
+    case State::Running:  return "running";
+    case State::Done:     return "done";
+    case State::Canceled: return "canceled";
+    }
+    return "";
+}
+
+#endif // PACKJOB_H
@@ -0,0 +1,153 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "PackQueue.h"
+#include <QDateTime>
+#include <algorithm>
+#include <limits>
+
+PackQueue::PackQueue():
+    _items(), _scores(), _deadlines(),
+    _headSeq(0), _lastSeq(0),
+    _frontScore(std::numeric_limits<qint64>::min() / 2),
+    _throughput(sDefaultThroughput),
+    _totalSize(0)
+{}
+
+void PackQueue::enqueue(const PackEntry &entry)
+{
+    qint64  now = QDateTime::currentMSecsSinceEpoch();
+    quint64 seq = ++_lastSeq;
+    _items.insert(seq, Item{entry, now});
+    _totalSize += entry.size;
+    _push(_scores, {now - entry.priority * sAgingMs, seq});
+    if (entry.deadline > 0)
+        _push(_deadlines, {_latestStart(entry), seq});
+    _headSeq = 0;
+}
+
+void PackQueue::prepend(const PackEntry &entry)
+{
+    quint64 seq = ++_lastSeq;
+    _items.insert(seq, Item{entry, QDateTime::currentMSecsSinceEpoch()});
+    _totalSize += entry.size;
+    _push(_scores, {--_frontScore, seq});
+    _headSeq = 0;
+}
+
+const PackEntry &PackQueue::head() const
+{
+    if (_headSeq == 0 || !_items.contains(_headSeq))
+        _headSeq = _nextSeq();
+    return _items.find(_headSeq)->entry;
+}
+
+PackEntry PackQueue::dequeue()
+{
+    PackEntry entry = head();
+    _items.remove(_headSeq);
+    _totalSize -= entry.size;
+    _headSeq = 0;
+    _compact();
+    return entry;
+}
+
+void PackQueue::clear()
+{
+    _items.clear();
+    _scores.clear();
+    _deadlines.clear();
+    _headSeq   = 0;
+    _totalSize = 0;
+}
+
+int PackQueue::removeIf(const EntryFilter &match)
+{
+    int nbRemoved = 0;
+    for (auto it = _items.begin() ; it != _items.end() ; )
+    {
+        if (match(it->entry))
+        {
+            _totalSize -= it->entry.size;
+            it = _items.erase(it);
+            ++nbRemoved;
+        }
+        else
+            ++it;
+    }
+    _headSeq = 0;
+    _compact();
+    return nbRemoved;
+}
+
+QList<PackEntry> PackQueue::entries() const
+{
+    PackQueue queue(*this);
+    QList<PackEntry> entries;
+    while (!queue.isEmpty())
+        entries << queue.dequeue();
+    return entries;
+}
+
+quint64 PackQueue::_nextSeq() const
+{
+    _dropTaken(_deadlines);
+    _dropTaken(_scores);
+    if (!_deadlines.empty() && _deadlines.front().key <= QDateTime::currentMSecsSinceEpoch())
+        return _deadlines.front().seq;
+    else
+        return _scores.front().seq;
+}
+
+void PackQueue::_push(std::vector<HeapKey> &heap, const HeapKey &key) const
+{
+    heap.push_back(key);
+    std::push_heap(heap.begin(), heap.end(), std::greater<HeapKey>());
+}
+
+void PackQueue::_dropTaken(std::vector<HeapKey> &heap) const
+{
+    while (!heap.empty() && !_items.contains(heap.front().seq))
+    {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<HeapKey>());
+        heap.pop_back();
+    }
+}
+
+void PackQueue::_compact()
+{
+    // the lazy removals could make the heaps grow forever when we remove a lot (job canceled)
+    size_t maxSize = 2 * static_cast<size_t>(_items.size()) + 64;
+    if (_scores.size() <= maxSize && _deadlines.size() <= maxSize)
+        return;
+
+    auto isTaken = [this](const HeapKey &key){ return !_items.contains(key.seq); };
+    _scores.erase(std::remove_if(_scores.begin(), _scores.end(), isTaken), _scores.end());
+    _deadlines.erase(std::remove_if(_deadlines.begin(), _deadlines.end(), isTaken), _deadlines.end());
+    std::make_heap(_scores.begin(), _scores.end(), std::greater<HeapKey>());
+    std::make_heap(_deadlines.begin(), _deadlines.end(), std::greater<HeapKey>());
+}
+
+qint64 PackQueue::_latestStart(const PackEntry &entry) const
+{
+    qint64 durationMs = static_cast<qint64>(1000. * static_cast<double>(entry.size) / _throughput);
+    return entry.deadline - durationMs - sDeadlineMarginMs;
+}
@@ -0,0 +1,117 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef PACKQUEUE_H
+#define PACKQUEUE_H
+#include "PackEntry.h"
+#include <QHash>
+#include <functional>
+#include <vector>
+
+//! entries to compress ordered by priority with aging, so the bulk is never starved:
+//! an entry gains one priority level every sAgingMs it waits.
+//! As the aging is the same for everybody, the order doesn't change with time and a heap does the job.
+//! The entries with a deadline go first once they have to start to be done in time
+//! (estimated from their size and the throughput).
+class PackQueue
+{
+public:
+    typedef std::function<bool(const PackEntry &entry)> EntryFilter;
+
+private:
+    struct Item
+    {
+        PackEntry entry;
+        qint64    enqueued; //!< ms since epoch
+    };
+
+    struct HeapKey
+    {
+        qint64  key;  //!< score or latest start time (the lower the sooner)
+        quint64 seq;  //!< FIFO for the same key (keeps the scan order)
+        bool operator>(const HeapKey &other) const
+        {
+            return key > other.key || (key == other.key && seq > other.seq);
+        }
+    };
+
+    QHash<quint64, Item>           _items;
+    mutable std::vector<HeapKey>   _scores;    //!< min heap (entries taken by the other heap are dropped lazily)
+    mutable std::vector<HeapKey>   _deadlines; //!< min heap of the latest start times
+    mutable quint64                _headSeq;   //!< so head() and dequeue() agree even if a deadline becomes due in between
+    quint64                        _lastSeq;
+    qint64                         _frontScore;
+    double                         _throughput; //!< bytes per sec
+    qint64                         _totalSize;  //!< of the entries
+
+public:
+    PackQueue();
+
+    void enqueue(const PackEntry &entry);
+    void prepend(const PackEntry &entry); //!< before everything else
+    inline PackQueue &operator<<(const PackEntry &entry);
+
+    const PackEntry &head() const; //!< mustn't be empty
+    PackEntry dequeue();
+
+    inline bool isEmpty() const;
+    inline int  size() const;
+    inline qint64 totalSize() const;
+
+    void clear();
+    int  removeIf(const EntryFilter &match); //!< returns the number of entries removed
+
+    QList<PackEntry> entries() const; //!< in the order they'd be dequeued now
+
+    inline void setThroughput(double bytesPerSec);
+    inline static qint64 agingMs();
+
+private:
+    quint64 _nextSeq() const;
+    void _push(std::vector<HeapKey> &heap, const HeapKey &key) const;
+    void _dropTaken(std::vector<HeapKey> &heap) const;
+    void _compact();
+    qint64 _latestStart(const PackEntry &entry) const;
+
+    static constexpr qint64 sAgingMs          = 300000; //!< 5 min per priority level
+    static constexpr qint64 sDeadlineMarginMs = 60000;
+    static constexpr double sDefaultThroughput = 20. * 1024 * 1024;
+};
+
+PackQueue &PackQueue::operator<<(const PackEntry &entry)
+{
+    enqueue(entry);
+    return *this;
+}
+
+bool PackQueue::isEmpty() const { return _items.isEmpty(); }
+int  PackQueue::size()    const { return _items.size(); }
+qint64 PackQueue::totalSize() const { return _totalSize; }
+
+void PackQueue::setThroughput(double bytesPerSec)
+{
+    if (bytesPerSec > 0)
+        _throughput = bytesPerSec;
+}
+
+qint64 PackQueue::agingMs() { return sAgingMs; }
+
+#endif // PACKQUEUE_H
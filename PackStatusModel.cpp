@@ -0,0 +1,356 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "PackStatusModel.h"
+#include <QBrush>
+#include <algorithm>
+
+WorkerLaneModel::WorkerLaneModel(const PackStatusModel *status, QObject *parent):
+    QAbstractTableModel(parent),
+    _status(status), _laneRows(), _nbDone()
+{}
+
+int WorkerLaneModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _laneRows.size();
+}
+
+int WorkerLaneModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : NbColumns;
+}
+
+QVariant WorkerLaneModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= _laneRows.size())
+        return QVariant();
+
+    int worker = index.row(), row = _laneRows.at(worker);
+    const PackStatusModel::Row *entry = row < 0 ? nullptr : &_status->_rows.at(row);
+    if (role == Qt::DisplayRole)
+    {
+        switch (index.column())
+        {
+        case ColWorker:  return QString("#%1").arg(worker);
+        case ColState:   return entry ? PackStatusModel::stateStr(entry->state) : tr("idle");
+        case ColEntry:   return entry ? entry->path : QString();
+        case ColElapsed: return entry ? PackStatusModel::_durationStr(_status->_elapsedMs(*entry)) : QString();
+        case ColEta:     return entry ? _status->_etaStr(*entry) : QString();
+        case ColDone:    return _nbDone.at(worker);
+        default:         return QVariant();
+        }
+    }
+    else if (role == Qt::ForegroundRole && entry && _status->_isLate(*entry))
+        return QBrush(Qt::red);
+    else if (role == Qt::TextAlignmentRole && index.column() >= ColElapsed)
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    return QVariant();
+}
+
+QVariant WorkerLaneModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case ColWorker:  return tr("Worker");
+    case ColState:   return tr("State");
+    case ColEntry:   return tr("Entry");
+    case ColElapsed: return tr("Elapsed");
+    case ColEta:     return tr("ETA");
+    case ColDone:    return tr("Packed");
+    default:         return QVariant();
+    }
+}
+
+void WorkerLaneModel::_clear()
+{
+    beginResetModel();
+    _laneRows.clear();
+    _nbDone.clear();
+    endResetModel();
+}
+
+void WorkerLaneModel::_assign(int worker, int row)
+{
+    if (worker < 0)
+        return;
+
+    if (worker >= _laneRows.size())
+    {
+        int nbLanes = _laneRows.size();
+        beginInsertRows(QModelIndex(), nbLanes, worker);
+        _laneRows.resize(worker + 1);
+        _nbDone.resize(worker + 1);
+        for (int lane = nbLanes ; lane <= worker ; ++lane)
+        {
+            _laneRows[lane] = -1;
+            _nbDone[lane]   = 0;
+        }
+        endInsertRows();
+    }
+    _laneRows[worker] = row;
+}
+
+void WorkerLaneModel::_release(int worker, int row, bool packed)
+{
+    if (worker < 0 || worker >= _laneRows.size() || _laneRows.at(worker) != row)
+        return; // already on another entry
+
+    _laneRows[worker] = -1;
+    if (packed)
+        ++_nbDone[worker];
+}
+
+void WorkerLaneModel::_refreshTimes()
+{
+    if (!_laneRows.isEmpty())
+        emit dataChanged(index(0, 0), index(_laneRows.size() - 1, NbColumns - 1));
+}
+
+
+PackStatusModel::PackStatusModel(QObject *parent):
+    QAbstractTableModel(parent),
+    _rows(), _index(), _pending(), _activeRows(),
+    _clock(), _refreshTimer(),
+    _lanes(this)
+{
+    _clock.start();
+    _refreshTimer.setInterval(sRefreshMs);
+    connect(&_refreshTimer, &QTimer::timeout, this, &PackStatusModel::onRefresh);
+}
+
+int PackStatusModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _rows.size();
+}
+
+int PackStatusModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : NbColumns;
+}
+
+QVariant PackStatusModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= _rows.size())
+        return QVariant();
+
+    const Row &row = _rows.at(index.row());
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        switch (index.column())
+        {
+        case ColEntry:  return row.path;
+        case ColState:  return stateStr(row.state);
+        case ColSize:   return QString("%1 MB").arg(row.size / sMB, 0, 'f', 1);
+        case ColWorker: return row.worker < 0 ? QString() : QString("#%1").arg(row.worker);
+        case ColThroughput:
+            if (row.packMs > 0)
+                return QString("%1 MB/s").arg(row.size / sMB / (row.packMs / 1000.), 0, 'f', 1);
+            else if (row.state == State::Packing && row.expectedMs > 0)
+                return QString("~%1 MB/s").arg(row.size / sMB / (row.expectedMs / 1000.), 0, 'f', 1);
+            return QString();
+        case ColElapsed: return _durationStr(_elapsedMs(row));
+        case ColEta:     return _etaStr(row);
+        default:         return QVariant();
+        }
+
+    case Qt::ForegroundRole:
+        if (row.state == State::Failed)
+            return QBrush(Qt::darkRed);
+        else if (_isLate(row))
+            return QBrush(Qt::red);
+        else if (row.state == State::Done)
+            return QBrush(Qt::darkGreen);
+        return QVariant();
+
+    case Qt::ToolTipRole:
+        if (_isLate(row))
+            return tr("packing for %1 while %2 was expected").arg(
+                        _durationStr(_elapsedMs(row))).arg(_durationStr(row.expectedMs));
+        return QVariant();
+
+    case Qt::TextAlignmentRole:
+        if (index.column() == ColSize || index.column() >= ColThroughput)
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        return QVariant();
+
+    default:
+        return QVariant();
+    }
+}
+
+QVariant PackStatusModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case ColEntry:      return tr("Entry");
+    case ColState:      return tr("State");
+    case ColSize:       return tr("Size");
+    case ColWorker:     return tr("Worker");
+    case ColThroughput: return tr("Throughput");
+    case ColElapsed:    return tr("Elapsed");
+    case ColEta:        return tr("ETA");
+    default:            return QVariant();
+    }
+}
+
+void PackStatusModel::update(const QString &path, State state, qint64 size, int worker, qint64 expectedMs)
+{
+    _pending << Update{path, state, size, worker, expectedMs, _clock.elapsed()};
+    if (!_refreshTimer.isActive())
+        _refreshTimer.start();
+}
+
+void PackStatusModel::clear()
+{
+    _refreshTimer.stop();
+    beginResetModel();
+    _rows.clear();
+    _index.clear();
+    _pending.clear();
+    _activeRows.clear();
+    _clock.restart();
+    endResetModel();
+    _lanes._clear();
+}
+
+QString PackStatusModel::stateStr(State state)
+{
+    switch (state)
+    {
+    case State::Queued:    return tr("queued");
+    case State::Packing:   return tr("packing");
+    case State::Checksums: return tr("checksums");
+    case State::Verifying: return tr("verifying");
+    case State::Retrying:  return tr("retrying");
+    case State::Done:      return tr("done");
+    case State::Failed:    return tr("failed");
+    }
+    return QString();
+}
+
+void PackStatusModel::onRefresh()
+{
+    if (_pending.isEmpty() && _activeRows.isEmpty())
+    {
+        _refreshTimer.stop(); // restarted by the next update
+        return;
+    }
+
+    // the new entries are inserted in one go
+    int nbRows = _rows.size();
+    QStringList newPaths;
+    for (const Update &update : _pending)
+    {
+        if (!_index.contains(update.path))
+        {
+            _index.insert(update.path, nbRows + newPaths.size());
+            newPaths << update.path;
+        }
+    }
+    if (!newPaths.isEmpty())
+    {
+        beginInsertRows(QModelIndex(), nbRows, nbRows + newPaths.size() - 1);
+        for (const QString &path : newPaths)
+            _rows << Row{path, State::Queued, 0, -1, -1, -1, -1, 0};
+        endInsertRows();
+    }
+
+    // the running ones have their times changing
+    int firstRow = -1, lastRow = -1;
+    for (int row : _activeRows)
+    {
+        firstRow = firstRow < 0 ? row : std::min(firstRow, row);
+        lastRow  = std::max(lastRow, row);
+    }
+
+    QVector<Update> pending;
+    pending.swap(_pending);
+    for (const Update &update : pending)
+        _apply(update, firstRow, lastRow);
+
+    if (firstRow >= 0)
+        emit dataChanged(index(firstRow, 0), index(lastRow, NbColumns - 1));
+    _lanes._refreshTimes();
+}
+
+void PackStatusModel::_apply(const Update &update, int &firstRow, int &lastRow)
+{
+    int rowIdx = _index.value(update.path);
+    Row &row   = _rows[rowIdx];
+    row.size   = update.size;
+    if (update.state == State::Packing)
+    {
+        row.worker     = update.worker;
+        row.startMs    = update.atMs;
+        row.packMs     = -1;
+        row.endMs      = -1;
+        row.expectedMs = update.expectedMs;
+        _activeRows.insert(rowIdx);
+        _lanes._assign(update.worker, rowIdx);
+    }
+    else
+    {
+        if (row.state == State::Packing)
+            row.packMs = update.atMs - row.startMs;
+        if (update.state == State::Queued || update.state == State::Retrying
+                || update.state == State::Done || update.state == State::Failed)
+        {
+            if (row.startMs >= 0)
+                row.endMs = update.atMs;
+            _activeRows.remove(rowIdx);
+        }
+        // the worker stays busy during the checksums, not during the verification
+        if (update.state != State::Checksums)
+            _lanes._release(row.worker, rowIdx, update.state == State::Verifying || update.state == State::Done);
+    }
+    row.state = update.state;
+
+    firstRow = firstRow < 0 ? rowIdx : std::min(firstRow, rowIdx);
+    lastRow  = std::max(lastRow, rowIdx);
+}
+
+QString PackStatusModel::_etaStr(const Row &row) const
+{
+    if (row.state != State::Packing || row.expectedMs <= 0)
+        return QString();
+
+    qint64 remainingMs = row.expectedMs - _elapsedMs(row);
+    return remainingMs < 0 ? tr("late") : _durationStr(remainingMs);
+}
+
+QString PackStatusModel::_durationStr(qint64 ms)
+{
+    if (ms < 0)
+        return QString();
+
+    qint64 sec = (ms + 500) / 1000;
+    return QString("%1:%2:%3").arg(sec / 3600, 2, 10, QChar('0')).arg(
+                (sec % 3600) / 60, 2, 10, QChar('0')).arg(
+                sec % 60, 2, 10, QChar('0'));
+}
@@ -0,0 +1,156 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef PACKSTATUSMODEL_H
+#define PACKSTATUSMODEL_H
+#include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+class PackStatusModel;
+
+//! one row per rar process with the entry it is working on (fed by PackStatusModel)
+class WorkerLaneModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    friend class PackStatusModel;
+
+public:
+    enum Column {ColWorker = 0, ColState, ColEntry, ColElapsed, ColEta, ColDone, NbColumns};
+
+private:
+    const PackStatusModel *_status;
+    QVector<int>           _laneRows; //!< row of the entry of each worker in _status, -1 when idle
+    QVector<int>           _nbDone;   //!< entries packed by each worker
+
+public:
+    explicit WorkerLaneModel(const PackStatusModel *status, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    void _clear();
+    void _assign(int worker, int row); //!< row -1: idle
+    void _release(int worker, int row, bool packed);
+    void _refreshTimes();              //!< elapsed and eta of the busy lanes
+};
+
+
+//! state of each entry of a run for the dashboard of the GUI.
+//! The packer can update it as often as it wants: the updates are only stored and applied
+//! every sRefreshMs, with one batch of signals for the views, so the GUI doesn't become
+//! the bottleneck of a run of 10k entries
+class PackStatusModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    friend class WorkerLaneModel;
+
+public:
+    enum class State : char {Queued = 0, Packing, Checksums, Verifying, Retrying, Done, Failed};
+    enum Column {ColEntry = 0, ColState, ColSize, ColWorker, ColThroughput, ColElapsed, ColEta, NbColumns};
+
+private:
+    struct Row
+    {
+        QString path;
+        State   state;
+        qint64  size;
+        int     worker;     //!< -1: none yet
+        qint64  startMs;    //!< of the current attempt (on _clock), -1 if not started
+        qint64  packMs;     //!< duration of the compression, -1 until packed
+        qint64  endMs;      //!< -1 until done or failed
+        qint64  expectedMs; //!< predicted duration of the compression, 0 if unknown
+    };
+
+    struct Update
+    {
+        QString path;
+        State   state;
+        qint64  size;
+        int     worker;
+        qint64  expectedMs;
+        qint64  atMs;       //!< on _clock
+    };
+
+    QVector<Row>        _rows;
+    QHash<QString, int> _index;      //!< row of each path
+    QVector<Update>     _pending;    //!< since the last refresh, in order
+    QSet<int>           _activeRows; //!< their times change at each refresh
+    QElapsedTimer       _clock;
+    QTimer              _refreshTimer;
+    WorkerLaneModel     _lanes;
+
+public:
+    explicit PackStatusModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    inline WorkerLaneModel *lanes();
+
+    //! only stored, cheap enough to be called for each event of the packer
+    void update(const QString &path, State state, qint64 size, int worker = -1, qint64 expectedMs = 0);
+    void clear();
+
+    static QString stateStr(State state);
+
+private slots:
+    void onRefresh();
+
+private:
+    void _apply(const Update &update, int &firstRow, int &lastRow);
+
+    inline qint64 _elapsedMs(const Row &row) const; //!< -1 if not started
+    inline bool   _isLate(const Row &row) const;
+    QString _etaStr(const Row &row) const;
+
+    static QString _durationStr(qint64 ms);
+
+    static constexpr int    sRefreshMs      = 100;
+    static constexpr double sStragglerRatio = 1.5; //!< of the expected duration
+    static constexpr double sMB             = 1024. * 1024.;
+};
+
+WorkerLaneModel *PackStatusModel::lanes() { return &_lanes; }
+
+qint64 PackStatusModel::_elapsedMs(const Row &row) const
+{
+    if (row.startMs < 0)
+        return -1;
+    return (row.endMs < 0 ? _clock.elapsed() : row.endMs) - row.startMs;
+}
+
+bool PackStatusModel::_isLate(const Row &row) const
+{
+    return row.state == State::Packing && row.expectedMs > 0
+            && _elapsedMs(row) > sStragglerRatio * row.expectedMs;
+}
+
+#endif // PACKSTATUSMODEL_H
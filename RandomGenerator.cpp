@@ -0,0 +1,110 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "RandomGenerator.h"
+#include <QRandomGenerator>
+#include <QSet>
+#include <algorithm>
+#if defined(Q_OS_LINUX)
+#include <sys/random.h>
+#include <cerrno>
+#endif
+
+const QString RandomGenerator::sDefaultAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+QString RandomGenerator::randomStr(int length, const QString &alphabet)
+{
+    QString str(std::max(0, length), Qt::Uninitialized);
+    quint32 nbLetters = static_cast<quint32>(alphabet.size());
+    for (int i = 0 ; i < str.size() ; ++i)
+        str[i] = alphabet.at(static_cast<int>(uniform(nbLetters)));
+    return str;
+}
+
+QString RandomGenerator::uniqueStr(int length, const QString &alphabet, const TakenCheck &taken)
+{
+    QString str = randomStr(length, alphabet);
+    for (int i = 1 ; i < sMaxTries && taken(str) ; ++i)
+        str = randomStr(length, alphabet);
+    return str;
+}
+
+quint32 RandomGenerator::uniform(quint32 bound)
+{
+    if (bound < 2)
+        return 0;
+
+    // each thread has its own pool: no lock
+    alignas(quint32) thread_local uchar pool[sPoolSize];
+    thread_local int   poolPos = sPoolSize;
+
+    // the draws above the last multiple of bound are rejected, so the modulo isn't biased
+    const bool    oneByte = bound <= 256;
+    const quint64 range   = oneByte ? 256 : (Q_UINT64_C(1) << 32);
+    const quint64 limit   = range - range % bound;
+    const int     nbBytes = oneByte ? 1 : 4;
+    for (;;)
+    {
+        if (poolPos + nbBytes > sPoolSize)
+        {
+            _fill(pool, sPoolSize);
+            poolPos = 0;
+        }
+        quint64 draw = 0;
+        for (int i = 0 ; i < nbBytes ; ++i)
+            draw = (draw << 8) | pool[poolPos++];
+        if (draw < limit)
+            return static_cast<quint32>(draw % bound);
+    }
+}
+
+QString RandomGenerator::cleanAlphabet(const QString &alphabet)
+{
+    QString cleaned;
+    QSet<QChar> seen;
+    for (const QChar &c : alphabet)
+    {
+        if (!seen.contains(c))
+        {
+            seen.insert(c);
+            cleaned.append(c);
+        }
+    }
+    return cleaned;
+}
+
+void RandomGenerator::_fill(uchar *buf, size_t size)
+{
+#if defined(Q_OS_LINUX)
+    size_t filled = 0;
+    while (filled < size)
+    {
+        ssize_t n = ::getrandom(buf + filled, size - filled, 0);
+        if (n > 0)
+            filled += static_cast<size_t>(n);
+        else if (n < 0 && errno != EINTR)
+            break; // old kernel without getrandom
+    }
+    if (filled == size)
+        return;
+#endif
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32 *>(buf), static_cast<qsizetype>(size / sizeof(quint32)));
+}
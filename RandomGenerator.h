@@ -0,0 +1,54 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef RANDOMGENERATOR_H
+#define RANDOMGENERATOR_H
+#include "PureStaticClass.h"
+#include <QString>
+#include <functional>
+
+//! random strings for the archive names and passwords, drawn from the OS CSPRNG
+//! (getrandom on Linux, QRandomGenerator::system elsewhere) through a pool per thread
+//! refilled in bulk. Rejection sampling: every character of the alphabet has the same odds.
+class RandomGenerator : public PureStaticClass
+{
+public:
+    typedef std::function<bool(const QString &str)> TakenCheck;
+
+    static QString randomStr(int length, const QString &alphabet = sDefaultAlphabet);
+
+    //! draws again while taken says the string is already used (up to sMaxTries times)
+    static QString uniqueStr(int length, const QString &alphabet, const TakenCheck &taken);
+
+    static quint32 uniform(quint32 bound); //!< in [0, bound[
+
+    static QString cleanAlphabet(const QString &alphabet); //!< without duplicates (they would be favoured)
+
+    static const QString sDefaultAlphabet;
+
+private:
+    static void _fill(uchar *buf, size_t size);
+
+    static constexpr int sPoolSize = 4096;
+    static constexpr int sMaxTries = 100;
+};
+
+#endif // RANDOMGENERATOR_H
@@ -0,0 +1,114 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "RarFailure.h"
+#include <QStringList>
+
+RarFailure::Kind RarFailure::classify(int exitCode, bool crashed, const QString &errOutput)
+{
+    // the error output is more precise than the exit code (rar uses 2 for most of its fatal errors)
+    if (errOutput.contains("No space left on device", Qt::CaseInsensitive)
+            || errOutput.contains("Disk quota exceeded", Qt::CaseInsensitive)
+            || errOutput.contains("not enough space", Qt::CaseInsensitive))
+        return Kind::NoSpace;
+    if (errOutput.contains("Input/output error", Qt::CaseInsensitive)
+            || errOutput.contains("Stale file handle", Qt::CaseInsensitive)
+            || errOutput.contains("Resource temporarily unavailable", Qt::CaseInsensitive)
+            || errOutput.contains("Connection timed out", Qt::CaseInsensitive))
+        return Kind::Io;
+    if (errOutput.contains("Permission denied", Qt::CaseInsensitive))
+        return exitCode == 9 ? Kind::Destination : Kind::Source;
+
+    if (crashed)
+        return Kind::Killed;
+
+    // cf rar.txt: "Exit values"
+    switch (exitCode)
+    {
+    case 0:   return Kind::None;
+    case 3:   // invalid checksum while reading the source
+    case 5:   // write error
+    case 12:  // read error
+        return Kind::Io;
+    case 8:   return Kind::Memory;
+    case 6:   // file open error
+    case 10:  // no files to add
+        return Kind::Source;
+    case 9:   return Kind::Destination;
+    case 4:   // locked archive
+    case 7:   // wrong command line option
+    case 11:  // wrong password
+        return Kind::Usage;
+    case 255: return Kind::Cancelled;
+    default:  return Kind::Unknown; // 1 (warning), 2 (fatal)...
+    }
+}
+
+int RarFailure::exitCode(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::None:        return 0;
+    case Kind::NoSpace:     // write error
+    case Kind::Io:          return 5;
+    case Kind::Memory:      return 8;
+    case Kind::Source:      return 6;
+    case Kind::Destination: return 9;
+    case Kind::Usage:       return 7;
+    case Kind::Cancelled:   return 255;
+    case Kind::Killed:
+    case Kind::Archive:
+    case Kind::Unknown:     break;
+    }
+    return 2; // fatal error
+}
+
+QString RarFailure::name(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::None:        return "none";
+    case Kind::NoSpace:     return "nospace";
+    case Kind::Io:          return "io";
+    case Kind::Memory:      return "memory";
+    case Kind::Killed:      return "killed";
+    case Kind::Source:      return "source";
+    case Kind::Destination: return "destination";
+    case Kind::Archive:     return "archive";
+    case Kind::Usage:       return "usage";
+    case Kind::Cancelled:   return "cancelled";
+    case Kind::Unknown:     break;
+    }
+    return "unknown";
+}
+
+QString RarFailure::lastLine(const QString &errOutput)
+{
+    const QStringList lines = errOutput.split('\n', Qt::SkipEmptyParts);
+    for (auto it = lines.crbegin(); it != lines.crend(); ++it)
+    {
+        QString line = it->trimmed();
+        if (!line.isEmpty())
+            return line;
+    }
+    return QString();
+}
@@ -0,0 +1,61 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef RARFAILURE_H
+#define RARFAILURE_H
+#include "PureStaticClass.h"
+#include <QString>
+
+//! classification of the failures of rar (from its exit code and its error output)
+//! so that only the transient ones are retried
+class RarFailure : public PureStaticClass
+{
+public:
+    enum class Kind : char {
+        None = 0,
+        NoSpace,     //!< destination full (or quota)
+        Io,          //!< read/write error, stale NFS handle...
+        Memory,      //!< rar ran out of memory
+        Killed,      //!< crashed or killed by a signal (OOM killer...)
+        Source,      //!< source missing or unreadable
+        Destination, //!< archive folder couldn't be created
+        Archive,     //!< archive created but its verification failed
+        Usage,       //!< wrong command line, password...
+        Cancelled,   //!< stopped by the user
+        Unknown
+    };
+
+    static Kind classify(int exitCode, bool crashed, const QString &errOutput);
+    static int  exitCode(Kind kind); //!< the one of rar for that kind (for the failures found without it)
+    static inline bool isTransient(Kind kind); //!< worth retrying later
+
+    static QString name(Kind kind);
+    static QString lastLine(const QString &errOutput); //!< most relevant line for the logs
+};
+
+bool RarFailure::isTransient(Kind kind)
+{
+    return kind == Kind::NoSpace || kind == Kind::Io || kind == Kind::Memory
+            || kind == Kind::Killed || kind == Kind::Unknown;
+}
+
+#endif // RARFAILURE_H
@@ -0,0 +1,333 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "RarStoreWriter.h"
+#include "Crc32.h"
+#include "FileHasher.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <algorithm>
+#include <cerrno>
+#if defined(Q_OS_UNIX)
+#include <sys/stat.h>
+#endif
+#if defined(Q_OS_LINUX)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+constexpr const char RarStoreWriter::sSignature[];
+
+RarFailure::Kind RarStoreWriter::store(const QString &srcPath, const QString &archivePath, QString &err,
+                           const std::atomic<bool> *cancel, Copy *copy, const std::atomic<bool> *hold)
+{
+    QFile src(srcPath), dst(archivePath);
+    if (!src.open(QIODevice::ReadOnly))
+    {
+        err = QString("Cannot open %1: %2").arg(srcPath).arg(src.errorString());
+        return RarFailure::Kind::Source;
+    }
+    if (!dst.open(QIODevice::WriteOnly|QIODevice::Truncate|QIODevice::Unbuffered))
+    {
+        int errNo = errno;
+        err = QString("Cannot create %1: %2").arg(archivePath).arg(dst.errorString());
+        return _ioFailure(errNo, RarFailure::Kind::Destination);
+    }
+
+    QFileInfo  srcInfo(srcPath);
+    QByteArray name  = srcInfo.fileName().toUtf8(); // -ep1
+    quint64    size  = static_cast<quint64>(src.size());
+    quint32    mtime = static_cast<quint32>(srcInfo.lastModified().toSecsSinceEpoch());
+    quint32    mode  = 0x20; // FILE_ATTRIBUTE_ARCHIVE
+    int        blockSize = 0;
+#if defined(Q_OS_UNIX)
+    struct stat srcStat;
+    if (::fstat(src.handle(), &srcStat) == 0)
+        mode = static_cast<quint32>(srcStat.st_mode);
+#endif
+#if defined(Q_OS_LINUX)
+    // no alignment for the huge blocks (NFS...): the headers would get too big for the readers
+    struct stat dstStat;
+    if (::fstat(dst.handle(), &dstStat) == 0 && dstStat.st_blksize > 0 && dstStat.st_blksize <= sMaxAlignment)
+        blockSize = static_cast<int>(dstStat.st_blksize);
+#endif
+
+    // the padding (in an extra record) puts the data on a block boundary so it can be cloned
+    QByteArray head = QByteArray(sSignature, sSignatureSize) + _mainHeader();
+    qint64     fileHeaderPos = head.size();
+    int        padding    = blockSize > 0 ? 0 : -1;
+    QByteArray fileHeader = _fileHeader(name, size, mtime, mode, 0, padding);
+    if (blockSize > 0)
+    {
+        // a few spare bytes for the sizes that get longer with the padding
+        qint64 dataTarget = (fileHeaderPos + fileHeader.size() + 8 + blockSize - 1) / blockSize * blockSize;
+        for (int i = 0 ; i < 4 && fileHeaderPos + fileHeader.size() != dataTarget ; ++i)
+        {
+            padding   += static_cast<int>(dataTarget - fileHeaderPos - fileHeader.size());
+            fileHeader = _fileHeader(name, size, mtime, mode, 0, padding);
+        }
+    }
+    qint64 dataPos = fileHeaderPos + fileHeader.size();
+    if (dst.write(head + fileHeader) != dataPos)
+    {
+        int errNo = errno;
+        err = QString("Write error in %1: %2").arg(archivePath).arg(dst.errorString());
+        return _ioFailure(errNo, RarFailure::Kind::Io);
+    }
+
+    Copy    used    = Copy::Stream;
+    bool    copied  = size == 0;
+    bool    hasCrc  = size == 0;
+    quint32 dataCrc = 0;
+#if defined(Q_OS_LINUX)
+#if defined(FICLONERANGE)
+    if (!copied && blockSize > 0 && dataPos % blockSize == 0)
+    {
+        struct file_clone_range range;
+        range.src_fd      = src.handle();
+        range.src_offset  = 0;
+        range.src_length  = 0; // up to the end
+        range.dest_offset = static_cast<quint64>(dataPos);
+        if (::ioctl(dst.handle(), FICLONERANGE, &range) == 0)
+        {
+            copied = true;
+            used   = Copy::Clone;
+        }
+    }
+#endif
+    if (!copied)
+    {
+        loff_t  srcPos = 0, dstPos = dataPos;
+        quint64 left   = size;
+        while (left > 0)
+        {
+            if (_cancelled(cancel, hold))
+            {
+                err = QString("User break");
+                return RarFailure::Kind::Cancelled;
+            }
+            ssize_t nb = ::copy_file_range(src.handle(), &srcPos, dst.handle(), &dstPos,
+                                           static_cast<size_t>(std::min<quint64>(left, sChunkSize)), 0);
+            if (nb > 0)
+                left -= static_cast<quint64>(nb);
+            else if (nb == 0 || srcPos != 0) // shrunk meanwhile or failed in the middle
+            {
+                int errNo = errno;
+                err = QString("Write error in %1: %2").arg(archivePath).arg(
+                            nb == 0 ? QString("source truncated") : qt_error_string(errNo));
+                return nb == 0 ? RarFailure::Kind::Source : _ioFailure(errNo, RarFailure::Kind::Io);
+            }
+            else
+                break; // not supported between these filesystems: streamed
+        }
+        if (left == 0)
+        {
+            copied = true;
+            used   = Copy::Kernel;
+        }
+    }
+#endif
+    if (!copied)
+    {
+        QByteArray buffer(static_cast<int>(sBufferSize), Qt::Uninitialized);
+        if (!src.seek(0) || !dst.seek(dataPos))
+        {
+            err = QString("Seek error in %1: %2").arg(archivePath).arg(dst.errorString());
+            return RarFailure::Kind::Io;
+        }
+        quint64 left = size;
+        while (left > 0)
+        {
+            if (_cancelled(cancel, hold))
+            {
+                err = QString("User break");
+                return RarFailure::Kind::Cancelled;
+            }
+            qint64 nb = src.read(buffer.data(), static_cast<qint64>(std::min<quint64>(left, sBufferSize)));
+            if (nb <= 0)
+            {
+                err = QString("Read error in %1: %2").arg(srcPath).arg(nb == 0 ? QString("source truncated") : src.errorString());
+                return nb == 0 ? RarFailure::Kind::Source : RarFailure::Kind::Io;
+            }
+            if (dst.write(buffer.constData(), nb) != nb)
+            {
+                int errNo = errno;
+                err = QString("Write error in %1: %2").arg(archivePath).arg(dst.errorString());
+                return _ioFailure(errNo, RarFailure::Kind::Io);
+            }
+            dataCrc = Crc32::update(dataCrc, buffer.constData(), nb);
+            left   -= static_cast<quint64>(nb);
+        }
+        hasCrc = true;
+    }
+
+    if (!hasCrc)
+    {
+        FileHasher::Digests digests = FileHasher::hash(srcPath, FileHasher::CRC32);
+        if (!digests.ok)
+        {
+            err = QString("Read error in %1").arg(srcPath);
+            return RarFailure::Kind::Io;
+        }
+        dataCrc = digests.crc32;
+    }
+
+    // same size: only the CRC32 of the data (and so the one of the header) change
+    if (!dst.seek(fileHeaderPos)
+            || dst.write(_fileHeader(name, size, mtime, mode, dataCrc, padding)) != fileHeader.size()
+            || !dst.seek(dataPos + static_cast<qint64>(size))
+            || dst.write(_endHeader()) <= 0)
+    {
+        int errNo = errno;
+        err = QString("Write error in %1: %2").arg(archivePath).arg(dst.errorString());
+        return _ioFailure(errNo, RarFailure::Kind::Io);
+    }
+
+    if (copy)
+        *copy = used;
+    return RarFailure::Kind::None;
+}
+
+bool RarStoreWriter::_cancelled(const std::atomic<bool> *cancel, const std::atomic<bool> *hold)
+{
+    while (hold && hold->load() && !(cancel && cancel->load()))
+        QThread::msleep(sHoldCheckMs);
+    return cancel && cancel->load();
+}
+
+RarFailure::Kind RarStoreWriter::_ioFailure(int errNo, RarFailure::Kind otherwise)
+{
+#if defined(EDQUOT)
+    if (errNo == EDQUOT)
+        return RarFailure::Kind::NoSpace;
+#endif
+    if (errNo == ENOSPC)
+        return RarFailure::Kind::NoSpace;
+    if (errNo == EIO)
+        return RarFailure::Kind::Io;
+    return otherwise;
+}
+
+QString RarStoreWriter::copyName(Copy copy)
+{
+    switch (copy)
+    {
+    case Copy::Clone:  return "clone";
+    case Copy::Kernel: return "kernel copy";
+    case Copy::Stream: break;
+    }
+    return "stream";
+}
+
+QByteArray RarStoreWriter::_mainHeader()
+{
+    QByteArray fields;
+    _appendVInt(fields, 1); // main archive header
+    _appendVInt(fields, 0); // no extra nor data area
+    _appendVInt(fields, 0); // archive flags: no volume, not solid, no recovery, not locked
+    return _header(fields);
+}
+
+QByteArray RarStoreWriter::_fileHeader(const QByteArray &name, quint64 size, quint32 mtime, quint32 mode,
+                                       quint32 dataCrc, int padding)
+{
+    // libarchive rejects a file header whose extra area only has unknown records:
+    // the modification time comes first, then the padding
+    QByteArray extra, record;
+    _appendVInt(record, sTimeRecord);
+    _appendVInt(record, 0x0003); // unix time format, mtime present
+    _appendUInt32(record, mtime);
+    _appendVInt(extra, static_cast<quint64>(record.size()));
+    extra.append(record);
+    if (padding >= 0)
+    {
+        record.clear();
+        _appendVInt(record, sPaddingRecord);
+        record.append(padding, '\0');
+        _appendVInt(extra, static_cast<quint64>(record.size()));
+        extra.append(record);
+    }
+
+    QByteArray fields;
+    _appendVInt(fields, 2); // file header
+    _appendVInt(fields, 0x0003); // extra and data areas
+    _appendVInt(fields, static_cast<quint64>(extra.size()));
+    _appendVInt(fields, size);   // data size
+    _appendVInt(fields, 0x0006); // file flags: unix mtime and CRC32 present
+    _appendVInt(fields, size);   // unpacked size
+    _appendVInt(fields, mode);
+    _appendUInt32(fields, mtime);
+    _appendUInt32(fields, dataCrc);
+    _appendVInt(fields, 0);      // compression: version 0, method 0 (store)
+#if defined(Q_OS_UNIX)
+    _appendVInt(fields, 1);      // host OS: Unix
+#else
+    _appendVInt(fields, 0);      // host OS: Windows
+#endif
+    _appendVInt(fields, static_cast<quint64>(name.size()));
+    fields.append(name);
+    fields.append(extra);
+    return _header(fields);
+}
+
+QByteArray RarStoreWriter::_endHeader()
+{
+    QByteArray fields;
+    _appendVInt(fields, 5); // end of archive header
+    _appendVInt(fields, 0);
+    _appendVInt(fields, 0); // last volume
+    return _header(fields);
+}
+
+QByteArray RarStoreWriter::_header(const QByteArray &fields)
+{
+    QByteArray sized;
+    _appendVInt(sized, static_cast<quint64>(fields.size()));
+    sized.append(fields);
+
+    QByteArray header;
+    _appendUInt32(header, Crc32::update(0, sized.constData(), sized.size()));
+    header.append(sized);
+    return header;
+}
+
+void RarStoreWriter::_appendVInt(QByteArray &out, quint64 value)
+{
+    // 7 bits per byte, the highest one tells there is another byte
+    do
+    {
+        char byte = static_cast<char>(value & 0x7F);
+        value >>= 7;
+        if (value != 0)
+            byte = static_cast<char>(byte | 0x80);
+        out.append(byte);
+    } while (value != 0);
+}
+
+void RarStoreWriter::_appendUInt32(QByteArray &out, quint32 value)
+{
+    for (int i = 0 ; i < 4 ; ++i)
+        out.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
@@ -0,0 +1,71 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef RARSTOREWRITER_H
+#define RARSTOREWRITER_H
+#include "PureStaticClass.h"
+#include "RarFailure.h"
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+//! writes the RAR5 archive of a single file stored as is, like "rar a -m0 -ep1" without password, volumes,
+//! lock nor recovery record, but without going through rar: the header is padded up to a block boundary so
+//! the data can be cloned (FICLONERANGE on btrfs, XFS...), else it is copied by the kernel (copy_file_range)
+//! or streamed. The CRC32 of the data is always computed from the source.
+class RarStoreWriter : public PureStaticClass
+{
+public:
+    enum class Copy : char {Clone = 0, Kernel, Stream};
+
+    //! cancel is checked between the chunks where it waits while hold is set,
+    //! returns the kind of the failure (None on success) and err its reason (with the system message)
+    static RarFailure::Kind store(const QString &srcPath, const QString &archivePath, QString &err,
+                      const std::atomic<bool> *cancel = nullptr, Copy *copy = nullptr,
+                      const std::atomic<bool> *hold = nullptr);
+
+    static QString copyName(Copy copy);
+
+private:
+    static bool _cancelled(const std::atomic<bool> *cancel, const std::atomic<bool> *hold);
+    static RarFailure::Kind _ioFailure(int errNo, RarFailure::Kind otherwise); //!< NoSpace for a full disk
+
+    static QByteArray _mainHeader();
+    static QByteArray _fileHeader(const QByteArray &name, quint64 size, quint32 mtime, quint32 mode,
+                                  quint32 dataCrc, int padding);
+    static QByteArray _endHeader();
+    static QByteArray _header(const QByteArray &fields); //!< prepends the CRC32 and the size
+
+    static void _appendVInt(QByteArray &out, quint64 value);
+    static void _appendUInt32(QByteArray &out, quint32 value);
+
+    static constexpr const char sSignature[] = "Rar!\x1A\x07\x01\x00"; //!< RAR 5.0 (8 bytes)
+    static constexpr int    sSignatureSize = 8;
+    static constexpr int    sTimeRecord    = 0x03; //!< file time extra record
+    static constexpr int    sPaddingRecord = 0x7F; //!< unknown extra record: skipped by the readers
+    static constexpr int    sMaxAlignment  = 64 * 1024; //!< above, no padding (unrar limits the headers to 2MB)
+    static constexpr qint64 sChunkSize = 64 * 1024 * 1024; //!< between the cancel checks
+    static constexpr qint64 sBufferSize = 1024 * 1024;     //!< streamed copy
+    static constexpr int    sHoldCheckMs = 100;
+};
+
+#endif // RARSTOREWRITER_H
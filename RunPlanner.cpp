@@ -0,0 +1,95 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "RunPlanner.h"
+#include <QDirIterator>
+#include <QFile>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+double RunPlanner::sampleRatio(const PackEntry &entry)
+{
+    qint64 rawSize = 0, compressedSize = 0;
+    if (entry.isDir)
+    {
+        int nbSampled = 0;
+        QDirIterator it(entry.fi.absoluteFilePath(), QDir::Files|QDir::Hidden|QDir::NoSymLinks, QDirIterator::Subdirectories);
+        while (it.hasNext() && nbSampled < sMaxSampledFiles)
+        {
+            if (_sampleFile(it.next(), rawSize, compressedSize))
+                ++nbSampled;
+        }
+    }
+    else
+        _sampleFile(entry.fi.absoluteFilePath(), rawSize, compressedSize);
+
+    if (rawSize == 0)
+        return 1.;
+    return std::min(1., static_cast<double>(compressedSize) / static_cast<double>(rawSize));
+}
+
+bool RunPlanner::_sampleFile(const QString &path, qint64 &rawSize, qint64 &compressedSize)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+        return false;
+
+    // evenly spread so we see the different parts of the file (headers, content...)
+    qint64 fileSize  = file.size();
+    int    nbSamples = fileSize <= sNbSamplesPerFile * sSampleSize ? 1 : sNbSamplesPerFile;
+    qint64 step      = nbSamples > 1 ? (fileSize - sSampleSize) / (nbSamples - 1) : 0;
+    for (int i = 0 ; i < nbSamples ; ++i)
+    {
+        if (!file.seek(i * step))
+            break;
+        QByteArray block = file.read(sSampleSize);
+        if (block.isEmpty())
+            break;
+        rawSize        += block.size();
+        compressedSize += qCompress(block, sZlibLevel).size() - 4; // qCompress prepends the size
+    }
+    return true;
+}
+
+qint64 RunPlanner::simulate(QVector<PlannedEntry> &entries, int nbWorkers)
+{
+    // workers by the time they are free
+    typedef std::pair<qint64, int> FreeWorker;
+    std::priority_queue<FreeWorker, std::vector<FreeWorker>, std::greater<FreeWorker>> workers;
+    for (int i = 0 ; i < std::max(1, nbWorkers) ; ++i)
+        workers.push({0, i});
+
+    qint64 totalMs = 0;
+    for (PlannedEntry &planned : entries)
+    {
+        FreeWorker worker = workers.top();
+        workers.pop();
+        planned.worker  = worker.second;
+        planned.startMs = worker.first;
+        planned.endMs   = worker.first + planned.durationMs;
+        workers.push({planned.endMs, worker.second});
+        totalMs = std::max(totalMs, planned.endMs);
+    }
+    return totalMs;
+}
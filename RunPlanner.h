@@ -0,0 +1,60 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef RUNPLANNER_H
+#define RUNPLANNER_H
+#include "PureStaticClass.h"
+#include "PackEntry.h"
+#include <QVector>
+
+//! estimation of an entry for the dry run
+struct PlannedEntry
+{
+    PackEntry entry;
+    double    ratio;      //!< sampled compressed/raw size
+    qint64    outputSize; //!< estimated size of the archive
+    qint64    durationMs;
+    qint64    startMs;    //!< from the start of the run
+    qint64    endMs;
+    int       worker;
+};
+
+//! tools for the --plan mode: compressibility sampling and simulation of the workers
+class RunPlanner : public PureStaticClass
+{
+public:
+    //! compresses a few blocks spread in the entry (in a few of its files for a folder) with zlib
+    static double sampleRatio(const PackEntry &entry);
+
+    //! the entries are given in the order they'd be dequeued, each goes to the first free worker
+    //! returns the total duration
+    static qint64 simulate(QVector<PlannedEntry> &entries, int nbWorkers);
+
+private:
+    static bool _sampleFile(const QString &path, qint64 &rawSize, qint64 &compressedSize);
+
+    static constexpr int sNbSamplesPerFile = 4;
+    static constexpr int sSampleSize       = 256 * 1024;
+    static constexpr int sMaxSampledFiles  = 8;
+    static constexpr int sZlibLevel        = 1; //!< fast, rar will do a bit better
+};
+
+#endif // RUNPLANNER_H
@@ -20,20 +20,48 @@
 //========================================================================
 
 #include "ScenePacker.h"
-#include "Crc32.h"
+#include "FileHasher.h"
+#ifndef __CLI_ONLY__
 #include "MainWindow.h"
 #include "About.h"
 #include <QApplication>
+#include <QDesktopServices>
+#else
+#include <QCoreApplication>
+#endif
+#include "ExtProcess.h"
+#include "DirScanner.h"
+#include "BackgroundScanner.h"
+#include "EventLog.h"
+#include "RarStoreWriter.h"
+#include <QPointer>
+#include <QRunnable>
+#include <QSocketNotifier>
 #include <QProcess>
 #include <QThread>
 #include <QCommandLineParser>
 #include <QDir>
+#include <QStorageInfo>
+#include <QJsonDocument>
+#include <QFileSystemWatcher>
+#include "JobServer.h"
+#include "Coordinator.h"
+#include "RunPlanner.h"
 #include <QTime>
+#include <algorithm>
 #include <cmath>
 #include <QSettings>
+#include <QTemporaryFile>
+#include <QStandardPaths>
 #include <QDebug>
-#include <QDesktopServices>
 #include <QUrl>
+#include <csignal>
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+int ScenePacker::sSignalPipe[2] = {-1, -1};
 
 const QString ScenePacker::sDonationURL = "https://www.paypal.com/cgi-bin/webscr?cmd=_donations&business=W2C236U6JNTUA&item_name=scenePacker&currency_code=EUR";
 
@@ -59,6 +87,38 @@ const QMap<ScenePacker::Param, QString> ScenePacker::sParamNames =
     {Param::SplitSize,     "volSize"},
     {Param::LockArchive,   "lock"},
     {Param::CompressLevel, "compressLevel"},
+    {Param::AutoLevel,     "autoLevel"},
+    {Param::StoreExt,      "storeExt"},
+    {Param::Par2,          "par2"},
+    {Param::CmdPar2,       "cmdPar2"},
+    {Param::Hashes,        "hashes"},
+    {Param::Verify,        "verify"},
+    {Param::VerifyProcs,   "verifyProcs"},
+    {Param::NameChars,     "nameChars"},
+    {Param::PassChars,     "passChars"},
+    {Param::Nice,          "nice"},
+    {Param::IoClass,       "ioClass"},
+    {Param::CpuAffinity,   "cpus"},
+    {Param::CGroup,        "cgroup"},
+    {Param::Numa,          "numa"},
+    {Param::CheckSpace,    "checkSpace"},
+    {Param::MinFree,       "minFree"},
+    {Param::Watch,         "watch"},
+    {Param::QuietTime,     "quiet"},
+    {Param::Server,        "server"},
+    {Param::Socket,        "socket"},
+    {Param::Submit,        "submit"},
+    {Param::Status,        "status"},
+    {Param::Cancel,        "cancel"},
+    {Param::Coordinator,   "coordinator"},
+    {Param::Worker,        "worker"},
+    {Param::Secret,        "secret"},
+    {Param::Priority,      "prio"},
+    {Param::Plan,          "plan"},
+    {Param::Entries,       "entries"},
+    {Param::Events,        "events"},
+    {Param::Metrics,       "metrics"},
+    {Param::StoreWithRar,  "storeWithRar"},
 
     {Param::Debug,         "debug"},
     {Param::DispSettings,  "dispPaths"},
@@ -70,25 +130,80 @@ const QMap<ScenePacker::Param, QString> ScenePacker::sParamNames =
 const QList<QCommandLineOption> ScenePacker::sCmdOptions = {
     {{"h", sParamNames[Param::Help]},        tr("Help: display syntax")},
     {{"v", sParamNames[Param::Version]},     tr("app version")},
-    {{"i", "input"},                         tr("source folder (can use several -i)"), "input"},
+    {{"i", "input"},                         tr("source folder (can use several -i), optionally with a priority and a deadline in minutes (or h, d): path:prio[:deadline]"), "input"},
     {{"o", sParamNames[Param::DstPath]},     tr("destination folder"), sParamNames[Param::DstPath]},
     {{"x", sParamNames[Param::RarFolder]},   tr("name of the rar folder where the archives will be created within each source folder"), sParamNames[Param::RarFolder]},
     {{"d", sParamNames[Param::Debug]},       tr("display debug information")},
-    {{"t", sParamNames[Param::Threads]},     tr("number of threads (compression in parallel)"), sParamNames[Param::Threads]},
+    {{"t", sParamNames[Param::Threads]},     tr("number of threads (compression in parallel) or auto (the best one for the compression level according to the stats)"), sParamNames[Param::Threads]},
     {{"p", sParamNames[Param::FixedPass]},   tr("use a fixed password for all archives"), sParamNames[Param::FixedPass]},
     {{"s", sParamNames[Param::SplitSize]},   tr("split archive into volume of that size (in MB)"), sParamNames[Param::SplitSize]},
     {{"r", sParamNames[Param::RecoveryPct]}, tr("percentage of recovery records to add to the archives (Winrar -rr option)"), sParamNames[Param::RecoveryPct]},
     {{"l", sParamNames[Param::LockArchive]}, tr("lock archives (Winrar -k option)")},
+    {{"m", sParamNames[Param::CompressLevel]}, tr("compression level (0-5) or auto: store the entries that are already compressed (can use -m 5 -m auto)"), sParamNames[Param::CompressLevel]},
+    { sParamNames[Param::StoreExt],          tr("auto level: extensions to always store, ex: mkv;mp4;jpg (default: the usual video, audio, image and archive ones)"), sParamNames[Param::StoreExt]},
     { sParamNames[Param::GenSfv],            tr("generate sfv file for each archive")},
+    { sParamNames[Param::Par2],              tr("generate par2 files with this percentage of redundancy for each archive"), sParamNames[Param::Par2]},
+    { sParamNames[Param::CmdPar2],           tr("path of the par2 executable (default: the one in the PATH)"), sParamNames[Param::CmdPar2]},
+    { sParamNames[Param::Hashes],            tr("digests of the volumes to write in sidecar files and a json manifest: crc32,md5,sha1,xxh3 (computed in one read)"), sParamNames[Param::Hashes]},
+    { sParamNames[Param::Verify],            tr("test each archive (rar t and its sfv) while packing the next ones, the broken ones are packed again")},
+    { sParamNames[Param::VerifyProcs],       tr("number of archives tested in parallel (default: 1)"), sParamNames[Param::VerifyProcs]},
     { sParamNames[Param::GenName],           tr("generate random name for each archive")},
     { sParamNames[Param::GenPass],           tr("generate random password for each archive")},
     { sParamNames[Param::LengthName],        tr("length of the random name"), sParamNames[Param::LengthName]},
-    { sParamNames[Param::LengthPass],        tr("length of the random password"), sParamNames[Param::LengthPass]}
+    { sParamNames[Param::LengthPass],        tr("length of the random password"), sParamNames[Param::LengthPass]},
+    { sParamNames[Param::NameChars],         tr("characters of the random names (default: letters and digits)"), sParamNames[Param::NameChars]},
+    { sParamNames[Param::PassChars],         tr("characters of the random passwords (default: letters and digits)"), sParamNames[Param::PassChars]},
+    { sParamNames[Param::Nice],              tr("nice level of the rar processes (from -20 to 19)"), sParamNames[Param::Nice]},
+    { sParamNames[Param::IoClass],           tr("io priority of the rar processes: idle, be[:0-7] or rt[:0-7] (Linux only)"), sParamNames[Param::IoClass]},
+    { sParamNames[Param::CpuAffinity],       tr("cpus on which the rar processes can run, ex: 0-3,8 (Linux only)"), sParamNames[Param::CpuAffinity]},
+    { sParamNames[Param::CGroup],            tr("cgroup v2 folder in which to place the rar processes (Linux only)"), sParamNames[Param::CGroup]},
+    { sParamNames[Param::Numa],              tr("spread the rar processes on the NUMA nodes, binding their cpus and memory (Linux only)")},
+    { sParamNames[Param::CheckSpace],        tr("hold the archives back until there is enough free space for them in the destination")},
+    { sParamNames[Param::MinFree],           tr("free space (in MB) to always keep in the destination (implies --checkSpace)"), sParamNames[Param::MinFree]},
+    { sParamNames[Param::Watch],             tr("keep running and pack the new entries of the input folders")},
+    { sParamNames[Param::QuietTime],         tr("watch mode: seconds without changes before packing a new entry (default: 30)"), sParamNames[Param::QuietTime]},
+    { sParamNames[Param::Server],            tr("run as a job server sharing its threads between the jobs submitted by the clients")},
+    { sParamNames[Param::Socket],            tr("name of the local socket of the job server (default: scenePacker)"), sParamNames[Param::Socket]},
+    { sParamNames[Param::Submit],            tr("submit the inputs and options as a job to the server instead of packing them")},
+    { sParamNames[Param::Status],            tr("display the jobs of the server")},
+    { sParamNames[Param::Cancel],            tr("cancel a job of the server"), "jobId"},
+    { sParamNames[Param::Coordinator],       tr("hand out the entries to remote workers connecting on this TCP port (localhost only unless an address is given)"), "[address:]port"},
+    { sParamNames[Param::Worker],            tr("pack the entries of a coordinator (host:port), the paths must be the same on both sides"), "host:port"},
+    { sParamNames[Param::Secret],            tr("file holding the secret shared by the coordinator and its workers (mandatory for both)"), "file"},
+    { sParamNames[Param::Priority],          tr("priority of the entries matching a wildcard: pattern:prio (can use several --prio)"), sParamNames[Param::Priority]},
+    { sParamNames[Param::Plan],              tr("dry run: estimate the duration, the size of the archives and the disk usage without packing")},
+    { sParamNames[Param::Entries],           tr("pack only the entries listed in a file (one path per line, like the failure report of a run)"), sParamNames[Param::Entries]},
+    { sParamNames[Param::Events],            tr("write the events of the runs as JSON lines in a file or an open file descriptor (fd:N)"), sParamNames[Param::Events]},
+    { sParamNames[Param::Metrics],           tr("serve Prometheus metrics on http://127.0.0.1:port/metrics"), sParamNames[Param::Metrics]},
+    { sParamNames[Param::StoreWithRar],      tr("always run rar, even for the single files that are only stored (written in-process otherwise)")}
+};
+
+const QList<ScenePacker::Param> ScenePacker::sJobParams = {
+    Param::DstPath, Param::DstChoice, Param::RarFolder, Param::RarPrefix,
+    Param::GenSfv, Param::GenName, Param::LengthName,
+    Param::GenPass, Param::LengthPass, Param::UseFixedPass, Param::FixedPass,
+    Param::AddRecovery, Param::RecoveryPct,
+    Param::SplitArchive, Param::SplitSize,
+    Param::LockArchive, Param::CompressLevel, Param::AutoLevel, Param::StoreExt,
+    Param::Par2, Param::Hashes, Param::Verify, Param::NameChars, Param::PassChars
 };
 
 
 const QStringList ScenePacker::sRarDefaultArgs = {"a", "-ep1"};
 
+// rar falls back to store for incompressible blocks and scene releases are mostly already compressed
+const double ScenePacker::sCompressRatioEstimates[] = {1., 0.99, 0.98, 0.98, 0.97, 0.97};
+
+// rough figures of rar 5 on one process, the store mode is limited by the disks
+const double ScenePacker::sDefaultThroughputs[] = {200., 60., 40., 25., 18., 12.};
+
+const QStringList ScenePacker::sDefaultStoreExtensions = {
+    "mkv", "mp4", "m4v", "avi", "mov", "wmv", "webm", "ts", "m2ts",
+    "mp3", "aac", "m4a", "ogg", "opus", "flac",
+    "jpg", "jpeg", "png", "gif", "webp",
+    "zip", "rar", "7z", "gz", "bz2", "xz", "zst"
+};
+
 
 ScenePacker::ScenePacker(int &argc, char *argv[]):
     QObject(), CmdOrGuiApp (argc, argv),
@@ -97,15 +212,79 @@ ScenePacker::ScenePacker(int &argc, char *argv[]):
     _extProcs(),
     _entriesToCompress(),
     _nbTotal(0), _nbCompressed(0),
+    _nbStored(0), _savedCpuMs(0),
     _timeStart(),
-    _settings(nullptr),
+    _settings(nullptr), _settingsSnapshot(nullptr), _logFolderReady(false),
     _stopProcess(false),
     _logFile(nullptr), _logStream(),
     _useWinrar(false),
-    _logPerRun(false)
+    _logPerRun(false),
+    _admissionTimer(), _waitingProcs(), _waitingForSpace(false),
+    _watchMode(false), _watcher(nullptr), _polledFolders(),
+    _knownEntries(), _pendingEntries(), _watchTimer(), _idleProcs(),
+    _jobServer(nullptr), _jobs(), _lastJobId(0), _curJob(nullptr),
+    _coordinator(nullptr), _coordClient(nullptr), _coordJobId(0), _abandonedLeases(),
+    _srcPriorities(), _patternPriorities(),
+    _dryRun(false),
+    _throughputModel(QString("%1/%2_stats.csv").arg(sLogFolder).arg(sAppName)),
+    _scanner(nullptr), _checksumPool(),
+    _procEntries(), _verifications(), _verifyProcs(), _verifying(),
+    _paused(false), _maxActive(0), _heldProcs(), _signalNotifier(nullptr),
+    _killTimer(), _quitting(false), _cleanupPool(),
+    _retries(), _retryTimer(), _failures(), _entriesFile(),
+    _events(nullptr), _metrics(), _metricsServer(nullptr),
+    _storePool(), _storeCancel(false),
+    _samplePool(), _sampling(), _sampledRatios(), _samplingProcs()
+{
+    // the settings, the logs folder and the stats are only touched when needed:
+    // --help, --version, --status... or a syntax error shouldn't pay for them
+    _admissionTimer.setSingleShot(true);
+    _admissionTimer.setInterval(sAdmissionRetryMs);
+    connect(&_admissionTimer, &QTimer::timeout, this, &ScenePacker::onAdmissionTimeout);
+    connect(&_watchTimer,     &QTimer::timeout, this, &ScenePacker::onWatchTimeout);
+    _killTimer.setSingleShot(true);
+    _killTimer.setInterval(sKillTimeoutMs);
+    connect(&_killTimer,      &QTimer::timeout, this, &ScenePacker::onKillTimeout);
+    _cleanupPool.setMaxThreadCount(2); // the disks won't go faster with more
+    _samplePool.setMaxThreadCount(2);
+    _retryTimer.setSingleShot(true);
+    connect(&_retryTimer,     &QTimer::timeout, this, &ScenePacker::onRetryTimeout);
+    _setupSignals();
+
+#ifndef __CLI_ONLY__
+    if (_hmi)
+    {
+        _hmi->setWindowTitle(QString("%1 v%2 - %3").arg(sAppName).arg(sVersion).arg(sDesc));
+        _hmi->setWindowIcon(QIcon(":/icons/appIcon.png"));
+        _hmi->setAsciiSignature(sASCII);
+    }
+#endif
+}
+
+ScenePacker::~ScenePacker()
+{
+    _clear();
+    _cleanupPool.waitForDone();
+    if (_events)
+        delete _events; // flushes
+
+    if (_settings)
+    {
+        _settings->sync();
+        delete _settings;
+    }
+
+    if (_dstDir)
+        delete _dstDir;
+}
+
+QSettings *ScenePacker::_config() const
 {
+    if (_settings)
+        return _settings;
+
 #if defined(__MINGW32__) || defined(__MINGW64__)
-    _settings = new QSettings(QString("%1.ini").arg(appName()), QSettings::Format::IniFormat);
+    _settings = new QSettings(QString("%1.ini").arg(sAppName), QSettings::Format::IniFormat);
 #else
     _settings = new QSettings(QSettings::NativeFormat, QSettings::UserScope, sAppName, sVersion);
 #endif
@@ -118,41 +297,52 @@ ScenePacker::ScenePacker(int &argc, char *argv[]):
         _settings->setValue(sParamNames[Param::CmdRar], "/usr/bin/rar");
 #endif
 
-//        setDstFolder("./dst");
-        saveSettings();
-        setThreads(QThread::idealThreadCount()/2);
-        setRarFolder("_rar");
-        setRarPrefix("RAR_");
-        setDispSettings(true);
+        // the setters are not const but it is still the initialisation of the settings
+        ScenePacker *self = const_cast<ScenePacker*>(this);
+//        self->setDstFolder("./dst");
+        self->saveSettings();
+        self->setThreads(QThread::idealThreadCount()/2);
+        self->setRarFolder("_rar");
+        self->setRarPrefix("RAR_");
+        self->setDispSettings(true);
     }
 
     if (_settings->value(sParamNames[Param::LogPerRun]).isValid())
         _logPerRun = _settings->value(sParamNames[Param::LogPerRun]).toBool();
+    return _settings;
+}
+
+void ScenePacker::_initLogFolder() const
+{
+    if (_logFolderReady)
+        return;
 
     if (!QFileInfo(sLogFolder).exists())
         QDir(".").mkdir(sLogFolder);
+    _throughputModel.load();
+    _logFolderReady = true;
+}
 
 
-    if (_hmi)
+bool ScenePacker::_snapshotSettings()
+{
+    // a copy in a temporary ini file that is used and modified instead of the settings
+    QSettings *settings = _config();
+    _settingsSnapshot = new QTemporaryFile(this);
+    if (!_settingsSnapshot->open())
     {
-        _hmi->setWindowTitle(QString("%1 v%2 - %3").arg(sAppName).arg(sVersion).arg(sDesc));
-        _hmi->setWindowIcon(QIcon(":/icons/appIcon.png"));
-        _hmi->setAsciiSignature(sASCII);
+        _error(tr("Couldn't create a copy of the settings: %1").arg(_settingsSnapshot->errorString()));
+        return false;
     }
-}
-
-ScenePacker::~ScenePacker()
-{
-    _clear();
 
-    _settings->sync();
-    delete _settings;
-
-    if (_dstDir)
-        delete _dstDir;
+    QSettings *snapshot = new QSettings(_settingsSnapshot->fileName(), QSettings::Format::IniFormat);
+    for (const QString &key : settings->allKeys())
+        snapshot->setValue(key, settings->value(key));
+    delete settings;
+    _settings = snapshot;
+    return true;
 }
 
-
 bool ScenePacker::parseCommandLine(int argc, char *argv[])
 {
     QString appVersion = QString("%1_v%2").arg(sAppName).arg(sVersion);
@@ -192,13 +382,59 @@ bool ScenePacker::parseCommandLine(int argc, char *argv[])
         return false;
     }
 
-    if (!parser.isSet("input"))
+    QString socketName(sDefaultSocketName);
+    if (parser.isSet(sParamNames[Param::Socket]))
+        socketName = parser.value(sParamNames[Param::Socket]);
+
+    if (parser.isSet(sParamNames[Param::Status]))
+    {
+        _requestServer(socketName, QJsonObject{{"cmd", "status"}});
+        return false;
+    }
+    if (parser.isSet(sParamNames[Param::Cancel]))
+    {
+        _requestServer(socketName, QJsonObject{{"cmd", "cancel"},
+                                               {"job", parser.value(sParamNames[Param::Cancel]).toInt()}});
+        return false;
+    }
+    // the options of a job are for the server only, not for our next runs
+    if (parser.isSet(sParamNames[Param::Submit]) && !_snapshotSettings())
+        return false;
+
+    if (parser.isSet(sParamNames[Param::Events]))
+    {
+        QString err;
+        _events = new EventLog(this);
+        if (!_events->open(parser.value(sParamNames[Param::Events]), err))
+        {
+            _error(tr("Couldn't open the events output %1: %2").arg(parser.value(sParamNames[Param::Events])).arg(err));
+            return false;
+        }
+    }
+
+    if (parser.isSet(sParamNames[Param::Metrics]))
+    {
+        bool ok = false;
+        quint16 port = parser.value(sParamNames[Param::Metrics]).toUShort(&ok);
+        QString err;
+        _metricsServer = new MetricsServer([this](){ return _metricsExposition(); }, this);
+        if (!ok || port == 0 || !_metricsServer->listen(port, err))
+        {
+            _error(tr("Couldn't serve the metrics on port %1: %2").arg(parser.value(sParamNames[Param::Metrics])).arg(
+                       ok ? err : tr("invalid port")));
+            return false;
+        }
+    }
+
+    // the server gets the inputs and destination with each job, the worker from the coordinator
+    bool serverMode = parser.isSet(sParamNames[Param::Server]) || parser.isSet(sParamNames[Param::Worker]);
+    if (!serverMode && !parser.isSet("input") && !parser.isSet(sParamNames[Param::Entries]))
     {
         _error(tr("you need to provide at least one input folder..."));
         return false;
     }
 
-    if (!parser.isSet(sParamNames[Param::DstPath]) && !parser.isSet(sParamNames[Param::RarFolder]))
+    if (!serverMode && !parser.isSet(sParamNames[Param::DstPath]) && !parser.isSet(sParamNames[Param::RarFolder]))
     {
         _error(tr("you need to provide either a destination folder (-o) or the name of the rar folders (-x)"));
         return false;
@@ -208,6 +444,7 @@ bool ScenePacker::parseCommandLine(int argc, char *argv[])
 
     if (parser.isSet(sParamNames[Param::DstPath]))
     {
+        setUseDestinationFolder(true);
         if (!setDstFolder(parser.value(sParamNames[Param::DstPath])))
         {
             _error(tr("Please provide a writable directory for the destination folder"));
@@ -215,28 +452,31 @@ bool ScenePacker::parseCommandLine(int argc, char *argv[])
         }
     }
     else if (parser.isSet(sParamNames[Param::RarFolder]))
+    {
+        setUseDestinationFolder(false);
         setRarFolder(parser.value(sParamNames[Param::RarFolder]));
+    }
 
 
-    _settings->setValue(sParamNames[Param::GenSfv],      parser.isSet(sParamNames[Param::GenSfv]));
-    _settings->setValue(sParamNames[Param::GenName],     parser.isSet(sParamNames[Param::GenName]));
-    _settings->setValue(sParamNames[Param::GenPass],     parser.isSet(sParamNames[Param::GenPass]));
-    _settings->setValue(sParamNames[Param::LockArchive], parser.isSet(sParamNames[Param::LockArchive]));
+    _config()->setValue(sParamNames[Param::GenSfv],      parser.isSet(sParamNames[Param::GenSfv]));
+    _config()->setValue(sParamNames[Param::GenName],     parser.isSet(sParamNames[Param::GenName]));
+    _config()->setValue(sParamNames[Param::GenPass],     parser.isSet(sParamNames[Param::GenPass]));
+    _config()->setValue(sParamNames[Param::LockArchive], parser.isSet(sParamNames[Param::LockArchive]));
 
     if (parser.isSet(sParamNames[Param::FixedPass]))
     {
-        _settings->setValue(sParamNames[Param::UseFixedPass], true);
-        _settings->setValue(sParamNames[Param::FixedPass], parser.value(sParamNames[Param::FixedPass]));
+        _config()->setValue(sParamNames[Param::UseFixedPass], true);
+        _config()->setValue(sParamNames[Param::FixedPass], parser.value(sParamNames[Param::FixedPass]));
     }
     else
-        _settings->setValue(sParamNames[Param::UseFixedPass], false);
+        _config()->setValue(sParamNames[Param::UseFixedPass], false);
 
     bool ok = false;
     if (parser.isSet(sParamNames[Param::LengthName]))
     {
         int nb = parser.value(sParamNames[Param::LengthName]).toInt(&ok);
         if (ok)
-            _settings->setValue(sParamNames[Param::LengthName], nb);
+            _config()->setValue(sParamNames[Param::LengthName], nb);
         else
         {
             _error(tr("you should provide a integer for the length name"));
@@ -247,31 +487,53 @@ bool ScenePacker::parseCommandLine(int argc, char *argv[])
     {
         int nb = parser.value(sParamNames[Param::LengthPass]).toInt(&ok);
         if (ok)
-            _settings->setValue(sParamNames[Param::LengthPass], nb);
+            _config()->setValue(sParamNames[Param::LengthPass], nb);
         else
         {
             _error(tr("you should provide a integer for the length pass"));
             return false;
         }
     }
+    _config()->setValue(sParamNames[Param::NameChars], QString());
+    if (parser.isSet(sParamNames[Param::NameChars]))
+    {
+        QString alphabet = RandomGenerator::cleanAlphabet(parser.value(sParamNames[Param::NameChars]));
+        if (alphabet.size() < 2 || alphabet.contains(QRegularExpression(R"([/\\:*?"<>|])")))
+        {
+            _error(tr("the characters of the random names should be at least 2 and valid in a file name"));
+            return false;
+        }
+        _config()->setValue(sParamNames[Param::NameChars], alphabet);
+    }
+    _config()->setValue(sParamNames[Param::PassChars], QString());
+    if (parser.isSet(sParamNames[Param::PassChars]))
+    {
+        QString alphabet = RandomGenerator::cleanAlphabet(parser.value(sParamNames[Param::PassChars]));
+        if (alphabet.size() < 2)
+        {
+            _error(tr("the random passwords need at least 2 different characters"));
+            return false;
+        }
+        _config()->setValue(sParamNames[Param::PassChars], alphabet);
+    }
     if (parser.isSet(sParamNames[Param::SplitSize]))
     {
         int nb = parser.value(sParamNames[Param::SplitSize]).toInt(&ok);
         if (ok)
-            _settings->setValue(sParamNames[Param::SplitSize], nb);
+            _config()->setValue(sParamNames[Param::SplitSize], nb);
         else
         {
             _error(tr("you should provide a integer for size of the archive volumes"));
             return false;
         }
     }
-    _settings->setValue(sParamNames[Param::SplitArchive], parser.isSet(sParamNames[Param::SplitSize]));
-    _settings->setValue(sParamNames[Param::AddRecovery],  parser.isSet(sParamNames[Param::RecoveryPct]));
+    _config()->setValue(sParamNames[Param::SplitArchive], parser.isSet(sParamNames[Param::SplitSize]));
+    _config()->setValue(sParamNames[Param::AddRecovery],  parser.isSet(sParamNames[Param::RecoveryPct]));
     if (parser.isSet(sParamNames[Param::RecoveryPct]))
     {
         int nb = parser.value(sParamNames[Param::RecoveryPct]).toInt(&ok);
         if (ok)
-            _settings->setValue(sParamNames[Param::RecoveryPct], nb);
+            _config()->setValue(sParamNames[Param::RecoveryPct], nb);
         else
         {
             _error(tr("you should provide a integer for the percentage of recovery records"));
@@ -279,10 +541,174 @@ bool ScenePacker::parseCommandLine(int argc, char *argv[])
         }
     }
 
-    if (parser.isSet(sParamNames[Param::Threads]))
+    _config()->setValue(sParamNames[Param::Nice], 0);
+    if (parser.isSet(sParamNames[Param::Nice]))
     {
-        int nb = parser.value(sParamNames[Param::RecoveryPct]).toInt(&ok);
+        int nb = parser.value(sParamNames[Param::Nice]).toInt(&ok);
+        if (ok && nb >= -20 && nb <= 19)
+            _config()->setValue(sParamNames[Param::Nice], nb);
+        else
+        {
+            _error(tr("you should provide a integer between -20 and 19 for the nice level"));
+            return false;
+        }
+    }
+
+    _config()->setValue(sParamNames[Param::IoClass], QString());
+    if (parser.isSet(sParamNames[Param::IoClass]))
+    {
+        ExtProcess::IoClass ioClass;
+        int ioLevel;
+        if (ExtProcess::parseIoClass(parser.value(sParamNames[Param::IoClass]), ioClass, ioLevel))
+            _config()->setValue(sParamNames[Param::IoClass], parser.value(sParamNames[Param::IoClass]));
+        else
+        {
+            _error(tr("the io priority should be idle, be[:0-7] or rt[:0-7]"));
+            return false;
+        }
+    }
+
+    _config()->setValue(sParamNames[Param::CpuAffinity], QString());
+    if (parser.isSet(sParamNames[Param::CpuAffinity]))
+    {
+        if (!ExtProcess::parseCpuList(parser.value(sParamNames[Param::CpuAffinity]), &ok).isEmpty() && ok)
+            _config()->setValue(sParamNames[Param::CpuAffinity], parser.value(sParamNames[Param::CpuAffinity]));
+        else
+        {
+            _error(tr("you should provide a list of cpus like 0-3,8 for the cpu affinity"));
+            return false;
+        }
+    }
+
+    _config()->setValue(sParamNames[Param::CGroup], QString());
+    if (parser.isSet(sParamNames[Param::CGroup]))
+    {
+        if (ExtProcess().setCGroup(parser.value(sParamNames[Param::CGroup])))
+            _config()->setValue(sParamNames[Param::CGroup], parser.value(sParamNames[Param::CGroup]));
+        else
+        {
+            _error(tr("the cgroup folder should contain a writable cgroup.procs"));
+            return false;
+        }
+    }
+
+    _config()->setValue(sParamNames[Param::Numa], parser.isSet(sParamNames[Param::Numa]));
+
+    _config()->setValue(sParamNames[Param::AutoLevel], false);
+    for (const QString &level : parser.values(sParamNames[Param::CompressLevel]))
+    {
+        int nb = level.toInt(&ok);
+        if (level == "auto")
+            _config()->setValue(sParamNames[Param::AutoLevel], true);
+        else if (ok && nb >= 0 && nb <= 5)
+            _config()->setValue(sParamNames[Param::CompressLevel], nb);
+        else
+        {
+            _error(tr("the compression level should be between 0 and 5 or auto"));
+            return false;
+        }
+    }
+    if (parser.isSet(sParamNames[Param::CmdPar2]) && !setPar2Cmd(parser.value(sParamNames[Param::CmdPar2])))
+    {
+        _error(tr("the par2 executable %1 doesn't exist").arg(parser.value(sParamNames[Param::CmdPar2])));
+        return false;
+    }
+    _config()->setValue(sParamNames[Param::Par2], 0);
+    if (parser.isSet(sParamNames[Param::Par2]))
+    {
+        int nb = parser.value(sParamNames[Param::Par2]).toInt(&ok);
+        if (!ok || nb < 1 || nb > 100)
+        {
+            _error(tr("you should provide a percentage between 1 and 100 for the par2 redundancy"));
+            return false;
+        }
+        else if (!QFileInfo(par2Path()).isExecutable())
+        {
+            _error(tr("par2 not found, please provide its path with --%1").arg(sParamNames[Param::CmdPar2]));
+            return false;
+        }
+        _config()->setValue(sParamNames[Param::Par2], nb);
+    }
+
+    _config()->setValue(sParamNames[Param::Hashes], QString());
+    if (parser.isSet(sParamNames[Param::Hashes]))
+    {
+        FileHasher::parseDigests(parser.value(sParamNames[Param::Hashes]), &ok);
         if (ok)
+            _config()->setValue(sParamNames[Param::Hashes], parser.value(sParamNames[Param::Hashes]));
+        else
+        {
+            _error(tr("the hashes should be a list of crc32, md5, sha1 and xxh3"));
+            return false;
+        }
+    }
+
+    _config()->setValue(sParamNames[Param::Verify], parser.isSet(sParamNames[Param::Verify]));
+    _config()->setValue(sParamNames[Param::StoreWithRar], parser.isSet(sParamNames[Param::StoreWithRar]));
+    _config()->setValue(sParamNames[Param::VerifyProcs], 1);
+    if (parser.isSet(sParamNames[Param::VerifyProcs]))
+    {
+        int nb = parser.value(sParamNames[Param::VerifyProcs]).toInt(&ok);
+        if (ok && nb > 0)
+            _config()->setValue(sParamNames[Param::VerifyProcs], nb);
+        else
+        {
+            _error(tr("you should provide a positive number of verification processes"));
+            return false;
+        }
+    }
+
+    if (parser.isSet(sParamNames[Param::StoreExt]))
+        _config()->setValue(sParamNames[Param::StoreExt],
+                            parser.value(sParamNames[Param::StoreExt]).split(';', Qt::SkipEmptyParts));
+
+    _config()->setValue(sParamNames[Param::MinFree], 0);
+    if (parser.isSet(sParamNames[Param::MinFree]))
+    {
+        int nb = parser.value(sParamNames[Param::MinFree]).toInt(&ok);
+        if (ok && nb >= 0)
+            _config()->setValue(sParamNames[Param::MinFree], nb);
+        else
+        {
+            _error(tr("you should provide a positive integer for the free space to keep"));
+            return false;
+        }
+    }
+    _config()->setValue(sParamNames[Param::CheckSpace],
+                        parser.isSet(sParamNames[Param::CheckSpace]) || parser.isSet(sParamNames[Param::MinFree]));
+
+    _watchMode = parser.isSet(sParamNames[Param::Watch]);
+    _config()->setValue(sParamNames[Param::QuietTime], sDefaultQuietTime);
+    if (parser.isSet(sParamNames[Param::QuietTime]))
+    {
+        int nb = parser.value(sParamNames[Param::QuietTime]).toInt(&ok);
+        if (ok && nb >= 0)
+            _config()->setValue(sParamNames[Param::QuietTime], nb);
+        else
+        {
+            _error(tr("you should provide a positive integer for the quiet time"));
+            return false;
+        }
+    }
+
+    if (parser.isSet(sParamNames[Param::Threads]))
+    {
+        int nb = parser.value(sParamNames[Param::Threads]).toInt(&ok);
+        if (parser.value(sParamNames[Param::Threads]) == "auto")
+        {
+            nb = _stats().bestProcessCount(compressLevel(), QThread::idealThreadCount());
+            if (nb > 0)
+                _log(tr("Using %1 threads: the best for the compression level %2 from the %3 runs in the stats").arg(
+                         nb).arg(compressLevel()).arg(_stats().nbSamples()));
+            else
+            {
+                nb = threads();
+                _log(tr("Not enough runs in the stats for the compression level %1, keeping %2 threads").arg(
+                         compressLevel()).arg(nb));
+            }
+            setThreads(nb);
+        }
+        else if (ok)
             setThreads(nb);
         else
         {
@@ -292,34 +718,99 @@ bool ScenePacker::parseCommandLine(int argc, char *argv[])
     }
 
 
+    clearPatternPriorities();
+    for (const QString &patternPrio : parser.values(sParamNames[Param::Priority]))
+    {
+        if (!addPatternPriority(patternPrio))
+        {
+            _error(tr("you should provide the priority of a pattern as pattern:prio (got '%1')").arg(patternPrio));
+            return false;
+        }
+    }
+
+    clearSourcePriorities();
     QStringList srcFolders;
-    for (const QString &path : parser.values("input"))
+    QJsonArray  priorities; // for the job server
+    for (const QString &input : parser.values("input"))
     {
-        QFileInfo fi(path);
-        if (fi.exists() && fi.isDir() && fi.isReadable())
-            srcFolders << path;
-        else
+        QString path;
+        int     priority = 0;
+        qint64  deadline = 0;
+        if (!_parseInput(input, path, priority, deadline))
+        {
+            _error(tr("the input '%1' is not a readable directory...").arg(input));
+            return false;
+        }
+
+        srcFolders << path;
+        if (priority != 0 || deadline != 0)
+        {
+            setSourcePriority(path, priority, deadline);
+            priorities.append(QJsonObject{{"path",     QFileInfo(path).absoluteFilePath()},
+                                          {"prio",     priority},
+                                          {"deadline", deadline}});
+        }
+    }
+
+    if (parser.isSet(sParamNames[Param::Worker]))
+        return _startWorker(parser.value(sParamNames[Param::Worker]), parser.value(sParamNames[Param::Secret]));
+    else if (serverMode)
+        return _startServer(socketName);
+
+    if (parser.isSet(sParamNames[Param::Plan]))
+    {
+        _plan(srcFolders);
+        return false;
+    }
+
+    if (parser.isSet(sParamNames[Param::Coordinator]))
+        return _startCoordinator(parser.value(sParamNames[Param::Coordinator]), parser.value(sParamNames[Param::Secret]),
+                                 srcFolders);
+
+    _entriesFile.clear();
+    if (parser.isSet(sParamNames[Param::Entries]))
+    {
+        _entriesFile = parser.value(sParamNames[Param::Entries]);
+        if (!QFileInfo(_entriesFile).isReadable())
         {
-            _error(tr("the input '%1' is not a readable directory...").arg(path));
+            _error(tr("the entries file '%1' is not readable...").arg(_entriesFile));
             return false;
         }
     }
 
+    if (parser.isSet(sParamNames[Param::Submit]))
+    {
+        QStringList inputs;
+        for (const QString &srcFolder : srcFolders)
+            inputs << QFileInfo(srcFolder).absoluteFilePath(); // the server doesn't run in our folder
+        _requestServer(socketName, QJsonObject{{"cmd", "submit"},
+                                               {"inputs", QJsonArray::fromStringList(inputs)},
+                                               {"priorities", priorities},
+                                               {"options", QJsonObject::fromVariantHash(_jobOptions())}});
+        return false;
+    }
+
     processFolders(srcFolders);
     return true;
 }
 
 int ScenePacker::startHMI()
 {
+#ifndef __CLI_ONLY__
     _hmi->init(this);
     _hmi->show();
+#endif
     return _app->exec();
 }
 
 void ScenePacker::processFolders(const QStringList &srcFolders)
 {
     _stopProcess = false;
+    _storeCancel = false;
+    _paused      = false;
+    _maxActive   = 0;
 
+    _initLogFolder();
     QIODevice::OpenMode openMode = QIODevice::WriteOnly|QIODevice::Text;
 
     QString logFileName;
@@ -334,15 +825,36 @@ void ScenePacker::processFolders(const QStringList &srcFolders)
         openMode |= QIODevice::Append;
     }
 
+    const QString header = _logPerRun ? "source;destination;archive name;password;crc32"
+                                      : "date;source;destination;archive name;password;crc32";
     bool logFileExists = QFileInfo(logFileName).exists();
+    if (logFileExists && !_logPerRun)
+    {
+        // an history from an older version (other columns) is kept aside rather than mixed with the new lines
+        QFile history(logFileName);
+        if (history.size() == 0)
+            logFileExists = false; // no header yet
+        else if (history.open(QIODevice::ReadOnly|QIODevice::Text) && QString::fromUtf8(history.readLine()).trimmed() != header)
+        {
+            history.close();
+            QString oldName = QString("./%1/%2_history_%3.csv").arg(sLogFolder).arg(sAppName).arg(
+                        QFileInfo(logFileName).lastModified().toString("yyyyMMdd_hhmmss"));
+            if (QFile::rename(logFileName, oldName))
+            {
+                _log(tr("The history has new columns, the previous one is kept in %1").arg(oldName));
+                logFileExists = false;
+            }
+            else
+                _error(tr("Couldn't rename the history %1 that has other columns").arg(logFileName));
+        }
+    }
+
     _logFile = new QFile(logFileName);
     if (_logFile->open(openMode))
     {
         _logStream.setDevice(_logFile);
-        if (_logPerRun)
-            _logStream << "source;destination;archive name;password\n" << flush;
-        else if (!logFileExists)
-            _logStream << "date;source;destination;archive name;password\n" << flush;
+        if (_logPerRun || !logFileExists)
+            _logStream << header << "\n" << flush;
     }
     else
     {
@@ -353,51 +865,65 @@ void ScenePacker::processFolders(const QStringList &srcFolders)
     _timeStart.start();
 
     _entriesToCompress.clear();
+    _knownEntries.clear();
+    _usedNames.clear();
+    _pendingEntries.clear();
     bool isDebug = debug();
-    QString rarSubFolder = rarFolder();
-    bool    useRarFolder = !useDestinationFolder();
-    for (const QString &srcFolder : srcFolders)
-    {
-        if (useRarFolder && !_setRarFolder(srcFolder))
-        {
-            _error(tr("Couldn't create rar folder in: %1").arg(srcFolder));
-            continue;
-        }
-
-        QDir dir(srcFolder);
-        for (const auto &fi : dir.entryInfoList(
-                 QDir::Dirs|QDir::Files|QDir::Readable|QDir::Hidden|QDir::NoDotAndDotDot|QDir::NoSymLinks,
-                 QDir::Name|QDir::DirsFirst))
-        {
-            if (_entryExistInDstFolder(fi))
-            {
-                if (isDebug)
-                    _error(tr("skip %1 has it is already present in destination folder").arg(fi.fileName()));
-            }
-            else if (fi.fileName() != rarSubFolder)
-                _entriesToCompress << fi;
-        }
-
-    }
     _nbCompressed = 0;
-    _nbTotal      = _entriesToCompress.size();
+    _nbStored     = 0;
+    _savedCpuMs   = 0;
+    _retries.clear();
+    _failures.clear();
+    _entriesToCompress.setThroughput(_throughput(compressLevel(), threads())); // for the deadlines
+    if (!_entriesFile.isEmpty())
+        _nbTotal  = _loadEntries(_entriesFile);
+    else if (srcFolders.isEmpty()) // job server or worker: the entries come later, nothing to scan
+        _nbTotal  = 0;
+    else if (_coordinator || _watchMode) // they need the full list straight away
+        _nbTotal  = _scanSrcFolders(srcFolders, 0);
+    else
+        _startBackgroundScan(srcFolders);
 
 
-    if (_hmi)
-        _hmi->setProgressMax(_nbTotal);
+    _hmiProgress(_nbTotal);
+    if (_events)
+        _events->write("run_started", {{"threads", threads()},
+                                       {"total",   _scanner ? -1 : _nbTotal}, // unknown until the end of the scan
+                                       {"inputs",  QJsonArray::fromStringList(srcFolders)}});
+
+    if (_coordinator)
+    {
+        _log(tr("<b>There are %1 items to hand out to the workers</b>").arg(_nbTotal));
+        _coordinator->serve(_entriesToCompress, _jobOptions());
+        _entriesToCompress.clear();
+        return;
+    }
 
+    if (_watchMode && !_jobServer)
+        _startWatching(srcFolders);
 
-    if (_nbTotal > 0)
+    if (_nbTotal > 0 || _keepWorkersAlive())
     {
-        int nbThreads = std::min(threads(), _nbTotal);
+        int nbThreads = _keepWorkersAlive() ? threads() : std::min(threads(), _nbTotal);
         _extProcs.reserve(nbThreads);
-        _log(tr("<b>There are %1 items to compress using %2 threads</b>").arg(_nbTotal).arg(nbThreads));
+        if (_scanner)
+            _log(tr("<b>Scanning the sources and compressing using %1 threads</b>").arg(nbThreads));
+        else
+            _log(tr("<b>There are %1 items to compress using %2 threads</b>").arg(_nbTotal).arg(nbThreads));
+        if (isDebug && numa())
+            _log(tr("%1 NUMA node(s) detected").arg(NumaTopology::nbNodes()));
         for (int i = 0 ; i < nbThreads ; ++i)
         {
-            QProcess *extProc = new QProcess();
+            ExtProcess *extProc = new ExtProcess();
+            extProc->setStandardOutputFile(QProcess::nullDevice()); // only stderr is kept to classify the failures
             connect(extProc, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
                     this, &ScenePacker::onProcFinished, Qt::QueuedConnection); // queued to avoid stack overflow
 
+            if (!_setProcessScheduling(extProc, i))
+                _error(tr("Couldn't place the rar process in the cgroup %1").arg(cgroup()));
+            else if (isDebug && extProc->hasScheduling())
+                _log(tr("rar process #%1 scheduling: %2").arg(i+1).arg(extProc->schedulingStr()));
+
             _extProcs << extProc;
             _processNextFolder(extProc);
         }
@@ -407,9 +933,8 @@ void ScenePacker::processFolders(const QStringList &srcFolders)
         _log(tr("<b>There are no items to compress...</b>"));
         if (_hmi)
         {
-            _hmi->setProgressMax(1);
-            _hmi->setProgress(0);
-            _hmi->setIDLE();
+            _hmiProgress(1);
+            _hmiIdle();
         }
         else
             qApp->quit();
@@ -422,11 +947,41 @@ void ScenePacker::processFolders(const QStringList &srcFolders)
 void ScenePacker::stopProcessing()
 {
     _stopProcess = true;
-    for (QProcess *extProc : _extProcs)
+    _storeCancel = true;
+    _paused      = false;
+    _heldProcs.clear();
+    for (ExtProcess *extProc : _extProcs)
     {
         if (extProc->state()!= QProcess::NotRunning)
+        {
+            extProc->resume(); // SIGTERM would stay pending
             extProc->terminate();
+        }
+    }
+
+    _admissionTimer.stop();
+    _waitingProcs.clear();
+    _idleProcs.clear();
+    _stopWatching();
+    _stopBackgroundScan();
+    _retryTimer.stop();
+    for (const RetryEntry &retry : _retries)
+        _recordFailure(retry.entry, RarFailure::Kind::Cancelled, -1, tr("stopped before its retry"));
+    _retries.clear();
+    _verifications.clear();
+    for (ExtProcess *verifyProc : _verifyProcs)
+    {
+        if (verifyProc->state()!= QProcess::NotRunning)
+        {
+            verifyProc->resume();
+            verifyProc->terminate();
+        }
     }
+    _hmiPaused(false);
+    if (!_extProcs.isEmpty() && _allProcessesDone()) // no finished signal will come to end the run
+        _processNextFolder(_extProcs.first());
+    else if (!_extProcs.isEmpty())
+        _killTimer.start();
 
     if (_hmi)
         _error(tr("Job stopped with %1 0days extracted").arg(_nbCompressed));
@@ -438,6 +993,7 @@ void ScenePacker::stopProcessing()
 void ScenePacker::_log(const QString &msg, bool success)
 {
     _cout << msg << endl << flush;
+#ifndef __CLI_ONLY__
     if (_hmi)
     {
         if (success)
@@ -445,95 +1001,269 @@ void ScenePacker::_log(const QString &msg, bool success)
         else
             _hmi->log(msg);
     }
+#else
+    Q_UNUSED(success)
+#endif
 }
 
 
 void ScenePacker::_error(const QString &msg)
 {
     _cerr << msg << endl << flush;
+#ifndef __CLI_ONLY__
     if (_hmi)
         _hmi->error(msg);
+#endif
 }
 
+void ScenePacker::_hmiProgress(int max)
+{
+#ifndef __CLI_ONLY__
+    if (!_hmi)
+        return;
+    if (max >= 0)
+        _hmi->setProgressMax(max);
+    _hmi->setProgress(_nbCompressed);
+#else
+    Q_UNUSED(max)
+#endif
+}
 
+void ScenePacker::_hmiPaused(bool paused)
+{
+#ifndef __CLI_ONLY__
+    if (_hmi)
+        _hmi->setPaused(paused);
+#else
+    Q_UNUSED(paused)
+#endif
+}
 
-
-void ScenePacker::_clear()
+void ScenePacker::_hmiIdle()
 {
-    if (_logFile)
-    {
-        _logStream.setDevice(nullptr);
+#ifndef __CLI_ONLY__
+    if (_hmi)
+        _hmi->setIDLE();
+#endif
+}
+
+
+
+
+void ScenePacker::_clear()
+{
+    if (_logFile)
+    {
+        _logStream.setDevice(nullptr);
         _logFile->close();
         delete _logFile;
         _logFile = nullptr;
     }
 
-    for (QProcess *extProc : _extProcs)
+    _admissionTimer.stop();
+    _waitingProcs.clear();
+    _waitingForSpace = false;
+    _idleProcs.clear();
+    _heldProcs.clear();
+    _paused = false;
+    _stopWatching();
+    _stopBackgroundScan();
+    _retryTimer.stop();
+    _retries.clear();
+
+    if (_jobServer)
+    {
+        delete _jobServer;
+        _jobServer = nullptr;
+    }
+    if (_coordinator) // we may be in one of their signals
+    {
+        _coordinator->deleteLater();
+        _coordinator = nullptr;
+    }
+    if (_coordClient)
+    {
+        _coordClient->deleteLater();
+        _coordClient = nullptr;
+    }
+    _curJob = nullptr;
+    qDeleteAll(_jobs);
+    _jobs.clear();
+
+    // all of them at once, the ones that don't stop in time are killed
+    _killTimer.stop();
+    QVector<ExtProcess*> runningProcs;
+    for (ExtProcess *extProc : _extProcs + _verifyProcs)
     {
         if (extProc->state()!= QProcess::NotRunning)
         {
+            extProc->resume();
             extProc->terminate();
+            runningProcs << extProc;
+        }
+    }
+    QElapsedTimer stopTimer;
+    stopTimer.start();
+    for (ExtProcess *extProc : runningProcs)
+    {
+        if (!extProc->waitForFinished(static_cast<int>(std::max<qint64>(0, sKillTimeoutMs - stopTimer.elapsed()))))
+        {
+            extProc->kill();
             extProc->waitForFinished();
         }
     }
+
+    _storeCancel = true;
+    _storePool.waitForDone();
+    _checksumPool.waitForDone(); // their results will find their process gone
+    _samplePool.clear();
+    _samplePool.waitForDone();
+    _sampling.clear();
+    _sampledRatios.clear();
+    _samplingProcs.clear();
     qDeleteAll(_extProcs);
     _extProcs.clear();
+    _procEntries.clear();
+    qDeleteAll(_verifyProcs);
+    _verifyProcs.clear();
+    _verifications.clear();
+    _verifying.clear();
 }
 
 
 void ScenePacker::onAbout()
 {
+#ifndef __CLI_ONLY__
     About about(this);
     about.exec();
+#endif
 }
 
 
 void ScenePacker::onDonate()
 {
+#ifndef __CLI_ONLY__
     QDesktopServices::openUrl(sDonationURL);
+#endif
 }
 
 bool ScenePacker::_allProcessesDone() const
 {
-    for (QProcess *extProc: _extProcs)
+    for (ExtProcess *extProc: _extProcs)
     {
-        if (extProc->state() != QProcess::NotRunning)
+        if (extProc->state() != QProcess::NotRunning || extProc->property(sPropertyNbStages).toInt() > 0)
             return false;
     }
-    return true;
+    return _verifying.isEmpty();
+}
+
+bool ScenePacker::_setProcessScheduling(ExtProcess *extProc, int workerIdx)
+{
+    if (nice() != 0)
+        extProc->setNice(nice());
+
+    ExtProcess::IoClass ioPrioClass;
+    int ioLevel;
+    if (!ioClass().isEmpty() && ExtProcess::parseIoClass(ioClass(), ioPrioClass, ioLevel))
+        extProc->setIoPriority(ioPrioClass, ioLevel);
+
+    QVector<int> cpus = ExtProcess::parseCpuList(cpuAffinity());
+    if (!cpus.isEmpty())
+        extProc->setCpuAffinity(cpus);
+
+    // round robin on the nodes (having some of our cpus) so the workers are evenly spread
+    if (numa() && NumaTopology::nbNodes() > 1)
+    {
+        QVector<const NumaNode*> numaNodes = NumaTopology::nodesWithCpus(cpus);
+        if (!numaNodes.isEmpty())
+            extProc->setNumaNode(numaNodes.at(workerIdx % numaNodes.size()));
+    }
+
+    return extProc->setCGroup(cgroup());
 }
 
-void ScenePacker::_processNextFolder(QProcess *extProc)
+void ScenePacker::_processNextFolder(ExtProcess *extProc)
 {
+    // the dispatch is frozen while paused and limited by the throttle
+    if (!_stopProcess && (_paused || (_maxActive > 0 && !_entriesToCompress.isEmpty())))
+    {
+        _applyThrottle(); // the stopped ones go on before we start new ones
+        if (_nbActiveProcs() >= _activeCap())
+        {
+            _heldProcs << extProc;
+            return;
+        }
+    }
+
     if (_stopProcess || _entriesToCompress.isEmpty())
     {
-        if (_allProcessesDone())
+        if (_keepWorkersAlive() && !_stopProcess)
+        {
+            _idleProcs << extProc;
+            if (_coordClient)
+                _coordClient->requestEntry();
+            else if (!_scanner && _verifying.isEmpty() && _idleProcs.size() == _extProcs.size())
+                _log(tr("<b>%1/%2 entries compressed, waiting for new ones...</b>").arg(_nbCompressed).arg(_nbTotal));
+        }
+        else if (_allProcessesDone())
         {
             _clear();
             _logTimeElapsed();
-            if (_hmi)
-            {
-                _hmi->setProgress(_nbCompressed);
-                _hmi->setIDLE();
-            }
-            else
+            _writeFailureReport();
+            _hmiProgress();
+            _hmiIdle();
+            if (!_hmi || _quitting)
                 qApp->quit();
         }
     }
     else
     {
-        // 0.: Get the entry (file or folder) and create the destination folder
-        QFileInfo fi = _entriesToCompress.dequeue();
-        QString dstFolder(_dstFolderForEntry(fi));
+        // the getters return the options of the entry's job
+        _setCurrentJob(_entriesToCompress.head().jobId);
+
+        // the auto level needs the sample of the entry (taken in the pool while it's queued)
+        const PackEntry &head = _entriesToCompress.head();
+        if (_needsSample(head) && !_sampledRatios.contains(head.fi.absoluteFilePath()))
+        {
+            _startSample(head);
+            _samplingProcs << extProc;
+            return;
+        }
+
+        // 0.: Get the entry (file or folder) if there is enough space for it and create the destination folder
+        if (checkSpace())
+        {
+            Admission admission = _admitEntry(extProc, _entriesToCompress.head());
+            if (admission == Admission::Wait)
+                return;
+            else if (admission == Admission::Reject)
+            {
+                PackEntry entry = _entriesToCompress.dequeue();
+                _error(tr("Skip %1 as it can't fit in the destination").arg(entry.fi.absoluteFilePath()));
+                _entryFailed(entry, RarFailure::Kind::NoSpace, tr("can't fit in the destination"));
+                _processNextFolder(extProc);
+                return;
+            }
+        }
+
+        PackEntry entry = _entriesToCompress.dequeue();
+        const QFileInfo &fi = entry.fi;
+        QString dstFolder(_dstFolderForEntry(entry));
         if (!useDestinationFolder() && !_setRarFolder(fi.absolutePath()))
         {
             _error(tr("Couldn't create rar folder in: %1").arg(fi.absolutePath()));
+            _releaseSpace(extProc);
+            _entryFailed(entry, RarFailure::Kind::Destination, tr("couldn't create the rar folder"));
             _processNextFolder(extProc);
+            return;
         }
         if (!_dstDir->mkdir(dstFolder))
         {
             _error(tr("Issue creating dst folder: %1").arg(dstFolder));
+            _releaseSpace(extProc);
+            _entryFailed(entry, RarFailure::Kind::Destination, tr("couldn't create %1").arg(dstFolder));
             _processNextFolder(extProc);
+            return;
         }
 
 
@@ -541,13 +1271,25 @@ void ScenePacker::_processNextFolder(QProcess *extProc)
         if (_useWinrar)
             args << "-ibck"; // to avoid popups ;)
 
-        // 1.: set compression level
-        args << QString("-m%1").arg(compressLevel());
+        // 1.: set compression level (the already compressed entries are stored in auto level)
+        double ratio;
+        int level = _chooseLevel(entry, ratio);
+        args << QString("-m%1").arg(level);
+        if (level != compressLevel())
+        {
+            ++_nbStored;
+            _savedCpuMs += _cpuMsEstimate(compressLevel(), entry.size) - _cpuMsEstimate(0, entry.size);
+            if (debug())
+                _log(tr("%1 is already compressed (%2%), storing it").arg(
+                         fi.fileName()).arg(static_cast<int>(std::round(100. * ratio))));
+        }
+        else if (autoLevel() && level > 0)
+            args << QString("-ms%1").arg(storeExtensions().join(';')); // the mixed folders
 
         // 2.: is there a password?
         QString pass;
         if (genPass())
-            pass = randomStr(lengthPass());
+            pass = randomStr(lengthPass(), passChars());
         else if (useFixedPass() && !fixedPass().isEmpty())
             pass = fixedPass();
         if (!pass.isEmpty())
@@ -558,7 +1300,7 @@ void ScenePacker::_processNextFolder(QProcess *extProc)
             args << QString("-v%1m").arg(splitSize());
 
         // 4.: is it a dir and thus recursive?
-        if (fi.isDir())
+        if (entry.isDir)
             args << "-r";
 
         // 5.: shall we lock the archive?
@@ -570,18 +1312,21 @@ void ScenePacker::_processNextFolder(QProcess *extProc)
             args << QString("-rr%1p").arg(recoveryPct());
 
         // 7.: destination
-        QString archiveName = _archiveName(fi);
+        QString archiveName = _archiveName(entry);
         dstFolder = QString("%1/%2").arg(_dstDir->absolutePath()).arg(dstFolder);
         args << QString("%1/%2").arg(dstFolder).arg(archiveName);
 
         // 8.: add the entry
         args << fi.absoluteFilePath();
 
-        if (debug())
+        bool inProcess = _canStoreInProcess(entry, level, pass);
+        if (debug() && inProcess)
+            _log(tr("store %1 in %2/%3 (in-process)").arg(fi.absoluteFilePath()).arg(dstFolder).arg(archiveName));
+        else if (debug())
             _log(QString("%1 %2").arg(rarPath()).arg(args.join(" ")));
         else
         {
-            QString msg = tr("- Compressing %1").arg(fi.absoluteFilePath());
+            QString msg = (inProcess ? tr("- Storing %1") : tr("- Compressing %1")).arg(fi.absoluteFilePath());
             if (genName())
                 msg += tr(" to %1").arg(archiveName);
             if (!pass.isEmpty())
@@ -593,190 +1338,2381 @@ void ScenePacker::_processNextFolder(QProcess *extProc)
         extProc->setProperty(sPropertyDstFolder,   dstFolder);
         extProc->setProperty(sPropertyArchiveName, archiveName.left(archiveName.size()-4)); // remove ".rar"
         extProc->setProperty(sPropertyPassword,    pass);
-        extProc->start(rarPath(), args);
+        extProc->setProperty(sPropertyJobId,       entry.jobId);
+        extProc->setProperty(sPropertyLeaseId,     entry.leaseId);
+        extProc->setProperty(sPropertyInputSize,   entry.size);
+        extProc->setProperty(sPropertyLevel,       level);
+        extProc->setProperty(sPropertyNbProcs,     1 + std::count_if(_extProcs.cbegin(), _extProcs.cend(), [](ExtProcess *proc){
+                                 return proc->isBusy(); }));
+        if (_curJob)
+        {
+            _curJob->state = PackJob::State::Running;
+            ++_curJob->nbRunning;
+        }
+        _procEntries.insert(extProc, entry);
+        extProc->setProperty(sPropertyInProcess, inProcess);
+        if (_hmi)
+        {
+            double throughput = _throughput(level, extProc->property(sPropertyNbProcs).toInt());
+            if (addRecovery() && recoveryPct() > 0)
+                throughput /= 1. + recoveryPct() / 100.;
+            _entryStatus(entry, PackStatusModel::State::Packing, _extProcs.indexOf(extProc),
+                         static_cast<qint64>(1000. * entry.size / throughput));
+        }
+        if (_events)
+            _entryEvent("started", entry, {{"worker",   _extProcs.indexOf(extProc)},
+                                           {"dstFolder", dstFolder},
+                                           {"archive",  archiveName},
+                                           {"level",    level},
+                                           {"inProcess", inProcess},
+                                           {"attempt",  entry.attempts + 1}});
+        if (inProcess)
+            _startStore(extProc, fi.absoluteFilePath(), QString("%1/%2").arg(dstFolder).arg(archiveName));
+        else
+            extProc->start(rarPath(), args);
     }
 }
 
 
 
-bool ScenePacker::_entryExistInDstFolder(const QFileInfo &fi)
-{
-    QString dstFolderPath = QString("%1/%2").arg(_dstDir->absolutePath()).arg(_dstFolderForEntry(fi));
-    return QFileInfo(dstFolderPath).exists();
-}
-
 void ScenePacker::onProcFinished(int exitCode)
 {    
+    ExtProcess *extProc = static_cast<ExtProcess*>(sender());
+    _metrics.busySec += extProc->wallMs() / 1000.;
+    if (extProc->spawnMs() >= 0)
+        _metrics.spawnSec.observe(extProc->spawnMs() / 1000.);
+    if (extProc->property(sPropertyPar2).toBool())
+    {
+        _par2Finished(extProc, exitCode, extProc->exitStatus() == QProcess::CrashExit);
+        return;
+    }
+
+    _rarFinished(extProc, exitCode, extProc->exitStatus() == QProcess::CrashExit,
+                 QString::fromLocal8Bit(extProc->readAllStandardError()), extProc->wallMs(), extProc->cpuMs());
+}
+
+void ScenePacker::_rarFinished(ExtProcess *extProc, int exitCode, bool crashed, const QString &errOutput,
+                               qint64 wallMs, qint64 cpuMs, RarFailure::Kind failure)
+{
     qDebug() << "rar exit code: " <<  exitCode;
 
     ++_nbCompressed;
-    if (_hmi)
-        _hmi->setProgress(_nbCompressed);
-
-    QProcess *extProc = static_cast<QProcess*>(sender());
-    QString dstFolder = extProc->property(sPropertyDstFolder).toString();
-    if (exitCode != 0)
+    _hmiProgress();
+
+    int jobId = extProc->property(sPropertyJobId).toInt();
+    _setCurrentJob(jobId);
+    _releaseSpace(extProc);
+    QString dstFolder   = extProc->property(sPropertyDstFolder).toString();
+    QString archiveName = extProc->property(sPropertyArchiveName).toString();
+    extProc->setProperty(sPropertyCrcs, QStringList());
+    if (_isAbandoned(_procEntries.value(extProc)))
     {
-        _error(tr("Error during compression of %1: #%2").arg(dstFolder).arg(exitCode));
-
-        QDir dir(dstFolder);
-        if (!dir.removeRecursively())
-            _error(tr("Error removing broken folder %1").arg(dstFolder));
+        _entryPacked(extProc, false, QStringList()); // dropped: its destination belongs to another worker now
+        return;
+    }
+    if (exitCode != 0 || crashed)
+    {
+        RarFailure::Kind kind = _stopProcess ? RarFailure::Kind::Cancelled
+                              : failure != RarFailure::Kind::None ? failure
+                              : RarFailure::classify(exitCode, crashed, errOutput);
+        QString detail = RarFailure::lastLine(errOutput);
+        _error(tr("Error during compression of %1: #%2 (%3)%4").arg(dstFolder).arg(exitCode).arg(
+                   RarFailure::name(kind)).arg(detail.isEmpty() ? QString() : QString(": %1").arg(detail)));
+        if (_discardFolder(dstFolder) && _retryLater(extProc, kind))
+            return;
+        _recordFailure(_procEntries.value(extProc), kind, exitCode, detail);
+        exitCode = exitCode == 0 ? -1 : exitCode; // crashed
     }
     else
     {
-        QString archiveName = extProc->property(sPropertyArchiveName).toString();
-        if (!_logPerRun)
-            _logStream << QDateTime::currentDateTime().toString("yyyy/MM/dd hh:mm:ss") << ";";
-        _logStream << extProc->property(sPropertySrcFolder).toString() << ";"
-                   << dstFolder << ";"
-                   << archiveName << ";"
-                   << extProc->property(sPropertyPassword).toString()
-                   << endl << flush;
-
-        if (genSfv())
-            _createSfv(dstFolder, archiveName);
+        // the in-process copies would distort the throughput model of rar
+        qint64 outputSize = extProc->property(sPropertyInProcess).toBool() ? DirScanner::folderSize(dstFolder)
+                                                                            : _recordRun(extProc, dstFolder);
+        _metrics.bytesIn  += static_cast<quint64>(extProc->property(sPropertyInputSize).toLongLong());
+        _metrics.bytesOut += static_cast<quint64>(outputSize);
+        _metrics.compressSec.observe(wallMs / 1000.);
+        if (_events)
+            _entryEvent("packed", _procEntries.value(extProc), {{"dstFolder", dstFolder},
+                                                                {"bytesOut",  outputSize},
+                                                                {"wallMs",    wallMs},
+                                                                {"cpuMs",     cpuMs}});
+
+        // par2 runs on the same process while the pool computes the checksums: the volumes are read once from the disk
+        if (par2Pct() > 0 && !_stopProcess && _startPar2(extProc, dstFolder))
+            extProc->setProperty(sPropertyNbStages, extProc->property(sPropertyNbStages).toInt() + 1);
+        if (genSfv() || hashes() != 0)
+            _startChecksums(extProc, dstFolder, archiveName);
+        if (extProc->property(sPropertyNbStages).toInt() > 0)
+        {
+            _entryStatus(_procEntries.value(extProc), PackStatusModel::State::Checksums);
+            return; // we'll be back in _stageDone
+        }
     }
 
+    _entryPacked(extProc, exitCode == 0, QStringList());
+}
 
-    _processNextFolder(extProc);
+void ScenePacker::_startChecksums(ExtProcess *extProc, const QString &dstFolder, const QString &archiveName)
+{
+    //! computes them in the pool and posts the result back to the event loop
+    class ChecksumTask : public QRunnable
+    {
+    private:
+        ScenePacker         *_packer;
+        QPointer<ExtProcess> _extProc; //!< it is deleted if the run is stopped meanwhile
+        const NumaNode      *_numaNode;
+        const QString        _dstFolder;
+        const QString        _archiveName;
+        const int            _digests;
+        const bool           _manifest;
+
+    public:
+        ChecksumTask(ScenePacker *packer, ExtProcess *extProc, const QString &dstFolder,
+                     const QString &archiveName, int digests, bool manifest):
+            _packer(packer), _extProc(extProc), _numaNode(extProc->numaNode()),
+            _dstFolder(dstFolder), _archiveName(archiveName), _digests(digests), _manifest(manifest)
+        {}
+
+        void run() override
+        {
+            QElapsedTimer timer;
+            timer.start();
+            QStringList errors, crcs;
+            {
+                // on the node that has just written the volumes (their pages are in its memory)
+                NumaBinder numaBinder(_numaNode);
+                crcs = ScenePacker::_createChecksums(_dstFolder, _archiveName, _digests, _manifest, errors);
+            }
+            ScenePacker *packer  = _packer;
+            QPointer<ExtProcess> extProc = _extProc;
+            qint64 durationMs = timer.elapsed();
+            QMetaObject::invokeMethod(packer, [packer, extProc, crcs, errors, durationMs]{
+                if (!extProc)
+                    return;
+                for (const QString &error : errors)
+                    packer->_error(error);
+                packer->_metrics.sfvSec.observe(durationMs / 1000.);
+                if (packer->_events)
+                    packer->_entryEvent("sfv_done", packer->_procEntries.value(extProc), {{"ms",     durationMs},
+                                                                                         {"files",  crcs.size()},
+                                                                                         {"errors", errors.size()}});
+                extProc->setProperty(sPropertyCrcs, crcs);
+                packer->_stageDone(extProc);
+            }, Qt::QueuedConnection);
+        }
+    };
+
+    int digests = hashes();
+    if (genSfv())
+        digests |= FileHasher::CRC32;
+
+    extProc->setProperty(sPropertyNbStages, extProc->property(sPropertyNbStages).toInt() + 1);
+    _checksumPool.start(new ChecksumTask(this, extProc, dstFolder, archiveName, digests, hashes() != 0));
 }
 
-void ScenePacker::_createSfv(const QString &folder, const QString &sfvFileName)
+void ScenePacker::_stageDone(ExtProcess *extProc)
 {
-    QString sfvPath = QString("%1/%2.sfv").arg(folder).arg(sfvFileName);
-    QFile sfvFile(sfvPath);
-    if (sfvFile.open(QIODevice::WriteOnly|QIODevice::Text))
+    int nbStages = extProc->property(sPropertyNbStages).toInt() - 1;
+    extProc->setProperty(sPropertyNbStages, nbStages);
+    if (nbStages == 0)
     {
-        QTextStream stream(&sfvFile);
-        QDir dir(folder);
-        for (const QFileInfo &fi : dir.entryInfoList({"*.rar"}, QDir::Files|QDir::NoSymLinks,  QDir::Name))
-            stream << fi.fileName() << " "
-                   << QString("%1").arg(Crc32::getCRC32(fi.absoluteFilePath()), 8, 16, QChar('0'))
-                   << endl;
+        _setCurrentJob(extProc->property(sPropertyJobId).toInt());
+        _entryPacked(extProc, true, extProc->property(sPropertyCrcs).toStringList());
     }
-    else
-        _error(tr("Error creating sfv file %1").arg(sfvPath));
 }
 
-void ScenePacker::_syntax(char *appName)
+bool ScenePacker::_startPar2(ExtProcess *extProc, const QString &dstFolder)
 {
-    QString app = QFileInfo(appName).fileName();
-    _cout << desc() << "\n"
-          << tr("Syntax: ") << app << " (options)* (-i <src_folder>)+ (-o <dst_path>| -x <rar_folder>)\n";
-    for (const QCommandLineOption & opt : sCmdOptions)
+    // the destination folder only contains the volumes of the archive (the sfv is created after)
+    QStringList volumes = QDir(dstFolder).entryList({"*.rar"}, QDir::Files|QDir::NoSymLinks, QDir::Name);
+    if (volumes.isEmpty())
+        return false;
+    else if (!QFileInfo(par2Path()).isExecutable())
     {
-        if (opt.names().size() == 1)
-            _cout << QString("\t--%1: %2\n").arg(opt.names().first(), -17).arg(tr(opt.description().toLocal8Bit().constData()));
-        else
-            _cout << QString("\t-%1: %2\n").arg(opt.names().join(" or --"), -18).arg(tr(opt.description().toLocal8Bit().constData()));
+        _error(tr("par2 not found, no recovery files for %1").arg(dstFolder));
+        return false;
     }
-    _cout << "\n"
-          << "Examples: \n"
-          << "  1.: using dst path:   " << appName << " -i ~/Downloads/folder1 -i ~/Downloads/folder2 -o /tmp/archives --genName --genPass --lengthPass 17\n"
-          << "  2.: using rar folder: " << appName << " -i ~/Downloads/folder1 -i ~/Downloads/folder2 -x _rar --sfv\n"
-          << endl
-          << "The first example will create all archives from both folder1 and folder2 inside the destination folder /tmp/archives\n"
-          << "The second example, will create a '_rar' folder in both folder1 et folder2 with their respective archives\n"
-          << endl << flush;
-}
 
+    QStringList args = {"create", "-q", QString("-r%1").arg(par2Pct()), "--",
+                        QString("%1.par2").arg(extProc->property(sPropertyArchiveName).toString())};
+    args << volumes;
+    if (debug())
+        _log(QString("%1 %2").arg(par2Path()).arg(args.join(" ")));
 
-void ScenePacker::_logTimeElapsed()
+    extProc->setProperty(sPropertyPar2, true);
+    extProc->setWorkingDirectory(dstFolder); // so the par2 files have the plain names of the volumes
+    extProc->start(par2Path(), args);
+    return true;
+}
+
+void ScenePacker::_par2Finished(ExtProcess *extProc, int exitCode, bool crashed)
 {
-    int duration = static_cast<int>(_timeStart.elapsed());
-    double sec = static_cast<double>(duration)/1000.;
+    QString dstFolder = extProc->workingDirectory();
+    extProc->setProperty(sPropertyPar2, false);
+    extProc->setWorkingDirectory(QString());
+    extProc->readAllStandardError(); // so it doesn't end up with the output of the next rar
+    _setCurrentJob(extProc->property(sPropertyJobId).toInt());
+
+    // the archive is fine without them but not with broken ones
+    if ((exitCode != 0 || crashed) && !_isAbandoned(_procEntries.value(extProc)))
+    {
+        QDir dir(dstFolder);
+        for (const QString &par2File : dir.entryList({"*.par2"}, QDir::Files))
+            dir.remove(par2File);
 
-    _log(tr("<br/><b> => %1/%2 entries compressed in %3 sec (%4)</b>").arg(
-             _nbCompressed).arg(_nbTotal).arg(
-             std::round(sec)).arg(QTime::fromMSecsSinceStartOfDay(duration).toString("hh:mm:ss.zzz")));
+        if (_stopProcess)
+            _log(tr("Par2 files of %1 not created: stopped").arg(dstFolder));
+        else
+            _error(tr("Error creating the par2 files of %1: #%2%3").arg(dstFolder).arg(exitCode).arg(
+                       crashed ? tr(" (crashed)") : QString()));
+    }
+
+    _stageDone(extProc);
 }
 
+bool ScenePacker::_canStoreInProcess(const PackEntry &entry, int level, const QString &pass) const
+{
+    // what rar would do is only a copy with a header
+    return level == 0 && !entry.isDir && pass.isEmpty() && !storeWithRar()
+            && !(splitArchive() && splitSize() > 0) && !lockArchive() && !(addRecovery() && recoveryPct() > 0);
+}
 
-void ScenePacker::setThreads(int nb)
+void ScenePacker::_startStore(ExtProcess *extProc, const QString &srcPath, const QString &archivePath)
 {
-    if( nb < 1)
-        nb  = 1;
-    else if (nb > QThread::idealThreadCount())
-        nb = QThread::idealThreadCount();
+    //! writes the archive in the pool and posts the result back like a rar process would
+    class StoreTask : public QRunnable
+    {
+    private:
+        ScenePacker         *_packer;
+        QPointer<ExtProcess> _extProc;
+        const std::atomic<bool> *_held; //!< by pauseProcessing and the throttle (_clear waits for us)
+        const QString        _srcPath;
+        const QString        _archivePath;
+
+    public:
+        StoreTask(ScenePacker *packer, ExtProcess *extProc, const QString &srcPath, const QString &archivePath):
+            _packer(packer), _extProc(extProc), _held(extProc->held()), _srcPath(srcPath), _archivePath(archivePath)
+        {}
+
+        void run() override
+        {
+            QElapsedTimer timer;
+            timer.start();
+            QString err;
+            RarStoreWriter::Copy copy = RarStoreWriter::Copy::Stream;
+            RarFailure::Kind failure = RarStoreWriter::store(_srcPath, _archivePath, err,
+                                                             &_packer->_storeCancel, &copy, _held);
+
+            ScenePacker *packer  = _packer;
+            QPointer<ExtProcess> extProc = _extProc;
+            qint64 durationMs = timer.elapsed();
+            QMetaObject::invokeMethod(packer, [packer, extProc, failure, err, durationMs, copy]{
+                if (!extProc)
+                    return;
+                packer->_storeFinished(extProc, failure, err, durationMs, copy);
+            }, Qt::QueuedConnection);
+        }
+    };
 
-    _settings->setValue(sParamNames[Param::Threads], nb);
+    // like a running process for _allProcessesDone, the throttle and the pause
+    extProc->setProperty(sPropertyNbStages, extProc->property(sPropertyNbStages).toInt() + 1);
+    extProc->setInProcess(true);
+    _storePool.start(new StoreTask(this, extProc, srcPath, archivePath));
 }
 
+void ScenePacker::_storeFinished(ExtProcess *extProc, RarFailure::Kind failure, const QString &err, qint64 durationMs,
+                                 RarStoreWriter::Copy copy)
+{
+    extProc->setProperty(sPropertyNbStages, extProc->property(sPropertyNbStages).toInt() - 1);
+    extProc->setInProcess(false);
+    _metrics.busySec += durationMs / 1000.;
+    if (failure == RarFailure::Kind::None && debug())
+        _log(tr("%1 stored in-process (%2) in %3 ms").arg(
+                 extProc->property(sPropertySrcFolder).toString()).arg(RarStoreWriter::copyName(copy)).arg(durationMs));
+
+    // exit code of rar for the logs and the history, the failure is already classified by the writer
+    _rarFinished(extProc, RarFailure::exitCode(failure), false, err, durationMs, -1, failure);
+}
 
-bool ScenePacker::setRarCmd(const QString &path)
+void ScenePacker::_entryPacked(ExtProcess *extProc, bool success, const QStringList &crcs)
 {
-    QFileInfo fi(path);
-    if (fi.exists() && fi.isFile() && fi.isExecutable())
+    PackedEntry packed = {
+        _procEntries.take(extProc),
+        extProc->property(sPropertyDstFolder).toString(),
+        extProc->property(sPropertyArchiveName).toString(),
+        extProc->property(sPropertyPassword).toString(),
+        crcs
+    };
+
+    // the rar process goes on with the next entry while the archive is tested
+    if (_isAbandoned(packed.entry))
+        _dropEntry(packed.entry, true);
+    else if (success && verify() && !_stopProcess)
     {
-        _settings->setValue(sParamNames[Param::CmdRar], path);
-        if (path.toLower().endsWith("winrar.exe"))
-            _useWinrar = true;
-        return true;
+        _verifications.enqueue(packed);
+        _entryStatus(packed.entry, PackStatusModel::State::Verifying);
+        _startVerifications();
     }
     else
-        return false;
+        _entryDone(packed, success);
+
+    if (!_entriesToCompress.isEmpty() && !debug())
+        _log(tr("%1/%2 entries compressed, ETA: %3").arg(_nbCompressed).arg(_nbTotal).arg(_durationStr(_etaMs())));
+    if (_events)
+        _events->write("progress", {{"done",    _nbCompressed},
+                                    {"total",   _nbTotal},
+                                    {"queued",  _entriesToCompress.size()},
+                                    {"etaMs",   _etaMs()}});
+    _processNextFolder(extProc);
 }
 
-void ScenePacker::setSrcFolder(const QString &srcFolder)
+void ScenePacker::_entryDone(const PackedEntry &packed, bool success)
 {
-    _settings->setValue(sParamNames[Param::SrcFolder], srcFolder);
+    const PackEntry &entry = packed.entry;
+    if (success)
+        ++_metrics.nbDone;
+    else
+        _knownEntries.remove(entry.fi.absoluteFilePath()); // tried again when detected
+    _entryStatus(entry, success ? PackStatusModel::State::Done : PackStatusModel::State::Failed);
+    if (_events)
+        _entryEvent("finished", entry, {{"ok",        success},
+                                        {"dstFolder", packed.dstFolder},
+                                        {"archive",   packed.archiveName},
+                                        {"attempts",  entry.attempts + 1}});
+    if (success)
+        _writeHistory(entry.fi.absoluteFilePath(), packed.dstFolder, packed.archiveName, packed.password, packed.crcs);
+
+    if (entry.leaseId != 0 && _coordClient)
+        _coordClient->sendResult(entry.leaseId, success, packed.dstFolder, packed.archiveName, packed.password, packed.crcs);
+
+    _jobEntryDone(entry.jobId, success, true);
 }
 
-void ScenePacker::setRarFolder(const QString &folderName)
+void ScenePacker::_startVerifications()
 {
-    _settings->setValue(sParamNames[Param::RarFolder], folderName);
+    while (!_verifications.isEmpty() && !_stopProcess && !_paused)
+    {
+        ExtProcess *verifyProc = nullptr;
+        for (ExtProcess *proc : _verifyProcs)
+        {
+            if (!_verifying.contains(proc))
+            {
+                verifyProc = proc;
+                break;
+            }
+        }
+        if (!verifyProc)
+        {
+            if (_verifyProcs.size() >= verifyProcs())
+                return; // they'll take the next ones when they're done
+
+            verifyProc = new ExtProcess();
+            verifyProc->setStandardOutputFile(QProcess::nullDevice());
+            connect(verifyProc, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                    this, &ScenePacker::onVerifyFinished, Qt::QueuedConnection);
+            _setProcessScheduling(verifyProc, _verifyProcs.size());
+            _verifyProcs << verifyProc;
+        }
+
+        PackedEntry packed = _verifications.dequeue();
+        _setCurrentJob(packed.entry.jobId);
+        if (!_startVerification(verifyProc, packed))
+            _entryDone(packed, false);
+    }
 }
 
+bool ScenePacker::_startVerification(ExtProcess *verifyProc, const PackedEntry &packed)
+{
+    //! compares the volumes with their sfv in the pool while rar tests them
+    class SfvCheckTask : public QRunnable
+    {
+    private:
+        ScenePacker         *_packer;
+        QPointer<ExtProcess> _verifyProc;
+        const QString        _dstFolder;
+        const QStringList    _sfvLines;
+
+    public:
+        SfvCheckTask(ScenePacker *packer, ExtProcess *verifyProc, const QString &dstFolder, const QStringList &sfvLines):
+            _packer(packer), _verifyProc(verifyProc), _dstFolder(dstFolder), _sfvLines(sfvLines)
+        {}
+
+        void run() override
+        {
+            QStringList errors = ScenePacker::_checkSfv(_dstFolder, _sfvLines);
+            ScenePacker *packer  = _packer;
+            QPointer<ExtProcess> verifyProc = _verifyProc;
+            QMetaObject::invokeMethod(packer, [packer, verifyProc, errors]{
+                if (!verifyProc || !packer->_verifying.contains(verifyProc))
+                    return;
+                packer->_verifying[verifyProc].errors << errors;
+                packer->_verificationStageDone(verifyProc);
+            }, Qt::QueuedConnection);
+        }
+    };
+
+    // rar goes through the next volumes by itself
+    QStringList volumes = QDir(packed.dstFolder).entryList({"*.rar"}, QDir::Files|QDir::NoSymLinks, QDir::Name);
+    if (volumes.isEmpty())
+    {
+        _error(tr("Verification of %1 failed: no volumes").arg(packed.dstFolder));
+        return false;
+    }
 
+    QStringList args = {"t"};
+    if (_useWinrar)
+        args << "-ibck";
+    args << (packed.password.isEmpty() ? QString("-p-") : QString("-p%1").arg(packed.password))
+         << "--" << QString("%1/%2").arg(packed.dstFolder).arg(volumes.first());
+    if (debug())
+        _log(QString("%1 %2").arg(rarPath()).arg(args.join(" ")));
 
-bool ScenePacker::setDstFolder(const QString &path)
-{
-    QFileInfo fi(path);
-    if (fi.exists() && fi.isDir() && fi.isWritable())
+    _verifying.insert(verifyProc, Verification{packed, 1, QStringList()});
+    if (!packed.crcs.isEmpty())
     {
-        if (_dstDir)
-            delete _dstDir;
-        _dstDir = new QDir(path);
-        _settings->setValue(sParamNames[Param::DstPath], path);
-        return true;
+        ++_verifying[verifyProc].nbStages;
+        _checksumPool.start(new SfvCheckTask(this, verifyProc, packed.dstFolder, packed.crcs));
     }
-    else
-        return false;
+    verifyProc->start(rarPath(), args);
+    return true;
 }
 
-void ScenePacker::setRarPrefix(const QString &prefix)
+void ScenePacker::onVerifyFinished(int exitCode)
 {
-    _settings->setValue(sParamNames[Param::RarPrefix], prefix);
+    ExtProcess *verifyProc = static_cast<ExtProcess*>(sender());
+    if (!_verifying.contains(verifyProc))
+        return;
+
+    QString detail = RarFailure::lastLine(QString::fromLocal8Bit(verifyProc->readAllStandardError()));
+    if (exitCode != 0)
+        _verifying[verifyProc].errors << tr("rar test exit code #%1%2").arg(exitCode).arg(
+                                             detail.isEmpty() ? QString() : QString(" (%1)").arg(detail));
+    _verificationStageDone(verifyProc);
 }
 
-bool ScenePacker::_setRarFolder(const QString &path)
+void ScenePacker::_verificationStageDone(ExtProcess *verifyProc)
 {
-    const QString dstFolder(rarFolder());
-    QFileInfo fi(QString("%1/%2").arg(path).arg(dstFolder));
-    if (!fi.exists())
+    Verification &verification = _verifying[verifyProc];
+    if (--verification.nbStages > 0)
+        return;
+
+    Verification verified = _verifying.take(verifyProc);
+    PackedEntry &packed   = verified.packed;
+    _setCurrentJob(packed.entry.jobId);
+    bool abandoned = _isAbandoned(packed.entry);
+    if (_events && !_stopProcess && !abandoned)
+        _entryEvent("verified", packed.entry, {{"ok", verified.errors.isEmpty()}, {"errors", QJsonArray::fromStringList(verified.errors)}});
+    if (abandoned)
+        _dropEntry(packed.entry, true);
+    else if (_stopProcess)
+        _entryDone(packed, false);
+    else if (verified.errors.isEmpty())
     {
-        QDir dir(path);
-        if (!dir.mkdir(dstFolder))
+        if (debug())
+            _log(tr("%1 verified").arg(packed.dstFolder));
+        _entryDone(packed, true);
+    }
+    else
+    {
+        _error(tr("Verification of %1 failed: %2").arg(packed.dstFolder).arg(verified.errors.join(", ")));
+        bool discarded = _discardFolder(packed.dstFolder); // gone before the entry is queued again
+
+        PackEntry &entry = packed.entry;
+        PackJob   *job   = _jobs.value(entry.jobId, nullptr);
+        if (discarded && ++entry.attempts < sMaxPackAttempts && !(job && job->isFinished()))
         {
-//            _error(tr("Couldn't create rar folder: %1").arg(fi.absoluteFilePath()));
-            return false;
+            _log(tr("%1 queued again (attempt %2/%3)").arg(entry.fi.absoluteFilePath()).arg(entry.attempts + 1).arg(sMaxPackAttempts));
+            ++_metrics.nbRetried;
+            _entryStatus(entry, PackStatusModel::State::Retrying);
+            if (_events)
+                _entryEvent("retry", entry, {{"class", RarFailure::name(RarFailure::Kind::Archive)}, {"delayMs", 0}, {"attempt", entry.attempts + 1}});
+            if (job)
+                --job->nbRunning; // it is counted again when it starts
+            --_nbCompressed;
+            _hmiProgress();
+            _entriesToCompress << entry;
+            _wakeIdleProcs();
+        }
+        else
+        {
+            _recordFailure(entry, RarFailure::Kind::Archive, 0, verified.errors.join(", "));
+            _entryDone(packed, false);
         }
     }
-    if (fi.exists() && fi.isDir() && fi.isWritable())
+
+    _startVerifications();
+    if (!_keepWorkersAlive())
+        _releaseIdleProcs();
+}
+
+void ScenePacker::_releaseIdleProcs()
+{
+    _wakeIdleProcs();
+    if (!_idleProcs.isEmpty())
     {
-        if (_dstDir)
-            delete _dstDir;
-        _dstDir = new QDir(fi.absoluteFilePath());
-        return true;
+        // one of them ends the run if the others are done too
+        ExtProcess *extProc = *_idleProcs.begin();
+        _idleProcs.clear();
+        _processNextFolder(extProc);
     }
+    else if (_stopProcess && !_extProcs.isEmpty() && _allProcessesDone()) // no finished signal will come to end the run
+        _processNextFolder(_extProcs.first());
+}
+
+void ScenePacker::pauseProcessing()
+{
+    if (_paused || _extProcs.isEmpty())
+        return;
+
+    _paused = true;
+    _applyThrottle();
+    _log(tr("<b>Paused</b>: %1/%2 entries compressed").arg(_nbCompressed).arg(_nbTotal));
+    _hmiPaused(true);
+}
+
+void ScenePacker::resumeProcessing()
+{
+    if (!_paused)
+        return;
+
+    _paused = false;
+    _applyThrottle();
+    _log(tr("<b>Resumed</b>"));
+    _hmiPaused(false);
+    _startVerifications();
+    _releaseHeldProcs();
+}
+
+void ScenePacker::throttle(int nbProcs)
+{
+    _maxActive = nbProcs < _extProcs.size() ? std::max(0, nbProcs) : 0;
+    if (_extProcs.isEmpty())
+        return;
+
+    if (_maxActive > 0)
+        _log(tr("<b>Throttled to %1 rar processes</b>").arg(_maxActive));
     else
-        return false;
+        _log(tr("<b>No more throttle: %1 rar processes</b>").arg(_extProcs.size()));
+    _applyThrottle();
+    _releaseHeldProcs();
+}
+
+int ScenePacker::_activeCap() const
+{
+    if (_paused)
+        return 0;
+    else
+        return _maxActive > 0 ? _maxActive : _extProcs.size();
+}
+
+int ScenePacker::_nbActiveProcs() const
+{
+    return static_cast<int>(std::count_if(_extProcs.cbegin(), _extProcs.cend(), [](ExtProcess *extProc){
+        return extProc->isBusy() && !extProc->isPaused();
+    }));
+}
+
+void ScenePacker::_applyThrottle()
+{
+    QVector<ExtProcess*> active, stopped;
+    for (ExtProcess *extProc : _extProcs)
+    {
+        if (!extProc->isBusy())
+            continue;
+        else if (extProc->isPaused())
+            stopped << extProc;
+        else
+            active << extProc;
+    }
+
+    int cap = _activeCap();
+    while (active.size() > cap)
+        active.takeLast()->pause();
+    while (active.size() < cap && !stopped.isEmpty())
+    {
+        ExtProcess *extProc = stopped.takeFirst();
+        extProc->resume();
+        active << extProc;
+    }
+
+    for (ExtProcess *verifyProc : _verifyProcs)
+    {
+        if (_paused)
+            verifyProc->pause();
+        else
+            verifyProc->resume();
+    }
+}
+
+void ScenePacker::_releaseHeldProcs()
+{
+    while (!_heldProcs.isEmpty() && _nbActiveProcs() < _activeCap())
+    {
+        ExtProcess *extProc = *_heldProcs.begin();
+        _heldProcs.remove(extProc);
+        _processNextFolder(extProc);
+    }
 }
 
-void ScenePacker::setDebug(bool debug) { _settings->setValue(sParamNames[Param::Debug], debug); }
-void ScenePacker::setDispSettings(bool disp) { _settings->setValue(sParamNames[Param::DispSettings], disp); }
-void ScenePacker::setUseDestinationFolder(bool useDstFolder) { _settings->setValue(sParamNames[Param::DstChoice], useDstFolder); }
+void ScenePacker::_setupSignals()
+{
+#if defined(Q_OS_UNIX)
+    // the handlers only write the signal in a pipe that the event loop reads
+    if (::pipe(sSignalPipe) != 0)
+        return;
+    for (int fd : sSignalPipe)
+    {
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    _signalNotifier = new QSocketNotifier(sSignalPipe[0], QSocketNotifier::Read, this);
+    connect(_signalNotifier, &QSocketNotifier::activated, this, &ScenePacker::onUnixSignal);
+
+    signal(SIGINT,  &ScenePacker::_postUnixSignal); // shut down on ctrl-c
+    signal(SIGTERM, &ScenePacker::_postUnixSignal); // shut down on killall
+    signal(SIGUSR1, &ScenePacker::_postUnixSignal); // pause
+    signal(SIGUSR2, &ScenePacker::_postUnixSignal); // resume
+#if defined(Q_OS_LINUX)
+    for (int sig = SIGRTMIN ; sig <= SIGRTMIN + sMaxThrottleSignal && sig <= SIGRTMAX ; ++sig)
+        signal(sig, &ScenePacker::_postUnixSignal); // throttle
+#endif
+#endif
+}
+
+void ScenePacker::_postUnixSignal(int signal)
+{
+#if defined(Q_OS_UNIX)
+    ssize_t res = ::write(sSignalPipe[1], &signal, sizeof(signal));
+    Q_UNUSED(res) // nothing we can do in a signal handler
+#else
+    Q_UNUSED(signal)
+#endif
+}
+
+void ScenePacker::onUnixSignal()
+{
+#if defined(Q_OS_UNIX)
+    int sig;
+    while (::read(sSignalPipe[0], &sig, sizeof(sig)) == sizeof(sig))
+    {
+        if (sig == SIGINT || sig == SIGTERM)
+            _shutdown();
+        else if (sig == SIGUSR1)
+            pauseProcessing();
+        else if (sig == SIGUSR2)
+            resumeProcessing();
+#if defined(Q_OS_LINUX)
+        else if (sig >= SIGRTMIN && sig <= SIGRTMIN + sMaxThrottleSignal)
+            throttle(sig - SIGRTMIN);
+#endif
+    }
+#endif
+}
+
+void ScenePacker::_shutdown()
+{
+    if (_quitting) // second ctrl-c: no more patience
+    {
+        onKillTimeout();
+        return;
+    }
+
+    _quitting = true;
+    _log(tr("Closing the application..."));
+    if (_extProcs.isEmpty())
+        qApp->quit();
+    else
+        stopProcessing(); // we quit at the end of the run
+}
+
+void ScenePacker::onKillTimeout()
+{
+    for (ExtProcess *extProc : _extProcs + _verifyProcs)
+    {
+        if (extProc->state()!= QProcess::NotRunning)
+        {
+            _error(tr("Killing process %1: it didn't stop").arg(extProc->processId()));
+            extProc->resume();
+            extProc->kill();
+        }
+    }
+}
+
+bool ScenePacker::_discardFolder(const QString &folder)
+{
+    //! removes the folder in the pool, only the errors come back to the event loop
+    class RemoveTask : public QRunnable
+    {
+    private:
+        ScenePacker  *_packer;
+        const QString _path;   //!< renamed folder
+        const QString _folder; //!< original name for the error
+
+    public:
+        RemoveTask(ScenePacker *packer, const QString &path, const QString &folder):
+            _packer(packer), _path(path), _folder(folder)
+        {}
+
+        void run() override
+        {
+            if (QDir(_path).removeRecursively())
+                return;
+
+            ScenePacker *packer = _packer;
+            QString folder = _folder;
+            QMetaObject::invokeMethod(packer, [packer, folder]{
+                packer->_error(tr("Error removing broken folder %1").arg(folder));
+            }, Qt::QueuedConnection);
+        }
+    };
+
+    QFileInfo fi(folder);
+    if (!fi.exists())
+        return true;
+
+    // renamed first so the entry can be packed again straight away
+    QString trash = QString("%1/.%2.%3.partial").arg(fi.absolutePath()).arg(fi.fileName()).arg(
+                QDateTime::currentMSecsSinceEpoch());
+    if (QDir().rename(fi.absoluteFilePath(), trash))
+    {
+        _cleanupPool.start(new RemoveTask(this, trash, folder));
+        return true;
+    }
+
+    // otherwise a new rar would write in it while it's being removed
+    if (QDir(fi.absoluteFilePath()).removeRecursively())
+        return true;
+
+    _error(tr("Error removing broken folder %1").arg(folder));
+    return false;
+}
+
+void ScenePacker::onAdmissionTimeout()
+{
+    QVector<ExtProcess*> waitingProcs(_waitingProcs);
+    _waitingProcs.clear();
+    for (ExtProcess *extProc : waitingProcs)
+    {
+        if (_extProcs.contains(extProc)) // _clear may have been called
+            _processNextFolder(extProc);
+    }
+}
+
+ScenePacker::Admission ScenePacker::_admitEntry(ExtProcess *extProc, const PackEntry &entry)
+{
+    // the rar folder may not exist yet but it is on the same storage than its source folder
+    QStorageInfo storage(useDestinationFolder() ? _dstDir->absolutePath() : entry.fi.absolutePath());
+    if (!storage.isValid() || !storage.isReady())
+        return Admission::Admit; // we can't tell, let rar try
+
+    qint64 need  = _estimatedOutputSize(entry);
+    qint64 avail = storage.bytesAvailable() - _pendingReservations(storage.rootPath()) - minFree() * sMB;
+    if (need <= avail)
+    {
+        extProc->setProperty(sPropertyReserved, need);
+        extProc->setProperty(sPropertyStorage,  storage.rootPath());
+        if (_waitingForSpace)
+        {
+            _waitingForSpace = false;
+            _log(tr("Enough free space on %1 to resume").arg(storage.rootPath()));
+        }
+        return Admission::Admit;
+    }
+
+    if (need + minFree() * sMB > storage.bytesTotal())
+        return Admission::Reject;
+
+    if (!_waitingProcs.contains(extProc))
+        _waitingProcs << extProc;
+    if (!_admissionTimer.isActive())
+        _admissionTimer.start();
+    if (!_waitingForSpace)
+    {
+        _waitingForSpace = true;
+        _error(tr("Waiting for free space on %1 to compress %2 (need %3 MB, available %4 MB)").arg(
+                   storage.rootPath()).arg(entry.fi.fileName()).arg(need / sMB).arg(std::max<qint64>(0, avail) / sMB));
+    }
+    return Admission::Wait;
+}
+
+void ScenePacker::_releaseSpace(ExtProcess *extProc)
+{
+    extProc->setProperty(sPropertyReserved, 0);
+}
+
+qint64 ScenePacker::_pendingReservations(const QString &storageRoot) const
+{
+    // the running jobs have already written (and thus consumed) part of their reservation,
+    // all of it is still pending when we can't tell what they wrote
+    qint64 pending = 0;
+    for (ExtProcess *extProc : _extProcs)
+    {
+        qint64 reserved = extProc->property(sPropertyReserved).toLongLong();
+        if (reserved > 0 && extProc->state() != QProcess::NotRunning
+                && extProc->property(sPropertyStorage).toString() == storageRoot)
+        {
+            qint64 written = extProc->writtenBytes();
+            pending += written < 0 ? reserved : std::max<qint64>(0, reserved - written);
+        }
+    }
+    return pending;
+}
+
+qint64 ScenePacker::_estimatedOutputSize(const PackEntry &entry, double ratio) const
+{
+    int level = std::max(0, std::min(compressLevel(), 5));
+    if (ratio < 0)
+        ratio = _stats().hasModel(level) ? _stats().ratio(level) : sCompressRatioEstimates[level];
+    double size = static_cast<double>(entry.size) * ratio;
+    if (addRecovery() && recoveryPct() > 0)
+        size *= 1. + recoveryPct() / 100.;
+    size *= 1. + par2Pct() / 100.;
+
+    // headers: about 1kB per file and 64kB per volume
+    qint64 nbVolumes = 1;
+    if (splitArchive() && splitSize() > 0)
+        nbVolumes += entry.size / (splitSize() * sMB);
+    return static_cast<qint64>(size) + 1024 * entry.nbFiles + 65536 * nbVolumes;
+}
+
+bool ScenePacker::_acceptEntry(const PackEntry &entry, const DirScanner &scanner)
+{
+    if (scanner.existInDestination(_dstFolderForEntry(entry)))
+    {
+        if (debug())
+            _error(tr("skip %1 has it is already present in destination folder").arg(entry.fi.fileName()));
+        return false;
+    }
+    return entry.fi.fileName() != rarFolder();
+}
+
+void ScenePacker::_startWatching(const QStringList &srcFolders)
+{
+    _watcher = new QFileSystemWatcher(this);
+    connect(_watcher, &QFileSystemWatcher::directoryChanged, this, &ScenePacker::onSrcFolderChanged);
+
+    _polledFolders.clear();
+    for (const QString &srcFolder : srcFolders)
+    {
+        if (!_watcher->addPath(srcFolder))
+            _polledFolders << srcFolder;
+    }
+
+    int checkMs = std::max(sMinWatchCheckMs, std::min(quietTime() * 1000 / 4, sMaxWatchCheckMs));
+    _watchTimer.setInterval(checkMs);
+    if (!_polledFolders.isEmpty())
+        _watchTimer.start();
+
+    _log(tr("<b>Watching %1 folder(s) for new entries (%2 polled), packing them after %3 sec without changes</b>").arg(
+             srcFolders.size()).arg(_polledFolders.size()).arg(quietTime()));
+}
+
+void ScenePacker::_stopWatching()
+{
+    _watchTimer.stop();
+    if (_watcher)
+    {
+        delete _watcher;
+        _watcher = nullptr;
+    }
+    _polledFolders.clear();
+    _pendingEntries.clear();
+}
+
+void ScenePacker::onSrcFolderChanged(const QString &srcFolder)
+{
+    _scanNewEntries(srcFolder);
+}
+
+void ScenePacker::_scanNewEntries(const QString &srcFolder)
+{
+    if (!useDestinationFolder() && !_setRarFolder(srcFolder))
+    {
+        _error(tr("Couldn't create rar folder in: %1").arg(srcFolder));
+        return;
+    }
+
+    // only the new entries are sized
+    QSet<QString> present;
+    DirScanner scanner;
+    scanner.setDestination(_dstDir->absolutePath());
+    for (const PackEntry &entry : scanner.scan(srcFolder, [&](const PackEntry &entry){
+             QString path = entry.fi.absoluteFilePath();
+             present << path;
+             return !_knownEntries.contains(path) && !_pendingEntries.contains(path) && _acceptEntry(entry, scanner);
+         }))
+    {
+        PendingEntry &pending = _pendingEntries[entry.fi.absoluteFilePath()];
+        pending.entry = entry;
+        _setEntryPriority(pending.entry, srcFolder);
+        pending.quietFor.start();
+        if (debug())
+            _log(tr("new entry detected: %1").arg(entry.fi.absoluteFilePath()));
+    }
+
+    // a removed entry is packed again if it comes back
+    QString srcPath = QFileInfo(srcFolder).absoluteFilePath();
+    for (auto it = _knownEntries.begin() ; it != _knownEntries.end() ; )
+    {
+        if (!present.contains(*it) && QFileInfo(*it).absolutePath() == srcPath)
+            it = _knownEntries.erase(it);
+        else
+            ++it;
+    }
+
+    if (!_pendingEntries.isEmpty() && !_watchTimer.isActive())
+        _watchTimer.start();
+}
+
+void ScenePacker::onWatchTimeout()
+{
+    for (const QString &srcFolder : _polledFolders)
+        _scanNewEntries(srcFolder);
+
+    qint64 quietMs = quietTime() * 1000;
+    for (auto it = _pendingEntries.begin() ; it != _pendingEntries.end() ; )
+    {
+        PendingEntry &pending = it.value();
+        QFileInfo fi(it.key()); // fresh one, not cached
+        if (!fi.exists())
+        {
+            it = _pendingEntries.erase(it);
+            continue;
+        }
+
+        int    nbFiles = 1;
+        qint64 size    = pending.entry.isDir ? DirScanner::folderSize(it.key(), &nbFiles) : fi.size();
+        if (size != pending.entry.size || nbFiles != pending.entry.nbFiles)
+        {
+            pending.entry.size    = size;
+            pending.entry.nbFiles = nbFiles;
+            pending.quietFor.restart();
+            ++it;
+        }
+        else if (pending.quietFor.elapsed() >= quietMs)
+        {
+            _enqueueEntry(pending.entry);
+            it = _pendingEntries.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    if (_pendingEntries.isEmpty() && _polledFolders.isEmpty())
+        _watchTimer.stop();
+}
+
+void ScenePacker::_enqueueEntry(const PackEntry &entry)
+{
+    _entryQueued(entry);
+    _entriesToCompress << entry;
+    ++_nbTotal;
+    _hmiProgress(_nbTotal);
+
+    _wakeIdleProcs();
+}
+
+void ScenePacker::_wakeIdleProcs()
+{
+    while (!_idleProcs.isEmpty() && !_entriesToCompress.isEmpty())
+    {
+        ExtProcess *extProc = *_idleProcs.begin();
+        _idleProcs.remove(extProc);
+        _processNextFolder(extProc);
+    }
+}
+
+void ScenePacker::_startBackgroundScan(const QStringList &srcFolders)
+{
+    _nbTotal = 0;
+    QVector<BackgroundScanner::Target> targets;
+    bool useRarFolder = !useDestinationFolder();
+    for (const QString &srcFolder : srcFolders)
+    {
+        if (useRarFolder && !_setRarFolder(srcFolder))
+        {
+            _error(tr("Couldn't create rar folder in: %1").arg(srcFolder));
+            continue;
+        }
+        targets << BackgroundScanner::Target{srcFolder, _dstDir->absolutePath()};
+    }
+
+    _scanner = new BackgroundScanner(targets, useRarFolder ? QString() : rarPrefix(), rarFolder(), this);
+    connect(_scanner, &BackgroundScanner::entriesAvailable, this, &ScenePacker::onScannedEntries, Qt::QueuedConnection);
+    connect(_scanner, &BackgroundScanner::finished,         this, &ScenePacker::onScanFinished,   Qt::QueuedConnection);
+    _scanner->start();
+}
+
+void ScenePacker::_stopBackgroundScan()
+{
+    if (_scanner)
+    {
+        delete _scanner; // joins its thread
+        _scanner = nullptr;
+    }
+}
+
+void ScenePacker::onScannedEntries()
+{
+    if (!_scanner) // stopped meanwhile
+        return;
+
+    _scanner->acknowledge();
+    bool isDebug = debug();
+    int  nbNew   = 0;
+    BackgroundScanner::Scanned scanned;
+    while (_scanner->tryPop(scanned))
+    {
+        if (scanned.skipped)
+        {
+            if (isDebug)
+                _error(tr("skip %1 has it is already present in destination folder").arg(scanned.entry.fi.fileName()));
+            continue;
+        }
+        _setEntryPriority(scanned.entry, _scanner->target(scanned.target).srcFolder);
+        _entryQueued(scanned.entry);
+        _entriesToCompress << scanned.entry;
+        ++nbNew;
+    }
+
+    if (nbNew > 0)
+    {
+        _nbTotal += nbNew;
+        _hmiProgress(_nbTotal);
+        _wakeIdleProcs();
+    }
+}
+
+void ScenePacker::onScanFinished()
+{
+    if (!_scanner)
+        return;
+
+    onScannedEntries(); // the last ones
+    _stopBackgroundScan();
+    if (_nbTotal == 0)
+    {
+        _log(tr("<b>There are no items to compress...</b>"));
+        _hmiProgress(1);
+    }
+    else
+        _log(tr("<b>Scan done: %1 items to compress</b>").arg(_nbTotal));
+    if (_events)
+        _events->write("scan_done", {{"total", _nbTotal}});
+
+    // the idle workers won't get anything more
+    if (!_keepWorkersAlive())
+        _releaseIdleProcs();
+}
+
+int ScenePacker::_scanSrcFolders(const QStringList &srcFolders, int jobId)
+{
+    int  nbEntries    = 0;
+    bool useRarFolder = !useDestinationFolder();
+    DirScanner scanner;
+    for (const QString &srcFolder : srcFolders)
+    {
+        if (useRarFolder && !_setRarFolder(srcFolder))
+        {
+            _error(tr("Couldn't create rar folder in: %1").arg(srcFolder));
+            continue;
+        }
+
+        // the filter is called before sizing so we don't walk what we skip
+        scanner.setDestination(_dstDir->absolutePath());
+        for (PackEntry &entry : scanner.scan(srcFolder, [&](const PackEntry &entry){
+                 return _acceptEntry(entry, scanner);
+             }))
+        {
+            entry.jobId = jobId;
+            _setEntryPriority(entry, srcFolder);
+            _entryQueued(entry);
+            _entriesToCompress << entry;
+            ++nbEntries;
+        }
+    }
+    return nbEntries;
+}
+
+void ScenePacker::_setEntryPriority(PackEntry &entry, const QString &srcFolder) const
+{
+    SourcePriority srcPriority = _srcPriorities.value(QFileInfo(srcFolder).absoluteFilePath(), SourcePriority{0, 0});
+    entry.priority = srcPriority.priority;
+    entry.deadline = srcPriority.deadline;
+
+    // a pattern is more specific than the source folder, the first one given wins
+    QString name = entry.fi.fileName();
+    for (const PatternPriority &patternPriority : _patternPriorities)
+    {
+        if (patternPriority.regExp.match(name).hasMatch())
+        {
+            entry.priority = patternPriority.priority;
+            return;
+        }
+    }
+}
+
+bool ScenePacker::_parseInput(const QString &input, QString &path, int &priority, qint64 &deadline) const
+{
+    // a folder can have ':' in its name (or a drive on Windows) so we only split if needed
+    path     = input;
+    priority = 0;
+    deadline = 0;
+    QFileInfo fi(input);
+    if (!fi.exists())
+    {
+        static const QRegularExpression sInputRegExp("^(.+):(-?\\d+)(?::(\\d+)([mhd]?))?$");
+        QRegularExpressionMatch match = sInputRegExp.match(input);
+        if (!match.hasMatch())
+            return false;
+
+        path     = match.captured(1);
+        priority = match.captured(2).toInt();
+        if (!match.captured(3).isEmpty())
+        {
+            qint64 minutes = match.captured(3).toLongLong();
+            if (match.captured(4) == "h")
+                minutes *= 60;
+            else if (match.captured(4) == "d")
+                minutes *= 60 * 24;
+            deadline = QDateTime::currentMSecsSinceEpoch() + minutes * 60000;
+        }
+        fi.setFile(path);
+    }
+    return fi.exists() && fi.isDir() && fi.isReadable();
+}
+
+void ScenePacker::setSourcePriority(const QString &srcFolder, int priority, qint64 deadline)
+{
+    _srcPriorities.insert(QFileInfo(srcFolder).absoluteFilePath(), SourcePriority{priority, deadline});
+}
+
+void ScenePacker::clearSourcePriorities()
+{
+    _srcPriorities.clear();
+}
+
+bool ScenePacker::addPatternPriority(const QString &patternPrio)
+{
+    int sep = patternPrio.lastIndexOf(':');
+    bool ok = false;
+    int priority = sep > 0 ? patternPrio.mid(sep + 1).toInt(&ok) : 0;
+    if (!ok)
+        return false;
+
+    QRegularExpression regExp(QRegularExpression::wildcardToRegularExpression(patternPrio.left(sep)),
+                              QRegularExpression::CaseInsensitiveOption);
+    _patternPriorities.append(PatternPriority{patternPrio, regExp, priority});
+    return regExp.isValid();
+}
+
+void ScenePacker::clearPatternPriorities()
+{
+    _patternPriorities.clear();
+}
+
+bool ScenePacker::_startServer(const QString &socketName)
+{
+    // what runs or clients save in the meantime mustn't change our global options
+    if (!_snapshotSettings())
+        return false;
+
+    QString err;
+    _jobServer = new JobServer(*this, this);
+    if (!_jobServer->listen(socketName, err))
+    {
+        _error(tr("Couldn't start the job server: %1").arg(err));
+        delete _jobServer;
+        _jobServer = nullptr;
+        return false;
+    }
+
+    _log(tr("<b>Job server listening on %1</b>").arg(_jobServer->fullServerName()));
+    processFolders(QStringList());
+    return true;
+}
+
+void ScenePacker::_requestServer(const QString &socketName, const QJsonObject &req)
+{
+    QJsonObject reply;
+    QString err;
+    if (!JobServer::request(socketName, req, reply, err))
+    {
+        _error(err);
+        return;
+    }
+
+    if (reply.contains("jobs"))
+    {
+        QJsonArray jobs = reply.value("jobs").toArray();
+        if (jobs.isEmpty())
+            _cout << tr("No jobs on the server") << endl << flush;
+        for (const QJsonValue &val : jobs)
+        {
+            QJsonObject job = val.toObject();
+            _cout << tr("Job #%1 %2: %3/%4 entries compressed (%5 failed, %6 running), submitted at %7 with inputs: %8").arg(
+                         job.value("job").toInt()).arg(
+                         job.value("state").toString()).arg(
+                         job.value("nbDone").toInt()).arg(
+                         job.value("nbEntries").toInt()).arg(
+                         job.value("nbFailed").toInt()).arg(
+                         job.value("nbRunning").toInt()).arg(
+                         job.value("submitted").toString()).arg(
+                         job.value("inputs").toVariant().toStringList().join(", "))
+                  << endl << flush;
+        }
+    }
+    else if (reply.contains("job"))
+        _cout << tr("Job #%1 submitted with %2 entries").arg(reply.value("job").toInt()).arg(reply.value("nbEntries").toInt())
+              << endl << flush;
+    else
+        _cout << tr("Done") << endl << flush;
+}
+
+QVariantHash ScenePacker::_jobOptions() const
+{
+    QVariantHash options;
+    for (Param param : sJobParams)
+        options.insert(sParamNames[param], _config()->value(sParamNames[param]));
+    if (useDestinationFolder())
+        options.insert(sParamNames[Param::DstPath], QFileInfo(dstPath()).absoluteFilePath());
+    QStringList patternPrios;
+    for (const PatternPriority &patternPriority : _patternPriorities)
+        patternPrios << patternPriority.patternPrio;
+    options.insert(sParamNames[Param::Priority], patternPrios);
+    return options;
+}
+
+int ScenePacker::submitJob(const QStringList &srcFolders, const QVariantHash &options, int &nbEntries, QString &err)
+{
+    nbEntries = 0;
+    if (_stopProcess)
+    {
+        err = tr("the server is stopping");
+        return 0;
+    }
+    if (srcFolders.isEmpty())
+    {
+        err = tr("you need to provide at least one input folder...");
+        return 0;
+    }
+    for (const QString &path : srcFolders)
+    {
+        QFileInfo fi(path);
+        if (!fi.isAbsolute() || !fi.isDir() || !fi.isReadable())
+        {
+            err = tr("the input '%1' is not a readable directory...").arg(path);
+            return 0;
+        }
+    }
+
+    PackJob *job = new PackJob(++_lastJobId, srcFolders, options);
+    _jobs.insert(job->id, job);
+    _setCurrentJob(job->id);
+    if (useDestinationFolder())
+    {
+        QFileInfo fi(dstPath());
+        if (!fi.isAbsolute() || !fi.isDir() || !fi.isWritable())
+            err = tr("Please provide a writable directory for the destination folder");
+    }
+    else if (rarFolder().isEmpty())
+        err = tr("you need to provide either a destination folder (-o) or the name of the rar folders (-x)");
+
+    // the patterns of the previous job don't apply (the entries get their priority during the scan)
+    clearPatternPriorities();
+    for (const QString &patternPrio : options.value(sParamNames[Param::Priority]).toStringList())
+    {
+        if (!addPatternPriority(patternPrio))
+            err = tr("invalid priority of a pattern: '%1'").arg(patternPrio);
+    }
+    if (!err.isEmpty())
+    {
+        _curJob = nullptr;
+        _jobs.remove(job->id);
+        delete job;
+        return 0;
+    }
+
+    nbEntries = job->nbEntries = _scanSrcFolders(srcFolders, job->id);
+    _nbTotal += nbEntries;
+    _log(tr("<b>Job #%1: %2 items to compress from %3</b>").arg(job->id).arg(nbEntries).arg(srcFolders.join(", ")));
+    if (nbEntries == 0)
+        job->state = PackJob::State::Done;
+
+    _wakeIdleProcs();
+    return job->id;
+}
+
+bool ScenePacker::cancelJob(int jobId, QString &err)
+{
+    PackJob *job = _jobs.value(jobId, nullptr);
+    if (!job)
+    {
+        err = tr("unknown job #%1").arg(jobId);
+        return false;
+    }
+    if (job->isFinished())
+    {
+        err = tr("job #%1 is already %2").arg(jobId).arg(PackJob::stateStr(job->state));
+        return false;
+    }
+
+    job->state = PackJob::State::Canceled;
+    int nbRemoved = _entriesToCompress.removeIf([jobId](const PackEntry &entry){ return entry.jobId == jobId; });
+    _nbTotal -= nbRemoved;
+
+    // their broken archives will be removed in onProcFinished
+    for (ExtProcess *extProc : _extProcs)
+    {
+        if (extProc->state() != QProcess::NotRunning && extProc->property(sPropertyJobId).toInt() == jobId)
+            extProc->terminate();
+    }
+
+    _log(tr("<b>Job #%1 canceled (%2 items removed from the queue)</b>").arg(jobId).arg(nbRemoved));
+    return true;
+}
+
+QJsonArray ScenePacker::jobsStatus() const
+{
+    QJsonArray jobs;
+    for (const PackJob *job : _jobs)
+        jobs.append(QJsonObject{
+                        {"job",       job->id},
+                        {"state",     PackJob::stateStr(job->state)},
+                        {"submitted", job->submitted.toString(Qt::ISODate)},
+                        {"inputs",    QJsonArray::fromStringList(job->srcFolders)},
+                        {"nbEntries", job->nbEntries},
+                        {"nbRunning", job->nbRunning},
+                        {"nbDone",    job->nbDone},
+                        {"nbFailed",  job->nbFailed}
+                    });
+    return jobs;
+}
+
+void ScenePacker::_setCurrentJob(int jobId)
+{
+    _curJob = _jobs.value(jobId, nullptr);
+    if (_curJob && useDestinationFolder())
+    {
+        QString path = dstPath();
+        if (!_dstDir || _dstDir->absolutePath() != path)
+        {
+            if (_dstDir)
+                delete _dstDir;
+            _dstDir = new QDir(path);
+        }
+    }
+}
+
+void ScenePacker::_jobEntryDone(int jobId, bool success, bool started)
+{
+    PackJob *job = _jobs.value(jobId, nullptr);
+    if (!job)
+        return;
+
+    if (started)
+        --job->nbRunning;
+    if (success)
+        ++job->nbDone;
+    else
+        ++job->nbFailed;
+
+    if (!job->isFinished() && job->nbDone + job->nbFailed == job->nbEntries)
+    {
+        job->state = PackJob::State::Done;
+        _log(tr("<b>Job #%1 done: %2/%3 entries compressed</b>").arg(jobId).arg(job->nbDone).arg(job->nbEntries));
+    }
+    if (job->isFinished() && job->nbRunning == 0)
+        _pruneJobs();
+}
+
+void ScenePacker::_pruneJobs()
+{
+    int nbFinished = 0;
+    for (const PackJob *job : _jobs)
+    {
+        if (job->isFinished() && job->nbRunning == 0)
+            ++nbFinished;
+    }
+
+    // the oldest first (ids are increasing)
+    for (auto it = _jobs.begin() ; it != _jobs.end() && nbFinished > sMaxFinishedJobs ; )
+    {
+        PackJob *job = it.value();
+        if (job->isFinished() && job->nbRunning == 0)
+        {
+            if (_curJob == job)
+                _curJob = nullptr;
+            delete job;
+            it = _jobs.erase(it);
+            --nbFinished;
+        }
+        else
+            ++it;
+    }
+}
+
+QStringList ScenePacker::_createChecksums(const QString &folder, const QString &archiveName,
+                                          int digests, bool manifest, QStringList &errors)
+{
+    QStringList sfvLines, md5Lines, sha1Lines;
+    QJsonArray volumes;
+    QDir dir(folder);
+    for (const QFileInfo &fi : dir.entryInfoList({"*.rar"}, QDir::Files|QDir::NoSymLinks,  QDir::Name))
+    {
+        FileHasher::Digests fileDigests = FileHasher::hash(fi.absoluteFilePath(), digests);
+        if (!fileDigests.ok)
+        {
+            errors << tr("Error reading %1 to compute its checksums").arg(fi.absoluteFilePath());
+            continue;
+        }
+
+        QJsonObject volume = {{"name", fi.fileName()}, {"size", fi.size()}};
+        if (digests & FileHasher::CRC32)
+        {
+            QString crc32 = QString("%1").arg(fileDigests.crc32, 8, 16, QChar('0'));
+            sfvLines << QString("%1 %2").arg(fi.fileName()).arg(crc32);
+            volume.insert("crc32", crc32);
+        }
+        if (digests & FileHasher::MD5)
+        {
+            md5Lines << QString("%1  %2").arg(QString(fileDigests.md5.toHex())).arg(fi.fileName()); // md5sum format
+            volume.insert("md5", QString(fileDigests.md5.toHex()));
+        }
+        if (digests & FileHasher::SHA1)
+        {
+            sha1Lines << QString("%1  %2").arg(QString(fileDigests.sha1.toHex())).arg(fi.fileName());
+            volume.insert("sha1", QString(fileDigests.sha1.toHex()));
+        }
+        if (digests & FileHasher::XXH3)
+            volume.insert("xxh3", QString("%1").arg(fileDigests.xxh3, 16, 16, QChar('0')));
+        volumes.append(volume);
+    }
+
+    QList<QPair<QString, QStringList>> sidecars;
+    if (digests & FileHasher::CRC32)
+        sidecars << qMakePair(QString("%1/%2.sfv").arg(folder).arg(archiveName), sfvLines);
+    if (digests & FileHasher::MD5)
+        sidecars << qMakePair(QString("%1/%2.md5").arg(folder).arg(archiveName), md5Lines);
+    if (digests & FileHasher::SHA1)
+        sidecars << qMakePair(QString("%1/%2.sha1").arg(folder).arg(archiveName), sha1Lines);
+    if (manifest)
+    {
+        QJsonObject manifestObj = {
+            {"archive", archiveName},
+            {"date",    QDateTime::currentDateTime().toString(Qt::ISODate)},
+            {"volumes", volumes}
+        };
+        sidecars << qMakePair(QString("%1/%2.json").arg(folder).arg(archiveName),
+                              QStringList(QString::fromUtf8(QJsonDocument(manifestObj).toJson(QJsonDocument::Indented)).trimmed()));
+    }
+
+    for (const auto &sidecar : sidecars)
+    {
+        if (!_writeSidecar(sidecar.first, sidecar.second))
+            errors << tr("Error creating %1").arg(sidecar.first);
+    }
+    return sfvLines;
+}
+
+QStringList ScenePacker::_checkSfv(const QString &folder, const QStringList &sfvLines)
+{
+    QStringList errors;
+    for (const QString &line : sfvLines)
+    {
+        int sep = line.lastIndexOf(' ');
+        QString volume = line.left(sep);
+        FileHasher::Digests digests = FileHasher::hash(QString("%1/%2").arg(folder).arg(volume), FileHasher::CRC32);
+        if (!digests.ok)
+            errors << tr("can't read %1").arg(volume);
+        else if (QString("%1").arg(digests.crc32, 8, 16, QChar('0')) != line.mid(sep + 1))
+            errors << tr("wrong crc32 for %1").arg(volume);
+    }
+    return errors;
+}
+
+bool ScenePacker::_writeSidecar(const QString &path, const QStringList &lines)
+{
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly|QIODevice::Text))
+    {
+        QTextStream stream(&file);
+        for (const QString &line : lines)
+            stream << line << endl;
+        return true;
+    }
+    else
+        return false;
+}
+
+void ScenePacker::_writeHistory(const QString &srcFolder, const QString &dstFolder, const QString &archiveName,
+                                const QString &password, const QStringList &crcs)
+{
+    if (!_logPerRun)
+        _logStream << QDateTime::currentDateTime().toString("yyyy/MM/dd hh:mm:ss") << ";";
+    _logStream << srcFolder << ";"
+               << dstFolder << ";"
+               << archiveName << ";"
+               << password << ";"
+               << crcs.join(",")
+               << endl << flush;
+}
+
+double ScenePacker::_throughput(int compressLevel, int nbProcs) const
+{
+    if (_stats().hasModel(compressLevel))
+        return _stats().throughput(compressLevel, nbProcs);
+    return sDefaultThroughputs[std::max(0, std::min(compressLevel, 5))] * sMB;
+}
+
+QString ScenePacker::randomStr(int length, const QString &alphabet) const
+{
+    return RandomGenerator::randomStr(std::max(5, length), alphabet);
+}
+
+QString ScenePacker::nameChars() const
+{
+    QString alphabet = _value(Param::NameChars).toString();
+    return alphabet.isEmpty() ? RandomGenerator::sDefaultAlphabet : alphabet;
+}
+
+QString ScenePacker::passChars() const
+{
+    QString alphabet = _value(Param::PassChars).toString();
+    return alphabet.isEmpty() ? RandomGenerator::sDefaultAlphabet : alphabet;
+}
+
+int ScenePacker::hashes() const
+{
+    return FileHasher::parseDigests(_value(Param::Hashes).toString());
+}
+
+int ScenePacker::_chooseLevel(const PackEntry &entry, double &ratio)
+{
+    ratio = -1.;
+    int level = compressLevel();
+    if (!autoLevel() || level == 0)
+        return level;
+
+    if (!entry.isDir && storeExtensions().contains(entry.fi.suffix(), Qt::CaseInsensitive))
+    {
+        ratio = 1.;
+        return 0;
+    }
+
+    // only the dry run samples here (it doesn't mind blocking)
+    QString path = entry.fi.absoluteFilePath();
+    ratio = _sampledRatios.contains(path) ? _sampledRatios.take(path) : RunPlanner::sampleRatio(entry);
+    return ratio >= sIncompressibleRatio ? 0 : level;
+}
+
+bool ScenePacker::_needsSample(const PackEntry &entry) const
+{
+    return autoLevel() && compressLevel() > 0
+            && (entry.isDir || !storeExtensions().contains(entry.fi.suffix(), Qt::CaseInsensitive));
+}
+
+void ScenePacker::_startSample(const PackEntry &entry)
+{
+    //! reads and compresses a few blocks of the entry, the ratio comes back to the event loop
+    class SampleTask : public QRunnable
+    {
+    private:
+        ScenePacker    *_packer;
+        const PackEntry _entry;
+
+    public:
+        SampleTask(ScenePacker *packer, const PackEntry &entry):
+            _packer(packer), _entry(entry)
+        {}
+
+        void run() override
+        {
+            double ratio = RunPlanner::sampleRatio(_entry);
+            ScenePacker *packer = _packer;
+            QString path = _entry.fi.absoluteFilePath();
+            QMetaObject::invokeMethod(packer, [packer, path, ratio]{
+                packer->_sampleDone(path, ratio);
+            }, Qt::QueuedConnection);
+        }
+    };
+
+    QString path = entry.fi.absoluteFilePath();
+    if (_sampling.contains(path))
+        return;
+
+    _sampling << path;
+    _samplePool.start(new SampleTask(this, entry));
+}
+
+void ScenePacker::_sampleDone(const QString &path, double ratio)
+{
+    if (!_sampling.remove(path)) // run cleared meanwhile
+        return;
+
+    _sampledRatios.insert(path, ratio);
+    QSet<ExtProcess*> samplingProcs;
+    samplingProcs.swap(_samplingProcs);
+    for (ExtProcess *extProc : samplingProcs)
+    {
+        if (_extProcs.contains(extProc))
+            _processNextFolder(extProc); // they may wait for another one
+    }
+}
+
+qint64 ScenePacker::_cpuMsEstimate(int compressLevel, qint64 size) const
+{
+    return static_cast<qint64>(1000. * _stats().cpuLoad(compressLevel)
+                               * static_cast<double>(size) / _throughput(compressLevel, 1));
+}
+
+qint64 ScenePacker::_recordRun(ExtProcess *extProc, const QString &dstFolder)
+{
+    ThroughputSample sample;
+    sample.date        = QDateTime::currentSecsSinceEpoch();
+    sample.level       = extProc->property(sPropertyLevel).toInt();
+    sample.recoveryPct = addRecovery() ? recoveryPct() : 0;
+    sample.splitSize   = splitArchive() ? splitSize() : 0;
+    sample.nbProcs     = extProc->property(sPropertyNbProcs).toInt();
+    sample.inputSize   = extProc->property(sPropertyInputSize).toLongLong();
+    sample.outputSize  = DirScanner::folderSize(dstFolder); // only the volumes, the sfv is not there yet
+    sample.wallMs      = extProc->wallMs();
+    sample.cpuMs       = extProc->cpuMs();
+    _stats().record(sample);
+    return sample.outputSize;
+}
+
+qint64 ScenePacker::_etaMs() const
+{
+    int nbProcs = std::max(1, _extProcs.size());
+    double throughput = _throughput(compressLevel(), nbProcs);
+    if (addRecovery() && recoveryPct() > 0)
+        throughput /= 1. + recoveryPct() / 100.;
+
+    // what's left of the running ones + the queue, shared by all the processes
+    double remaining = static_cast<double>(_entriesToCompress.totalSize());
+    for (ExtProcess *extProc : _extProcs)
+    {
+        double inputSize = extProc->property(sPropertyInputSize).toDouble();
+        if (extProc->state() != QProcess::NotRunning)
+            remaining += std::max(0., inputSize - throughput * extProc->runningMs() / 1000.);
+    }
+    return static_cast<qint64>(1000. * remaining / (throughput * nbProcs));
+}
+
+QString ScenePacker::_durationStr(qint64 ms)
+{
+    qint64 sec = (ms + 500) / 1000;
+    return QString("%1:%2:%3").arg(sec / 3600, 2, 10, QChar('0')).arg(
+                (sec % 3600) / 60, 2, 10, QChar('0')).arg(
+                sec % 60, 2, 10, QChar('0'));
+}
+
+void ScenePacker::_plan(const QStringList &srcFolders)
+{
+    _dryRun = true;
+    _entriesToCompress.clear();
+    _scanSrcFolders(srcFolders, 0);
+    QList<PackEntry> entries = _entriesToCompress.entries();
+    _entriesToCompress.clear();
+
+    int nbThreads = threads();
+    _log(tr("<b>Planning %1 items using %2 threads (sampling their compressibility)...</b>").arg(entries.size()).arg(nbThreads));
+
+    int level = std::max(0, std::min(compressLevel(), 5));
+    double recoveryFactor = addRecovery() && recoveryPct() > 0 ? 1. + recoveryPct() / 100. : 1.;
+
+    QVector<PlannedEntry> planned;
+    planned.reserve(entries.size());
+    for (const PackEntry &entry : entries)
+    {
+        double ratio;
+        int entryLevel = _chooseLevel(entry, ratio);
+        if (entryLevel == 0)
+            ratio = 1.; // store mode doesn't compress
+        else if (ratio < 0)
+            ratio = RunPlanner::sampleRatio(entry);
+        double throughput = _throughput(entryLevel, nbThreads) / recoveryFactor;
+        planned << PlannedEntry{entry, ratio, _estimatedOutputSize(entry, ratio),
+                                static_cast<qint64>(1000. * static_cast<double>(entry.size) / throughput), 0, 0, 0};
+    }
+    qint64 totalMs = RunPlanner::simulate(planned, nbThreads);
+
+    // the archives of each storage (several in rar folder mode)
+    qint64 totalIn = 0, totalOut = 0;
+    QHash<QString, qint64> needs;
+    QHash<QString, QString> storageRoots; // by folder, QStorageInfo is not that cheap
+    for (const PlannedEntry &p : planned)
+    {
+        _cout << QString("%1 : %2 MB => %3 MB (%4%) in %5 [%6 - %7] on #%8").arg(
+                     p.entry.fi.absoluteFilePath()).arg(
+                     p.entry.size / sMB).arg(
+                     p.outputSize / sMB).arg(
+                     static_cast<int>(std::round(100. * p.ratio))).arg(
+                     _durationStr(p.durationMs)).arg(
+                     _durationStr(p.startMs)).arg(
+                     _durationStr(p.endMs)).arg(
+                     p.worker + 1)
+              << endl;
+        totalIn  += p.entry.size;
+        totalOut += p.outputSize;
+
+        QString folder = useDestinationFolder() ? dstPath() : p.entry.fi.absolutePath();
+        if (!storageRoots.contains(folder))
+            storageRoots.insert(folder, QStorageInfo(folder).rootPath());
+        needs[storageRoots.value(folder)] += p.outputSize;
+    }
+    _cout << flush;
+
+    _log(tr("<b>Plan: %1 items, %2 MB => ~%3 MB in ~%4 using %5 threads</b>").arg(
+             planned.size()).arg(totalIn / sMB).arg(totalOut / sMB).arg(_durationStr(totalMs)).arg(nbThreads));
+    for (auto it = needs.cbegin() ; it != needs.cend() ; ++it)
+    {
+        qint64 avail = QStorageInfo(it.key()).bytesAvailable() - minFree() * sMB;
+        QString msg = tr("%1: ~%2 MB needed, %3 MB available").arg(it.key()).arg(it.value() / sMB).arg(avail / sMB);
+        if (it.value() <= avail)
+            _log(msg);
+        else
+            _error(tr("%1 => NOT ENOUGH SPACE").arg(msg));
+    }
+    _dryRun = false;
+}
+
+bool ScenePacker::_keepWorkersAlive() const
+{
+    // an archive failing its verification or a transient failure is queued again
+    return _scanner || !_verifying.isEmpty() || !_verifications.isEmpty() || !_retries.isEmpty() || _watcher || _jobServer || (_coordClient && !_coordClient->isOver());
+}
+
+void ScenePacker::_entryFailed(const PackEntry &entry, RarFailure::Kind kind, const QString &message)
+{
+    _recordFailure(entry, kind, -1, message);
+    _knownEntries.remove(entry.fi.absoluteFilePath());
+    _entryStatus(entry, PackStatusModel::State::Failed);
+    _jobEntryDone(entry.jobId, false, false);
+    if (entry.leaseId != 0 && _coordClient)
+        _coordClient->sendResult(entry.leaseId, false, QString(), QString(), QString(), QStringList());
+}
+
+bool ScenePacker::_retryLater(ExtProcess *extProc, RarFailure::Kind kind)
+{
+    PackEntry entry = _procEntries.value(extProc);
+    PackJob  *job   = _jobs.value(entry.jobId, nullptr);
+    if (_stopProcess || !RarFailure::isTransient(kind) || entry.attempts + 1 >= sMaxPackAttempts
+            || (job && job->isFinished()))
+        return false;
+
+    _procEntries.remove(extProc);
+    qint64 delayMs = static_cast<qint64>(sRetryBaseMs) << entry.attempts++;
+    _retries << RetryEntry{entry, QDateTime::currentMSecsSinceEpoch() + delayMs};
+    ++_metrics.nbRetried;
+    _armRetryTimer();
+    _entryStatus(entry, PackStatusModel::State::Retrying);
+    if (_events)
+        _entryEvent("retry", entry, {{"class", RarFailure::name(kind)}, {"delayMs", delayMs}, {"attempt", entry.attempts + 1}});
+    _log(tr("%1 will be packed again in %2 (attempt %3/%4)").arg(entry.fi.absoluteFilePath()).arg(
+             _durationStr(delayMs)).arg(entry.attempts + 1).arg(sMaxPackAttempts));
+
+    if (job)
+        --job->nbRunning; // it is counted again when it starts
+    --_nbCompressed;
+    _hmiProgress();
+    _processNextFolder(extProc);
+    return true;
+}
+
+void ScenePacker::_armRetryTimer()
+{
+    if (_retries.isEmpty())
+    {
+        _retryTimer.stop();
+        return;
+    }
+
+    qint64 nextRetry = _retries.first().retryAt;
+    for (const RetryEntry &retry : _retries)
+        nextRetry = std::min(nextRetry, retry.retryAt);
+    _retryTimer.start(static_cast<int>(std::max<qint64>(0, nextRetry - QDateTime::currentMSecsSinceEpoch())));
+}
+
+void ScenePacker::onRetryTimeout()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = _retries.begin(); it != _retries.end(); )
+    {
+        if (it->retryAt > now)
+        {
+            ++it;
+            continue;
+        }
+
+        PackJob *job = _jobs.value(it->entry.jobId, nullptr);
+        if (!(job && job->isFinished())) // canceled while waiting
+        {
+            _entryStatus(it->entry, PackStatusModel::State::Queued);
+            _entriesToCompress << it->entry;
+        }
+        it = _retries.erase(it);
+    }
+    _armRetryTimer();
+
+    _wakeIdleProcs();
+    if (!_keepWorkersAlive())
+        _releaseIdleProcs();
+}
+
+void ScenePacker::_recordFailure(const PackEntry &entry, RarFailure::Kind kind, int exitCode, const QString &message)
+{
+    _failures << FailedEntry{entry.fi.absoluteFilePath(), kind, exitCode, entry.attempts + 1, message};
+    ++_metrics.nbFailed;
+    if (_events)
+        _entryEvent("failed", entry, {{"class",    RarFailure::name(kind)},
+                                      {"exitCode", exitCode},
+                                      {"attempts", entry.attempts + 1},
+                                      {"message",  message}});
+}
+
+ScenePacker::PackMetrics::PackMetrics():
+    nbQueued(0), nbDone(0), nbFailed(0), nbRetried(0),
+    bytesIn(0), bytesOut(0), busySec(0.),
+    spawnSec({0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.}),
+    compressSec({1., 5., 15., 60., 300., 900., 3600., 4*3600.}),
+    sfvSec({0.1, 0.5, 1., 5., 15., 60., 300.})
+{}
+
+QByteArray ScenePacker::_metricsExposition() const
+{
+    int nbWorkers = _extProcs.size();
+    int nbRunning = _nbActiveProcs();
+
+    QByteArray out;
+    out.reserve(4096);
+    MetricsServer::writeCounter(out, "scenepacker_entries_queued_total",  "entries queued to be packed", _metrics.nbQueued);
+    MetricsServer::writeCounter(out, "scenepacker_entries_done_total",    "entries packed successfully", _metrics.nbDone);
+    MetricsServer::writeCounter(out, "scenepacker_entries_failed_total",  "entries given up", _metrics.nbFailed);
+    MetricsServer::writeCounter(out, "scenepacker_entries_retried_total", "entries queued again after a transient failure or a broken archive", _metrics.nbRetried);
+    MetricsServer::writeCounter(out, "scenepacker_bytes_in_total",        "size of the entries packed", _metrics.bytesIn);
+    MetricsServer::writeCounter(out, "scenepacker_bytes_out_total",       "size of their volumes", _metrics.bytesOut);
+    MetricsServer::writeCounter(out, "scenepacker_worker_busy_seconds_total", "time spent by the workers running rar or par2", _metrics.busySec);
+
+    MetricsServer::writeGauge(out, "scenepacker_entries_running",  "rar processes running (not paused)", nbRunning);
+    MetricsServer::writeGauge(out, "scenepacker_queue_depth",      "entries waiting for a worker", _entriesToCompress.size());
+    MetricsServer::writeGauge(out, "scenepacker_retries_pending",  "entries waiting for their backoff", _retries.size());
+    MetricsServer::writeGauge(out, "scenepacker_verifications",    "archives being verified or waiting to be", _verifying.size() + _verifications.size());
+    MetricsServer::writeGauge(out, "scenepacker_workers",          "rar processes of the run", nbWorkers);
+    MetricsServer::writeGauge(out, "scenepacker_worker_utilisation", "ratio of the workers running", nbWorkers > 0 ? static_cast<double>(nbRunning) / nbWorkers : 0.);
+    MetricsServer::writeGauge(out, "scenepacker_paused",           "1 while paused", _paused ? 1 : 0);
+    MetricsServer::writeGauge(out, "scenepacker_run_entries",      "entries of the current run", _nbTotal);
+    MetricsServer::writeGauge(out, "scenepacker_run_done",         "entries of the current run already processed", _nbCompressed);
+
+    _metrics.spawnSec.write(out,    "scenepacker_spawn_seconds",    "from the start of a process to its exec");
+    _metrics.compressSec.write(out, "scenepacker_compress_seconds", "rar run of the entries packed successfully (without the pauses)");
+    _metrics.sfvSec.write(out,      "scenepacker_sfv_seconds",      "sfv and hashes of the volumes of an archive");
+    return out;
+}
+
+void ScenePacker::_entryQueued(const PackEntry &entry)
+{
+    if (_watchMode) // not detected again while it's queued, packing or packed
+        _knownEntries << entry.fi.absoluteFilePath();
+    if (_dryRun) // only planned
+        return;
+
+    ++_metrics.nbQueued;
+    if (!_coordinator && _needsSample(entry)) // ready when it's dispatched
+        _startSample(entry);
+    _entryStatus(entry, PackStatusModel::State::Queued);
+    if (_events)
+        _entryEvent("queued", entry, {{"prio", entry.priority}});
+}
+
+void ScenePacker::_entryStatus(const PackEntry &entry, PackStatusModel::State state, int worker, qint64 expectedMs)
+{
+#ifndef __CLI_ONLY__
+    if (_hmi)
+        _hmi->entryStatus(entry.fi.absoluteFilePath(), state, entry.size, worker, expectedMs);
+#else
+    Q_UNUSED(entry) Q_UNUSED(state) Q_UNUSED(worker) Q_UNUSED(expectedMs)
+#endif
+}
+
+void ScenePacker::_entryEvent(const char *event, const PackEntry &entry, QJsonObject fields)
+{
+    fields.insert("path",  entry.fi.absoluteFilePath());
+    fields.insert("bytes", entry.size);
+    fields.insert("files", entry.nbFiles);
+    if (entry.jobId != 0)
+        fields.insert("job", entry.jobId);
+    _events->write(event, fields);
+}
+
+void ScenePacker::_writeFailureReport()
+{
+    if (_failures.isEmpty())
+        return;
+
+    QString reportPath = QString("%1/%2_failed_%3.tsv").arg(sLogFolder).arg(sAppName).arg(
+                QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    QFile report(reportPath);
+    if (!report.open(QIODevice::WriteOnly|QIODevice::Text))
+    {
+        _error(tr("Couldn't write the failure report %1").arg(reportPath));
+        return;
+    }
+
+    QMap<QString, int> nbByKind;
+    QTextStream stream(&report);
+    stream << "# " << sAppName << " failures of " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n"
+           << "# path\tclass\texit code\tattempts\tmessage\n";
+    for (const FailedEntry &failure : _failures)
+    {
+        QString kind = RarFailure::name(failure.kind);
+        ++nbByKind[kind];
+        stream << failure.path << "\t" << kind << "\t" << failure.exitCode << "\t" << failure.attempts << "\t"
+               << QString(failure.message).replace('\t', ' ').replace('\n', ' ') << "\n";
+    }
+    stream.flush();
+
+    QStringList kinds;
+    for (auto it = nbByKind.cbegin(); it != nbByKind.cend(); ++it)
+        kinds << QString("%1: %2").arg(it.key()).arg(it.value());
+    _error(tr("<b> => %1 entries failed (%2), re-run them with --entries %3</b>").arg(
+               _failures.size()).arg(kinds.join(", ")).arg(reportPath));
+    _failures.clear();
+}
+
+int ScenePacker::_loadEntries(const QString &entriesFile)
+{
+    QFile file(entriesFile);
+    if (!file.open(QIODevice::ReadOnly|QIODevice::Text))
+    {
+        _error(tr("Couldn't read the entries file %1").arg(entriesFile));
+        return 0;
+    }
+
+    int nbEntries = 0;
+    QTextStream stream(&file);
+    while (!stream.atEnd())
+    {
+        QString line = stream.readLine();
+        if (line.trimmed().isEmpty() || line.startsWith('#'))
+            continue;
+
+        QFileInfo fi(line.section('\t', 0, 0)); // the failure report has more columns
+        if (!fi.exists() || fi.isSymLink() || !fi.isReadable())
+        {
+            _error(tr("Skip %1: not a readable file or folder").arg(fi.filePath()));
+            continue;
+        }
+
+        int    nbFiles = 1;
+        qint64 size    = fi.isDir() ? DirScanner::folderSize(fi.absoluteFilePath(), &nbFiles) : fi.size();
+        PackEntry entry(fi, fi.isDir(), size, nbFiles);
+        _setEntryPriority(entry, fi.absolutePath());
+        _entryQueued(entry);
+        _entriesToCompress << entry;
+        ++nbEntries;
+    }
+    return nbEntries;
+}
+
+bool ScenePacker::_startCoordinator(const QString &address, const QString &secretFile, const QStringList &srcFolders)
+{
+    // the workers of another box need an address (0.0.0.0 for all of them)
+    int sep = address.lastIndexOf(':');
+    bool ok = false;
+    quint16 portNum = address.mid(sep + 1).toUShort(&ok);
+    QHostAddress hostAddress(QHostAddress::LocalHost);
+    if (sep > 0 && !hostAddress.setAddress(address.left(sep)))
+        ok = false;
+    if (!ok || portNum == 0)
+    {
+        _error(tr("you should provide a valid TCP port for the coordinator, optionally after its address: [address:]port"));
+        return false;
+    }
+
+    QByteArray secret;
+    if (!_readSecret(secretFile, secret))
+        return false;
+
+    QString err;
+    _coordinator = new Coordinator(secret, this);
+    if (!_coordinator->listen(hostAddress, portNum, err))
+    {
+        _error(tr("Couldn't start the coordinator: %1").arg(err));
+        delete _coordinator;
+        _coordinator = nullptr;
+        return false;
+    }
+    connect(_coordinator, &Coordinator::resultReceived, this, &ScenePacker::onRemoteResult);
+    connect(_coordinator, &Coordinator::allDone, this, &ScenePacker::onCoordinatorDone, Qt::QueuedConnection); // event loop may not be started
+    connect(_coordinator, &Coordinator::log, this, [this](const QString &msg){ _log(msg); });
+    connect(_coordinator, &Coordinator::leaseReissued, this, [this](const QString &worker, const QString &path){
+        _error(tr("Lease of %1 lost by %2, it will be given to another worker").arg(path).arg(worker));
+    });
+
+    _log(tr("<b>Coordinator listening on %1:%2</b>").arg(hostAddress.toString()).arg(portNum));
+    processFolders(srcFolders);
+    return true;
+}
+
+void ScenePacker::onRemoteResult(const QString &worker, const QJsonObject &result)
+{
+    ++_nbCompressed;
+    _hmiProgress();
+
+    QString srcFolder = result.value("source").toString();
+    if (result.value("ok").toBool())
+    {
+        _log(tr("- %1 compressed by %2").arg(srcFolder).arg(worker));
+        ++_metrics.nbDone;
+        _writeHistory(srcFolder,
+                      result.value("dstFolder").toString(),
+                      result.value("archive").toString(),
+                      result.value("password").toString(),
+                      result.value("crcs").toVariant().toStringList());
+    }
+    else
+    {
+        _error(tr("Error during compression of %1 by %2").arg(srcFolder).arg(worker));
+        _failures << FailedEntry{srcFolder, RarFailure::Kind::Unknown, -1, 0, tr("failed on %1").arg(worker)};
+        ++_metrics.nbFailed;
+    }
+}
+
+void ScenePacker::onCoordinatorDone()
+{
+    _logTimeElapsed();
+    _writeFailureReport();
+    _clear();
+    if (_hmi)
+        _hmiIdle();
+    else
+        qApp->quit();
+}
+
+bool ScenePacker::_readSecret(const QString &secretFile, QByteArray &secret)
+{
+    // in a file so it doesn't show in the process list
+    QFile file(secretFile);
+    if (secretFile.isEmpty() || !file.open(QIODevice::ReadOnly|QIODevice::Text))
+    {
+        _error(tr("the coordinator and its workers need the file of their shared secret (--%1)").arg(sParamNames[Param::Secret]));
+        return false;
+    }
+
+    secret = file.readLine().trimmed();
+    if (secret.isEmpty())
+    {
+        _error(tr("the secret file %1 is empty").arg(secretFile));
+        return false;
+    }
+    return true;
+}
+
+bool ScenePacker::_startWorker(const QString &address, const QString &secretFile)
+{
+    int sep = address.lastIndexOf(':');
+    bool ok = false;
+    quint16 port = sep > 0 ? address.mid(sep + 1).toUShort(&ok) : 0;
+    if (!ok || port == 0)
+    {
+        _error(tr("you should provide the address of the coordinator as host:port"));
+        return false;
+    }
+
+    QByteArray secret;
+    if (!_readSecret(secretFile, secret))
+        return false;
+
+    _coordClient = new CoordinatorClient(threads(), secret, this);
+    connect(_coordClient, &CoordinatorClient::optionsReceived, this, &ScenePacker::onCoordinatorOptions);
+    connect(_coordClient, &CoordinatorClient::entryLeased,     this, &ScenePacker::onEntryLeased);
+    connect(_coordClient, &CoordinatorClient::over,            this, &ScenePacker::onCoordinatorOver);
+    _coordClient->connectToCoordinator(address.left(sep), port);
+
+    processFolders(QStringList());
+    return true;
+}
+
+void ScenePacker::onCoordinatorOptions(const QVariantHash &options)
+{
+    _coordJobId = ++_lastJobId;
+    _jobs.insert(_coordJobId, new PackJob(_coordJobId, QStringList(), options));
+    _log(tr("<b>Connected to the coordinator, waiting for entries...</b>"));
+}
+
+void ScenePacker::onEntryLeased(int leaseId, const PackEntry &entry, bool reissued)
+{
+    PackEntry leased(entry);
+    leased.jobId   = _coordJobId;
+    leased.leaseId = leaseId;
+
+    PackJob *job = _jobs.value(_coordJobId, nullptr);
+    if (job)
+        ++job->nbEntries;
+
+    // a dead worker may have left a partial archive
+    _setCurrentJob(_coordJobId);
+    if (reissued && (useDestinationFolder() || _setRarFolder(entry.fi.absolutePath())))
+    {
+        QDir staleDir(_dstDir->filePath(_dstFolderForEntry(leased)));
+        if (staleDir.exists())
+        {
+            _log(tr("Removing the partial archive folder %1").arg(staleDir.absolutePath()));
+            if (!_discardFolder(staleDir.absolutePath()))
+            {
+                _entryFailed(leased, RarFailure::Kind::Destination, tr("couldn't remove %1").arg(staleDir.absolutePath()));
+                return;
+            }
+        }
+    }
+
+    _enqueueEntry(leased);
+}
+
+void ScenePacker::onCoordinatorOver(const QString &reason)
+{
+    _log(tr("<b>Coordinator: %1</b>").arg(reason));
+    _idleProcs.clear();
+    _abandonLeases(); // none left when it's because there are no more entries
+    if (!_extProcs.isEmpty() && _allProcessesDone()) // no finished signal will come to end the run
+        _processNextFolder(_extProcs.first());
+}
+
+void ScenePacker::_abandonLeases()
+{
+    // the coordinator gives our leases to other workers (lost connection or expired leases):
+    // whatever we still do on them must neither be reported nor touch their destination
+    bool storing = false;
+    for (ExtProcess *extProc : _extProcs)
+    {
+        auto it = _procEntries.constFind(extProc);
+        if (it == _procEntries.cend() || it->leaseId == 0)
+            continue;
+
+        _abandonedLeases << it->leaseId;
+        if (extProc->isInProcess())
+            storing = true;
+        if (extProc->state() != QProcess::NotRunning) // rar or par2
+        {
+            extProc->resume(); // a stopped process wouldn't handle the SIGTERM
+            extProc->terminate();
+        }
+    }
+    if (storing)
+        _storeCancel = true; // all our entries are leased in worker mode
+
+    for (auto it = _verifying.cbegin() ; it != _verifying.cend() ; ++it)
+    {
+        if (it->packed.entry.leaseId == 0)
+            continue;
+
+        _abandonedLeases << it->packed.entry.leaseId;
+        it.key()->resume();
+        it.key()->terminate();
+    }
+
+    // and the ones not started
+    for (auto it = _verifications.begin() ; it != _verifications.end() ; )
+    {
+        if (it->entry.leaseId != 0)
+        {
+            _dropEntry(it->entry, true);
+            it = _verifications.erase(it);
+        }
+        else
+            ++it;
+    }
+    for (auto it = _retries.begin() ; it != _retries.end() ; )
+    {
+        if (it->entry.leaseId != 0)
+        {
+            _dropEntry(it->entry, false);
+            it = _retries.erase(it);
+        }
+        else
+            ++it;
+    }
+    _armRetryTimer();
+    _entriesToCompress.removeIf([this](const PackEntry &entry){
+        if (entry.leaseId == 0)
+            return false;
+        _dropEntry(entry, false);
+        return true;
+    });
+}
+
+void ScenePacker::_dropEntry(const PackEntry &entry, bool started)
+{
+    _log(tr("%1 dropped: its lease #%2 was lost").arg(entry.fi.absoluteFilePath()).arg(entry.leaseId));
+    _abandonedLeases.remove(entry.leaseId);
+    _entryStatus(entry, PackStatusModel::State::Failed);
+    _jobEntryDone(entry.jobId, false, started);
+}
+
+void ScenePacker::_syntax(char *appName)
+{
+    QString app = QFileInfo(appName).fileName();
+    _cout << desc() << "\n"
+          << tr("Syntax: ") << app << " (options)* (-i <src_folder>)+ (-o <dst_path>| -x <rar_folder>)\n";
+    for (const QCommandLineOption & opt : sCmdOptions)
+    {
+        if (opt.names().size() == 1)
+            _cout << QString("\t--%1: %2\n").arg(opt.names().first(), -17).arg(tr(opt.description().toLocal8Bit().constData()));
+        else
+            _cout << QString("\t-%1: %2\n").arg(opt.names().join(" or --"), -18).arg(tr(opt.description().toLocal8Bit().constData()));
+    }
+    _cout << "\n"
+          << "Examples: \n"
+          << "  1.: using dst path:   " << appName << " -i ~/Downloads/folder1 -i ~/Downloads/folder2 -o /tmp/archives --genName --genPass --lengthPass 17\n"
+          << "  2.: using rar folder: " << appName << " -i ~/Downloads/folder1 -i ~/Downloads/folder2 -x _rar --sfv\n"
+          << endl
+          << "The first example will create all archives from both folder1 and folder2 inside the destination folder /tmp/archives\n"
+          << "The second example, will create a '_rar' folder in both folder1 et folder2 with their respective archives\n"
+          << endl << flush;
+}
+
+
+void ScenePacker::_logTimeElapsed()
+{
+    int duration = static_cast<int>(_timeStart.elapsed());
+    double sec = static_cast<double>(duration)/1000.;
+
+    _log(tr("<br/><b> => %1/%2 entries compressed in %3 sec (%4)</b>").arg(
+             _nbCompressed).arg(_nbTotal).arg(
+             std::round(sec)).arg(QTime::fromMSecsSinceStartOfDay(duration).toString("hh:mm:ss.zzz")));
+    if (_nbStored > 0)
+        _log(tr("<b> => %1 already compressed entries stored, saving ~%2 of cpu time</b>").arg(
+                 _nbStored).arg(_durationStr(_savedCpuMs)));
+    if (_events)
+    {
+        _events->write("run_finished", {{"done",       _nbCompressed},
+                                        {"total",      _nbTotal},
+                                        {"failed",     _failures.size()},
+                                        {"stored",     _nbStored},
+                                        {"durationMs", duration}});
+        _events->flush();
+    }
+}
+
+
+void ScenePacker::setThreads(int nb)
+{
+    if( nb < 1)
+        nb  = 1;
+    else if (nb > QThread::idealThreadCount())
+        nb = QThread::idealThreadCount();
+
+    _config()->setValue(sParamNames[Param::Threads], nb);
+}
+
+
+bool ScenePacker::setRarCmd(const QString &path)
+{
+    QFileInfo fi(path);
+    if (fi.exists() && fi.isFile() && fi.isExecutable())
+    {
+        _config()->setValue(sParamNames[Param::CmdRar], path);
+        if (path.toLower().endsWith("winrar.exe"))
+            _useWinrar = true;
+        return true;
+    }
+    else
+        return false;
+}
+
+bool ScenePacker::setPar2Cmd(const QString &path)
+{
+    QFileInfo fi(path);
+    if (fi.exists() && fi.isFile() && fi.isExecutable())
+    {
+        _config()->setValue(sParamNames[Param::CmdPar2], path);
+        return true;
+    }
+    else
+        return false;
+}
+
+QString ScenePacker::par2Path() const
+{
+    QString path = _config()->value(sParamNames[Param::CmdPar2]).toString();
+    return path.isEmpty() ? QStandardPaths::findExecutable("par2") : path;
+}
+
+void ScenePacker::setSrcFolder(const QString &srcFolder)
+{
+    _config()->setValue(sParamNames[Param::SrcFolder], srcFolder);
+}
+
+void ScenePacker::setRarFolder(const QString &folderName)
+{
+    _config()->setValue(sParamNames[Param::RarFolder], folderName);
+}
+
+
+
+bool ScenePacker::setDstFolder(const QString &path)
+{
+    QFileInfo fi(path);
+    if (fi.exists() && fi.isDir() && fi.isWritable())
+    {
+        if (_dstDir)
+            delete _dstDir;
+        _dstDir = new QDir(path);
+        _config()->setValue(sParamNames[Param::DstPath], path);
+        return true;
+    }
+    else
+        return false;
+}
+
+void ScenePacker::setRarPrefix(const QString &prefix)
+{
+    _config()->setValue(sParamNames[Param::RarPrefix], prefix);
+}
+
+bool ScenePacker::_setRarFolder(const QString &path)
+{
+    const QString dstFolder(rarFolder());
+    QFileInfo fi(QString("%1/%2").arg(path).arg(dstFolder));
+    if (!fi.exists() && _dryRun)
+    {
+        if (_dstDir)
+            delete _dstDir;
+        _dstDir = new QDir(fi.absoluteFilePath());
+        return QFileInfo(path).isWritable();
+    }
+    if (!fi.exists())
+    {
+        QDir dir(path);
+        if (!dir.mkdir(dstFolder))
+        {
+//            _error(tr("Couldn't create rar folder: %1").arg(fi.absoluteFilePath()));
+            return false;
+        }
+    }
+    if (fi.exists() && fi.isDir() && fi.isWritable())
+    {
+        if (_dstDir)
+            delete _dstDir;
+        _dstDir = new QDir(fi.absoluteFilePath());
+        return true;
+    }
+    else
+        return false;
+}
+
+void ScenePacker::setDebug(bool debug) { _config()->setValue(sParamNames[Param::Debug], debug); }
+void ScenePacker::setDispSettings(bool disp) { _config()->setValue(sParamNames[Param::DispSettings], disp); }
+void ScenePacker::setUseDestinationFolder(bool useDstFolder) { _config()->setValue(sParamNames[Param::DstChoice], useDstFolder); }
+void ScenePacker::setAutoLevel(bool autoLevel) { _config()->setValue(sParamNames[Param::AutoLevel], autoLevel); }
+
+QStringList ScenePacker::storeExtensions() const
+{
+    QStringList exts = _value(Param::StoreExt).toStringList();
+    return exts.isEmpty() ? sDefaultStoreExtensions : exts;
+}
 
 void ScenePacker::saveSettings(bool genSfv,
                                bool genName,
@@ -792,20 +3728,20 @@ void ScenePacker::saveSettings(bool genSfv,
                                bool lockArchive,
                                int compressLevel)
 {
-    _settings->setValue(sParamNames[Param::GenSfv],       genSfv);
-    _settings->setValue(sParamNames[Param::GenName],      genName);
-    _settings->setValue(sParamNames[Param::LengthName],   lengthName);
-    _settings->setValue(sParamNames[Param::GenPass],      genPass);
-    _settings->setValue(sParamNames[Param::LengthPass],   lengthPass);
-    _settings->setValue(sParamNames[Param::UseFixedPass], useFixedPass);
-    _settings->setValue(sParamNames[Param::FixedPass],    fixedPath);
-    _settings->setValue(sParamNames[Param::SplitArchive], splitArchive);
-    _settings->setValue(sParamNames[Param::SplitSize],    splitSize);
-    _settings->setValue(sParamNames[Param::AddRecovery],  addRecovery);
-    _settings->setValue(sParamNames[Param::RecoveryPct],  recoveryPct);
-    _settings->setValue(sParamNames[Param::LockArchive],  lockArchive);
-    _settings->setValue(sParamNames[Param::CompressLevel],compressLevel);
-    _settings->setValue(sParamNames[Param::LogPerRun],    _logPerRun);
+    _config()->setValue(sParamNames[Param::GenSfv],       genSfv);
+    _config()->setValue(sParamNames[Param::GenName],      genName);
+    _config()->setValue(sParamNames[Param::LengthName],   lengthName);
+    _config()->setValue(sParamNames[Param::GenPass],      genPass);
+    _config()->setValue(sParamNames[Param::LengthPass],   lengthPass);
+    _config()->setValue(sParamNames[Param::UseFixedPass], useFixedPass);
+    _config()->setValue(sParamNames[Param::FixedPass],    fixedPath);
+    _config()->setValue(sParamNames[Param::SplitArchive], splitArchive);
+    _config()->setValue(sParamNames[Param::SplitSize],    splitSize);
+    _config()->setValue(sParamNames[Param::AddRecovery],  addRecovery);
+    _config()->setValue(sParamNames[Param::RecoveryPct],  recoveryPct);
+    _config()->setValue(sParamNames[Param::LockArchive],  lockArchive);
+    _config()->setValue(sParamNames[Param::CompressLevel],compressLevel);
+    _config()->setValue(sParamNames[Param::LogPerRun],    _logPerRun);
 }
 
 const QString ScenePacker::sASCII = "\
@@ -22,15 +22,42 @@
 #ifndef SCENEPACKER_H
 #define SCENEPACKER_H
 #include "CmdOrGuiApp.h"
+#include "MetricsServer.h"
+#include "PackEntry.h"
+#include "PackJob.h"
+#include "PackQueue.h"
+#include "PackStatusModel.h"
+#include "ThroughputModel.h"
+#include "RandomGenerator.h"
+#include "RarFailure.h"
+#include "RarStoreWriter.h"
 #include <QCommandLineOption>
 #include <QTextStream>
-#include <QQueue>
 #include <QVector>
+#include <QQueue>
+#include <QSet>
+#include <QHash>
+#include <QMap>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRegularExpression>
 #include <QFileInfo>
 #include <QElapsedTimer>
 #include <QSettings>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
 class MainWindow;
-class QProcess;
+class ExtProcess;
+class DirScanner;
+class BackgroundScanner;
+class QTemporaryFile;
+class EventLog;
+class QFileSystemWatcher;
+class QSocketNotifier;
+class JobServer;
+class Coordinator;
+class CoordinatorClient;
 
 class ScenePacker : public QObject, public CmdOrGuiApp
 {
@@ -42,7 +69,16 @@ public:
                              GenPass, LengthPass, UseFixedPass, FixedPass,
                              AddRecovery, RecoveryPct,
                              SplitArchive, SplitSize,
-                             LockArchive, CompressLevel,
+                             LockArchive, CompressLevel, AutoLevel, StoreExt,
+                             Par2, CmdPar2, Hashes,
+                             Verify, VerifyProcs,
+                             NameChars, PassChars,
+                             Nice, IoClass, CpuAffinity, CGroup, Numa,
+                             CheckSpace, MinFree,
+                             Watch, QuietTime,
+                             Server, Socket, Submit, Status, Cancel,
+                             Coordinator, Worker, Secret,
+                             Priority, Plan, Entries, Events, Metrics, StoreWithRar,
                              Debug, DispSettings,
                              LogPerRun,
                              Help, Version
@@ -50,29 +86,171 @@ public:
 
     enum class DstChoice : bool {SrcFolder = false, DstFolder = true};
 
+    enum class Admission : char {Admit = 0, Wait, Reject};
+
+    struct SourcePriority
+    {
+        int    priority; //!< the higher the sooner
+        qint64 deadline; //!< ms since epoch (0: none)
+    };
+
+    struct PatternPriority
+    {
+        QString            patternPrio; //!< as given: <wildcard>:<priority>
+        QRegularExpression regExp;      //!< on the entry names
+        int                priority;
+    };
+
 private:
+    //! new entry of a watched folder that we don't pack until it stops changing
+    struct PendingEntry
+    {
+        PackEntry     entry;
+        QElapsedTimer quietFor; //!< since the last change of its size or number of files
+    };
+
+    //! archive created by rar, waiting for its verification or done
+    struct PackedEntry
+    {
+        PackEntry   entry;
+        QString     dstFolder;
+        QString     archiveName;
+        QString     password;
+        QStringList crcs;     //!< sfv lines
+    };
+
+    //! rar t and the check of the sfv are both needed
+    struct Verification
+    {
+        PackedEntry packed;
+        int         nbStages;
+        QStringList errors;
+    };
+
+    //! entry that failed for a transient reason, packed again after its backoff
+    struct RetryEntry
+    {
+        PackEntry entry;
+        qint64    retryAt; //!< ms since epoch
+    };
+
+    //! cumulated since the start (not reset by the runs) for the metrics endpoint
+    struct PackMetrics
+    {
+        quint64   nbQueued;
+        quint64   nbDone;
+        quint64   nbFailed;
+        quint64   nbRetried;
+        quint64   bytesIn;     //!< of the entries packed
+        quint64   bytesOut;    //!< of their volumes
+        double    busySec;     //!< rar and par2 running on the workers
+        Histogram spawnSec;
+        Histogram compressSec;
+        Histogram sfvSec;
+
+        PackMetrics();
+    };
+
+    //! for the failure report written at the end of the run
+    struct FailedEntry
+    {
+        QString          path;
+        RarFailure::Kind kind;
+        int              exitCode; //!< -1 if rar didn't run
+        int              attempts;
+        QString          message;
+    };
+
 
     QDir               *_dstDir;
 
     QTextStream         _cout; //!< stream for stdout
     QTextStream         _cerr; //!< stream for stderr
-    QVector<QProcess*>  _extProcs;
+    QVector<ExtProcess*> _extProcs;
 
-    QQueue<QFileInfo>   _entriesToCompress; //!< can also be folders
+    PackQueue           _entriesToCompress; //!< can also be folders
     int                 _nbTotal;
     int                 _nbCompressed;
+    int                 _nbStored;     //!< auto level: entries stored as incompressible
+    qint64              _savedCpuMs;   //!< auto level: estimation of what storing them saved
 
 
     QElapsedTimer       _timeStart;
 
-    QSettings          *_settings;
+    mutable QSettings  *_settings;       //!< opened on first use by _config()
+    QTemporaryFile     *_settingsSnapshot; //!< backs _settings once detached from the shared ones
+    mutable bool        _logFolderReady; //!< created and stats loaded by _initLogFolder()
     bool                _stopProcess;
 
     QFile              *_logFile;
     QTextStream         _logStream;
 
     bool                _useWinrar;
-    bool                _logPerRun;
+    mutable bool        _logPerRun;
+
+    QTimer              _admissionTimer;  //!< to retry the workers waiting for free space
+    QVector<ExtProcess*> _waitingProcs;   //!< workers that couldn't be admitted yet
+    bool                _waitingForSpace; //!< to log only once that we wait
+
+    bool                _watchMode;       //!< keep watching the source folders for new entries
+    QFileSystemWatcher *_watcher;         //!< inotify on Linux
+    QStringList         _polledFolders;   //!< the ones the watcher couldn't watch
+    QSet<QString>       _knownEntries;    //!< watch mode: entries queued, packing or packed
+    QSet<QString>       _usedNames;       //!< random archive names of the run
+    QHash<QString, PendingEntry> _pendingEntries;
+    QTimer              _watchTimer;      //!< checks the pending entries and polls
+    QSet<ExtProcess*>   _idleProcs;       //!< workers waiting for new entries
+
+    JobServer          *_jobServer;       //!< only in server mode
+    QMap<int, PackJob*> _jobs;            //!< submitted to the server
+    int                 _lastJobId;
+    PackJob            *_curJob;          //!< job whose options are returned by the getters (nullptr: QSettings)
+
+    Coordinator        *_coordinator;     //!< hands out our entries to remote workers
+    CoordinatorClient  *_coordClient;     //!< when we're a remote worker
+    int                 _coordJobId;      //!< job holding the options of the coordinator
+    QSet<int>           _abandonedLeases; //!< lost with the coordinator: what's still running on them is dropped
+
+    QHash<QString, SourcePriority> _srcPriorities; //!< by absolute path of the source folder
+    QVector<PatternPriority> _patternPriorities; //!< the first matching one applies
+
+    bool                _dryRun;          //!< --plan: don't create anything
+
+    mutable ThroughputModel _throughputModel; //!< fitted on the past runs of the host (loaded on first use)
+
+    BackgroundScanner  *_scanner;         //!< local run: scans while we compress
+    QThreadPool         _checksumPool;    //!< sfv and hashes of the archives, off the event loop
+
+    QHash<ExtProcess*, PackEntry> _procEntries;   //!< entry being packed by each rar process
+    QQueue<PackedEntry>           _verifications; //!< archives waiting for a verification process
+    QVector<ExtProcess*>          _verifyProcs;   //!< created on demand up to verifyProcs()
+    QHash<ExtProcess*, Verification> _verifying;  //!< by verification process
+
+    bool                _paused;          //!< processes stopped (SIGSTOP) and nothing dispatched
+    int                 _maxActive;       //!< throttle: rar processes allowed to run (0: all)
+    QSet<ExtProcess*>   _heldProcs;       //!< workers not dispatched because of the pause or the throttle
+    QSocketNotifier    *_signalNotifier;  //!< reads the signals written in sSignalPipe
+
+    QTimer              _killTimer;       //!< SIGKILL the processes that ignore the SIGTERM
+    bool                _quitting;        //!< SIGINT or SIGTERM received: quit once the processes are stopped
+    QThreadPool         _cleanupPool;     //!< removes the partial archive folders
+
+    QVector<RetryEntry>  _retries;        //!< transient failures waiting for their backoff
+    QTimer               _retryTimer;     //!< single shot on the earliest retry
+    QVector<FailedEntry> _failures;       //!< of the run
+    QString              _entriesFile;    //!< --entries: pack only the paths listed in there
+
+    EventLog            *_events;         //!< --events: JSON lines for the supervisors (nullptr if not asked)
+    PackMetrics          _metrics;
+    MetricsServer       *_metricsServer;  //!< --metrics: localhost http endpoint (nullptr if not asked)
+
+    QThreadPool          _storePool;      //!< single files stored without rar (one at most per worker)
+    std::atomic<bool>    _storeCancel;    //!< stops the in-process copies
+
+    QThreadPool          _samplePool;     //!< auto level: compressibility of the queued entries
+    QSet<QString>        _sampling;       //!< entries being sampled
+    QHash<QString, double> _sampledRatios; //!< by path, until they're dispatched
+    QSet<ExtProcess*>    _samplingProcs;  //!< workers waiting for the sample of the head of the queue
 
 public:
     explicit ScenePacker(int &argc, char *argv[]);
@@ -87,8 +265,18 @@ public:
     void processFolders(const QStringList &srcFolders);
     void stopProcessing();
 
+    void pauseProcessing();
+    void resumeProcessing();
+    void throttle(int nbProcs); //!< the surplus is stopped (not killed), 0: no limit
+    inline bool isPaused() const;
+
+    int  submitJob(const QStringList &srcFolders, const QVariantHash &options, int &nbEntries, QString &err); //!< 0 on error
+    bool cancelJob(int jobId, QString &err);
+    QJsonArray jobsStatus() const;
+
     void setThreads(int nb);
     bool setRarCmd(const QString &path);
+    bool setPar2Cmd(const QString &path);
     void setSrcFolder(const QString &srcFolder);
     void setRarFolder(const QString &folderName);
     bool setDstFolder(const QString &path);
@@ -96,6 +284,12 @@ public:
     void setDebug(bool debug);
     void setDispSettings(bool disp);
     void setUseDestinationFolder(bool useDstFolder);
+    void setAutoLevel(bool autoLevel);
+
+    void setSourcePriority(const QString &srcFolder, int priority, qint64 deadline = 0);
+    void clearSourcePriorities();
+    bool addPatternPriority(const QString &patternPrio); //!< <wildcard>:<priority>
+    void clearPatternPriorities();
 
 
     void saveSettings(bool genSfv = true,
@@ -113,11 +307,16 @@ public:
                       int  compressLevel = 0);
 
 
-    inline QString randomStr(int length) const;
+    QString randomStr(int length, const QString &alphabet) const;
 
     inline int     threads()       const;
     inline QString srcFolder()     const;
     inline QString rarPath()       const;
+    QString        par2Path()      const; //!< the one in the PATH by default
+    inline int     par2Pct()       const; //!< redundancy of the par2 files, 0: none
+    int            hashes()        const; //!< FileHasher::Digest flags of the sidecars
+    inline bool    verify()        const; //!< test the archives once created
+    inline int     verifyProcs()   const; //!< verifications in parallel
     inline QString dstPath()       const;
     inline QString rarPrefix()     const;
     inline DstChoice dstChoice()   const;
@@ -128,6 +327,8 @@ public:
     inline int     lengthName()    const;
     inline bool    genPass()       const;
     inline int     lengthPass()    const;
+    QString        nameChars()     const; //!< alphabet of the random names
+    QString        passChars()     const; //!< alphabet of the random passwords
     inline bool    useFixedPass()  const;
     inline QString fixedPass()     const;
     inline bool    splitArchive()  const;
@@ -136,12 +337,38 @@ public:
     inline int     recoveryPct()   const;
     inline bool    lockArchive()   const;
     inline int     compressLevel() const;
+    inline bool    autoLevel()     const;
+    QStringList    storeExtensions() const; //!< stored without compression in auto level
+    inline int     nice()          const;
+    inline QString ioClass()       const;
+    inline QString cpuAffinity()   const;
+    inline QString cgroup()        const;
+    inline bool    numa()          const;
+    inline bool    checkSpace()    const;
+    inline int     minFree()       const;
+    inline int     quietTime()     const;
     inline bool    debug()         const;
     inline bool    dispSettings()  const;
+    inline bool    storeWithRar()  const; //!< no in-process store
 
 
 public slots:
     void onProcFinished(int exitCode);
+    void onVerifyFinished(int exitCode);
+    void onUnixSignal();
+    void onKillTimeout();
+    void onRetryTimeout();
+    void onScannedEntries();
+    void onScanFinished();
+    void onAdmissionTimeout();
+    void onSrcFolderChanged(const QString &srcFolder);
+    void onWatchTimeout();
+
+    void onRemoteResult(const QString &worker, const QJsonObject &result);
+    void onCoordinatorDone();
+    void onCoordinatorOptions(const QVariantHash &options);
+    void onEntryLeased(int leaseId, const PackEntry &entry, bool reissued);
+    void onCoordinatorOver(const QString &reason);
 
     void onAbout();
     void onDonate();
@@ -149,12 +376,97 @@ public slots:
 
 
 private:
-    void _processNextFolder(QProcess *extProc);
-
-    inline QString _dstFolderForEntry(const QFileInfo &fi);
-    bool _entryExistInDstFolder(const QFileInfo &fi);
-
-    inline QString _archiveName(const QFileInfo &fi);
+    inline QVariant _value(Param param) const;
+
+    void _processNextFolder(ExtProcess *extProc);
+    void _rarFinished(ExtProcess *extProc, int exitCode, bool crashed, const QString &errOutput,
+                      qint64 wallMs, qint64 cpuMs, RarFailure::Kind failure = RarFailure::Kind::None);
+    bool _canStoreInProcess(const PackEntry &entry, int level, const QString &pass) const;
+    void _startStore(ExtProcess *extProc, const QString &srcPath, const QString &archivePath);
+    void _storeFinished(ExtProcess *extProc, RarFailure::Kind failure, const QString &err, qint64 durationMs,
+                        RarStoreWriter::Copy copy);
+    bool _startPar2(ExtProcess *extProc, const QString &dstFolder);
+    void _par2Finished(ExtProcess *extProc, int exitCode, bool crashed);
+    void _startChecksums(ExtProcess *extProc, const QString &dstFolder, const QString &archiveName);
+    void _stageDone(ExtProcess *extProc); //!< par2 or checksums, the entry is packed after the last one
+    void _entryPacked(ExtProcess *extProc, bool success, const QStringList &crcs);
+    void _entryDone(const PackedEntry &packed, bool success); //!< history, job and coordinator
+
+    void _startVerifications();
+    bool _startVerification(ExtProcess *verifyProc, const PackedEntry &packed);
+    void _verificationStageDone(ExtProcess *verifyProc);
+    void _releaseIdleProcs(); //!< when no more entries can come
+
+    int  _activeCap() const;
+    int  _nbActiveProcs() const; //!< running and not stopped
+    void _applyThrottle();       //!< stops or continues the processes according to the pause and the throttle
+    void _releaseHeldProcs();
+    void _setupSignals();
+    void _shutdown();
+    bool _discardFolder(const QString &folder); //!< renamed at once and removed in the background, false if it's still there
+    static void _postUnixSignal(int signal); //!< signal handler
+    bool _setProcessScheduling(ExtProcess *extProc, int workerIdx);
+
+    Admission _admitEntry(ExtProcess *extProc, const PackEntry &entry);
+    void   _releaseSpace(ExtProcess *extProc);
+    qint64 _pendingReservations(const QString &storageRoot) const;
+    qint64 _estimatedOutputSize(const PackEntry &entry, double ratio = -1.) const; //!< ratio < 0: default of the level
+    double _throughput(int compressLevel, int nbProcs) const; //!< bytes per sec of one rar process (without recovery)
+    qint64 _recordRun(ExtProcess *extProc, const QString &dstFolder); //!< returns the size of the volumes
+    int    _chooseLevel(const PackEntry &entry, double &ratio); //!< ratio: sampled or 1 for stored extensions, -1 if not auto
+    bool   _needsSample(const PackEntry &entry) const; //!< for the auto level (options of the current job)
+    void   _startSample(const PackEntry &entry);       //!< in the pool, unless it's already there
+    void   _sampleDone(const QString &path, double ratio);
+    qint64 _cpuMsEstimate(int compressLevel, qint64 size) const;
+    qint64 _etaMs() const;
+
+    void _plan(const QStringList &srcFolders);
+    static QString _durationStr(qint64 ms);
+
+    bool _acceptEntry(const PackEntry &entry, const DirScanner &scanner);
+    void _startWatching(const QStringList &srcFolders);
+    void _stopWatching();
+    void _scanNewEntries(const QString &srcFolder);
+    void _enqueueEntry(const PackEntry &entry);
+    void _wakeIdleProcs();
+    bool _keepWorkersAlive() const;
+
+    int  _scanSrcFolders(const QStringList &srcFolders, int jobId);
+    void _startBackgroundScan(const QStringList &srcFolders);
+    void _stopBackgroundScan();
+    void _setEntryPriority(PackEntry &entry, const QString &srcFolder) const;
+    bool _parseInput(const QString &input, QString &path, int &priority, qint64 &deadline) const;
+
+    bool _startServer(const QString &socketName);
+    void _requestServer(const QString &socketName, const QJsonObject &req);
+    QVariantHash _jobOptions() const;
+    bool _snapshotSettings(); //!< stops using the settings shared with the other runs
+    void _setCurrentJob(int jobId);
+    void _jobEntryDone(int jobId, bool success, bool started);
+    void _pruneJobs();
+    void _entryFailed(const PackEntry &entry, RarFailure::Kind kind, const QString &message); //!< before rar could start
+    bool _retryLater(ExtProcess *extProc, RarFailure::Kind kind); //!< false if the entry shouldn't be retried
+    void _armRetryTimer();
+    void _recordFailure(const PackEntry &entry, RarFailure::Kind kind, int exitCode, const QString &message);
+    void _writeFailureReport();
+    void _entryEvent(const char *event, const PackEntry &entry, QJsonObject fields = QJsonObject());
+    void _entryQueued(const PackEntry &entry); //!< metrics and event
+    void _abandonLeases();  //!< the coordinator gives them to other workers
+    void _dropEntry(const PackEntry &entry, bool started); //!< no result, no history, no cleanup
+    inline bool _isAbandoned(const PackEntry &entry) const;
+    void _entryStatus(const PackEntry &entry, PackStatusModel::State state, int worker = -1, qint64 expectedMs = 0); //!< GUI dashboard
+    QByteArray _metricsExposition() const;
+    int  _loadEntries(const QString &entriesFile);
+
+    bool _startCoordinator(const QString &address, const QString &secretFile, const QStringList &srcFolders);
+    bool _startWorker(const QString &address, const QString &secretFile);
+    bool _readSecret(const QString &secretFile, QByteArray &secret); //!< first line of the file
+    void _writeHistory(const QString &srcFolder, const QString &dstFolder, const QString &archiveName,
+                       const QString &password, const QStringList &crcs);
+
+    inline QString _dstFolderForEntry(const PackEntry &entry);
+
+    inline QString _archiveName(const PackEntry &entry);
 
     bool _setRarFolder(const QString &path);
 
@@ -162,8 +474,21 @@ private:
     void _log(const QString &msg, bool success = false);
     void _error(const QString &msg);
 
+    // GUI updates, no-ops in command line (and compiled out with __CLI_ONLY__)
+    void _hmiProgress(int max = -1); //!< _nbCompressed, and the max if given
+    void _hmiPaused(bool paused);
+    void _hmiIdle();
+
+    QSettings *_config() const; //!< opens the settings (writing the defaults the first time)
+    void _initLogFolder() const;
+    inline ThroughputModel &_stats() const;
+
     void _clear();
-    void _createSfv(const QString &folder, const QString &sfvFileName);
+    //! called in the checksum pool: returns the sfv lines, errors are given back to be logged
+    static QStringList _createChecksums(const QString &folder, const QString &archiveName,
+                                        int digests, bool manifest, QStringList &errors);
+    static bool _writeSidecar(const QString &path, const QStringList &lines);
+    static QStringList _checkSfv(const QString &folder, const QStringList &sfvLines); //!< returns the errors
 
     void _logTimeElapsed();
 
@@ -187,9 +512,40 @@ private:
     static constexpr const char *sPropertySrcFolder   = "srcFolder";
     static constexpr const char *sPropertyArchiveName = "archiveName";
     static constexpr const char *sPropertyPassword    = "password";
+    static constexpr const char *sPropertyReserved    = "reserved";
+    static constexpr const char *sPropertyStorage     = "storage";
+    static constexpr const char *sPropertyJobId       = "jobId";
+    static constexpr const char *sPropertyLeaseId     = "leaseId";
+    static constexpr const char *sPropertyInputSize   = "inputSize";
+    static constexpr const char *sPropertyNbProcs     = "nbProcs";
+    static constexpr const char *sPropertyLevel       = "level";
+    static constexpr const char *sPropertyPar2        = "par2";  //!< true while the process runs par2
+    static constexpr const char *sPropertyCrcs        = "crcs";  //!< sfv lines computed while par2 runs
+    static constexpr const char *sPropertyNbStages    = "nbStages"; //!< par2 and checksums still running
+    static constexpr const char *sPropertyInProcess   = "inProcess"; //!< stored without rar
+
+    static constexpr const char *sDefaultSocketName   = "scenePacker";
+    static constexpr int sMaxFinishedJobs = 100; //!< kept for the status requests
+
+    static constexpr qint64 sMB = 1024 * 1024;
+    static constexpr int sAdmissionRetryMs = 10000;
+    static constexpr int sMaxPackAttempts  = 3; //!< an entry failing transiently or its verification is packed again up to that
+    static constexpr int sRetryBaseMs      = 30000; //!< backoff of the first retry, doubled for each next one
+    static constexpr int sMaxThrottleSignal = 16; //!< SIGRTMIN+n throttles to n processes
+    static constexpr int sKillTimeoutMs     = 10000; //!< after a SIGTERM
+
+    static int sSignalPipe[2]; //!< the signal handlers write in it
+    static constexpr int sDefaultQuietTime = 30;   //!< in sec
+    static constexpr int sMinWatchCheckMs  = 1000;
+    static constexpr int sMaxWatchCheckMs  = 5000;
+    static const double  sCompressRatioEstimates[]; //!< output/input per compression level
+    static const double  sDefaultThroughputs[];     //!< MB/s of one rar process per compression level
+    static constexpr double sIncompressibleRatio = 0.97; //!< auto level: stored above that sampled ratio
+    static const QStringList sDefaultStoreExtensions;
 
 
     static const QMap<Param, QString>      sParamNames;
+    static const QList<Param>              sJobParams; //!< the ones a job can set
     static const QList<QCommandLineOption> sCmdOptions;
     static const QStringList sRarDefaultArgs;
 
@@ -215,17 +571,6 @@ void ScenePacker::_showVersionASCII()
     _cout << asciiArtWithVersion() << "\n\n" << flush;
 }
 
-QString ScenePacker::randomStr(int length) const
-{
-    if (length < 5)
-        length = 5;
-    QString str, alphabet("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789");
-    int nbLetters = alphabet.length();
-    for (int i = 0 ; i < length ; ++i)
-        str.append(alphabet.at(std::rand()%nbLetters));
-
-    return str;
-}
 
 
 
@@ -251,46 +596,86 @@ QString ScenePacker::asciiArtWithVersion()
     return QString("%1\n                                         v%2").arg(sASCII).arg(sVersion);
 }
 
-int     ScenePacker::threads()       const { return _settings->value(sParamNames[Param::Threads]).toInt(); }
+QVariant ScenePacker::_value(Param param) const
+{
+    const QString &key = sParamNames[param];
+    if (_curJob && _curJob->options.contains(key))
+        return _curJob->options.value(key);
+    else
+        return _config()->value(key);
+}
 
-QString ScenePacker::srcFolder()     const { return _settings->value(sParamNames[Param::SrcFolder]).toString(); }
-QString ScenePacker::rarPath()       const { return _settings->value(sParamNames[Param::CmdRar]).toString(); }
-QString ScenePacker::dstPath()       const { return _settings->value(sParamNames[Param::DstPath]).toString(); }
-QString ScenePacker::rarPrefix()     const { return _settings->value(sParamNames[Param::RarPrefix]).toString(); }
-ScenePacker::DstChoice ScenePacker::dstChoice() const { return static_cast<DstChoice>(_settings->value(sParamNames[Param::DstChoice]).toBool()); }
+int     ScenePacker::threads()       const { return _config()->value(sParamNames[Param::Threads]).toInt(); }
+
+QString ScenePacker::srcFolder()     const { return _config()->value(sParamNames[Param::SrcFolder]).toString(); }
+QString ScenePacker::rarPath()       const { return _config()->value(sParamNames[Param::CmdRar]).toString(); }
+QString ScenePacker::dstPath()       const { return _value(Param::DstPath).toString(); }
+QString ScenePacker::rarPrefix()     const { return _value(Param::RarPrefix).toString(); }
+ScenePacker::DstChoice ScenePacker::dstChoice() const { return static_cast<DstChoice>(_value(Param::DstChoice).toBool()); }
 bool    ScenePacker::useDestinationFolder() const { return dstChoice() == DstChoice::DstFolder; }
-QString ScenePacker::rarFolder()     const { return _settings->value(sParamNames[Param::RarFolder]).toString(); }
-bool    ScenePacker::genName()       const { return _settings->value(sParamNames[Param::GenName]).toBool(); }
-int     ScenePacker::lengthName()    const { return _settings->value(sParamNames[Param::LengthName]).toInt(); }
-bool    ScenePacker::genSfv()        const { return _settings->value(sParamNames[Param::GenSfv]).toBool(); }
-bool    ScenePacker::genPass()       const { return _settings->value(sParamNames[Param::GenPass]).toBool(); }
-int     ScenePacker::lengthPass()    const { return _settings->value(sParamNames[Param::LengthPass]).toInt(); }
-bool    ScenePacker::useFixedPass()  const { return _settings->value(sParamNames[Param::UseFixedPass]).toBool(); }
-QString ScenePacker::fixedPass()     const { return _settings->value(sParamNames[Param::FixedPass]).toString(); }
-bool    ScenePacker::splitArchive()  const { return _settings->value(sParamNames[Param::SplitArchive]).toBool(); }
-int     ScenePacker::splitSize()     const { return _settings->value(sParamNames[Param::SplitSize]).toInt(); }
-bool    ScenePacker::addRecovery()   const { return _settings->value(sParamNames[Param::AddRecovery]).toBool(); }
-int     ScenePacker::recoveryPct()   const { return _settings->value(sParamNames[Param::RecoveryPct]).toInt(); }
-bool    ScenePacker::lockArchive()   const { return _settings->value(sParamNames[Param::LockArchive]).toBool(); }
-int     ScenePacker::compressLevel() const { return _settings->value(sParamNames[Param::CompressLevel]).toInt(); }
-bool    ScenePacker::debug()         const { return _settings->value(sParamNames[Param::Debug]).toBool(); }
-bool    ScenePacker::dispSettings()  const { return _settings->value(sParamNames[Param::DispSettings]).toBool(); }
-
-
-QString ScenePacker::_dstFolderForEntry(const QFileInfo &fi)
+QString ScenePacker::rarFolder()     const { return _value(Param::RarFolder).toString(); }
+bool    ScenePacker::genName()       const { return _value(Param::GenName).toBool(); }
+int     ScenePacker::lengthName()    const { return _value(Param::LengthName).toInt(); }
+bool    ScenePacker::genSfv()        const { return _value(Param::GenSfv).toBool(); }
+bool    ScenePacker::genPass()       const { return _value(Param::GenPass).toBool(); }
+int     ScenePacker::lengthPass()    const { return _value(Param::LengthPass).toInt(); }
+bool    ScenePacker::useFixedPass()  const { return _value(Param::UseFixedPass).toBool(); }
+QString ScenePacker::fixedPass()     const { return _value(Param::FixedPass).toString(); }
+bool    ScenePacker::splitArchive()  const { return _value(Param::SplitArchive).toBool(); }
+int     ScenePacker::splitSize()     const { return _value(Param::SplitSize).toInt(); }
+bool    ScenePacker::addRecovery()   const { return _value(Param::AddRecovery).toBool(); }
+int     ScenePacker::recoveryPct()   const { return _value(Param::RecoveryPct).toInt(); }
+bool    ScenePacker::lockArchive()   const { return _value(Param::LockArchive).toBool(); }
+int     ScenePacker::compressLevel() const { return _value(Param::CompressLevel).toInt(); }
+bool    ScenePacker::autoLevel()     const { return _value(Param::AutoLevel).toBool(); }
+int     ScenePacker::par2Pct()       const { return _value(Param::Par2).toInt(); }
+bool    ScenePacker::isPaused()      const { return _paused; }
+bool    ScenePacker::verify()        const { return _value(Param::Verify).toBool(); }
+int     ScenePacker::verifyProcs()   const { return _config()->value(sParamNames[Param::VerifyProcs], 1).toInt(); }
+int     ScenePacker::nice()          const { return _config()->value(sParamNames[Param::Nice]).toInt(); }
+QString ScenePacker::ioClass()       const { return _config()->value(sParamNames[Param::IoClass]).toString(); }
+QString ScenePacker::cpuAffinity()   const { return _config()->value(sParamNames[Param::CpuAffinity]).toString(); }
+QString ScenePacker::cgroup()        const { return _config()->value(sParamNames[Param::CGroup]).toString(); }
+bool    ScenePacker::numa()          const { return _config()->value(sParamNames[Param::Numa]).toBool(); }
+bool    ScenePacker::checkSpace()    const { return _config()->value(sParamNames[Param::CheckSpace]).toBool(); }
+int     ScenePacker::minFree()       const { return _config()->value(sParamNames[Param::MinFree]).toInt(); }
+int     ScenePacker::quietTime()     const { return _config()->value(sParamNames[Param::QuietTime], sDefaultQuietTime).toInt(); }
+bool    ScenePacker::debug()         const { return _config()->value(sParamNames[Param::Debug]).toBool(); }
+bool    ScenePacker::storeWithRar()  const { return _config()->value(sParamNames[Param::StoreWithRar]).toBool(); }
+bool    ScenePacker::dispSettings()  const { return _config()->value(sParamNames[Param::DispSettings]).toBool(); }
+
+
+QString ScenePacker::_dstFolderForEntry(const PackEntry &entry)
 {
     if (useDestinationFolder())
-        return QString("%1%2").arg(rarPrefix()).arg(fi.isDir() ? fi.fileName() : fi.completeBaseName());
+        return QString("%1%2").arg(rarPrefix()).arg(entry.archiveFolderName());
     else
-        return fi.isDir() ? fi.fileName() : fi.completeBaseName();
+        return entry.archiveFolderName();
 }
 
-QString ScenePacker::_archiveName(const QFileInfo &fi)
+QString ScenePacker::_archiveName(const PackEntry &entry)
 {
     if (genName())
-        return QString("%1.rar").arg(randomStr(lengthName()));
+    {
+        QString name = RandomGenerator::uniqueStr(std::max(5, lengthName()), nameChars(), [this](const QString &str){
+            return _usedNames.contains(str);
+        });
+        _usedNames.insert(name);
+        return QString("%1.rar").arg(name);
+    }
     else
-        return QString("%1.rar").arg(fi.isDir() ? fi.fileName() : fi.completeBaseName());
+        return QString("%1.rar").arg(entry.isDir ? entry.fi.fileName() : entry.fi.completeBaseName());
+}
+
+bool ScenePacker::_isAbandoned(const PackEntry &entry) const
+{
+    return entry.leaseId != 0 && _abandonedLeases.contains(entry.leaseId);
+}
+
+ThroughputModel &ScenePacker::_stats() const
+{
+    _initLogFolder();
+    return _throughputModel;
 }
 
 #endif // SCENEPACKER_H
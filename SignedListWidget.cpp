@@ -24,11 +24,13 @@
 #include <QResizeEvent>
 
 SignedListWidget::SignedListWidget(QWidget *parent) :
-    QListWidget(parent),
-    _asciiLbl(new QLabel(this)),
-    _fileIcon(":/icons/file.png"),
-    _folderIcon(":/icons/folder.png")
+    QListView(parent),
+    _sources(new SourceListModel(this)),
+    _asciiLbl(new QLabel(this))
 {
+    setModel(_sources);
+    setUniformItemSizes(true); // no need to lay out all the rows
+    setSelectionMode(QAbstractItemView::ExtendedSelection);
     installEventFilter(this);
 }
 
@@ -54,50 +56,46 @@ void SignedListWidget::setAsciiSignature(QString ascii, bool escapeXML)
 
 void SignedListWidget::addPath(const QString &path, bool isDir)
 {
-    QListWidgetItem *item = new QListWidgetItem(isDir ? _folderIcon : _fileIcon, path);
-    addItem(item);
-    if (_asciiLbl->isVisible())
-        _asciiLbl->hide();
+    addPaths({path}, isDir);
 }
 
-bool SignedListWidget::addPathIfNotInList(const QString &path, int lastIndexToCheck, bool isDir)
+bool SignedListWidget::addPathIfNotInList(const QString &path, bool isDir)
 {
-    for (int i = 0 ; i < lastIndexToCheck ; ++i)
-    {
-        if (item(i)->text() == path)
-            return false;
-    }
+    return addPaths({path}, isDir) == 1;
+}
 
-    addPath(path, isDir);
-    return true;
+int SignedListWidget::addPaths(const QStringList &paths, bool isDir)
+{
+    int nbAdded = _sources->addPaths(paths, isDir);
+    if (nbAdded && _asciiLbl->isVisible())
+        _asciiLbl->hide();
+    return nbAdded;
 }
 
-//#include <QDebug>
-void SignedListWidget::removeItemWidget2(QListWidgetItem *item)
+void SignedListWidget::setPriority(int row, int priority, const QDateTime &deadline)
 {
-//    qDebug() << "[removeItemWidget2] count: " << count();
-    if (count() == 1)
-    {
-        removeItemWidget(item);
-        _asciiLbl->show();
-        emit empty();
-    }
-    else
-        removeItemWidget(item);
+    _sources->setPriority(row, priority, deadline);
 }
 
 void SignedListWidget::clear2()
 {
-    clear();
+    _sources->clear();
     _asciiLbl->show();
 }
 
 void SignedListWidget::onDeleteSelectedItems()
 {
-    for (QListWidgetItem *item : selectedItems())
+    QList<int> rows;
+    for (const QModelIndex &index : selectionModel()->selectedRows())
+        rows << index.row();
+    if (rows.isEmpty())
+        return;
+
+    _sources->removeSourceRows(rows);
+    if (count() == 0)
     {
-        removeItemWidget2(item);
-        delete item;
+        _asciiLbl->show();
+        emit empty();
     }
 }
 
@@ -113,7 +111,7 @@ void SignedListWidget::resizeEvent(QResizeEvent *e)
 
 void SignedListWidget::mousePressEvent(QMouseEvent *e)
 {
-    QListWidget::mousePressEvent(e);
+    QListView::mousePressEvent(e);
     if (e->button() == Qt::RightButton)
         emit rightClick();
 }
@@ -126,5 +124,5 @@ bool SignedListWidget::eventFilter(QObject *obj, QEvent *event)
         if(keyEvent->key() == Qt::Key_Delete || keyEvent->key() == Qt::Key_Backspace)
             onDeleteSelectedItems();
     }
-    return QListWidget::eventFilter(obj, event);
+    return QListView::eventFilter(obj, event);
 }
@@ -22,9 +22,11 @@
 #ifndef SIGNEDLISTWIDGET_H
 #define SIGNEDLISTWIDGET_H
 
-#include <QListWidget>
+#include <QListView>
+#include <QDateTime>
+#include "SourceListModel.h"
 class QLabel;
-class SignedListWidget : public QListWidget
+class SignedListWidget : public QListView
 {
     Q_OBJECT
 
@@ -35,9 +37,15 @@ public:
     void setAsciiSignature(QString ascii, bool escapeXML = true);
 
     void addPath(const QString &path, bool isDir = false);
-    bool addPathIfNotInList(const QString &path, int lastIndexToCheck, bool isDir = false);
+    bool addPathIfNotInList(const QString &path, bool isDir = false);
+    int  addPaths(const QStringList &paths, bool isDir = false); //!< returns the number of new ones
 
-    void removeItemWidget2(QListWidgetItem *item);
+    inline int count() const;
+    inline QString path(int row) const;
+
+    void setPriority(int row, int priority, const QDateTime &deadline = QDateTime());
+    inline int       priority(int row) const;
+    inline QDateTime deadline(int row) const;
 
 signals:
     void rightClick();
@@ -56,12 +64,14 @@ protected:
 
 
 private:
+    SourceListModel *_sources;
     QLabel *_asciiLbl;
     QSize   _sizeAscii;
-    QIcon   _fileIcon;
-    QIcon   _folderIcon;
 };
 
-
+int       SignedListWidget::count() const         { return _sources->rowCount(); }
+QString   SignedListWidget::path(int row) const     { return _sources->path(row); }
+int       SignedListWidget::priority(int row) const { return _sources->priority(row); }
+QDateTime SignedListWidget::deadline(int row) const { return _sources->deadline(row); }
 
 #endif // SIGNEDLISTWIDGET_H
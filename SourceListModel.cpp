@@ -0,0 +1,238 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "SourceListModel.h"
+#include "DirScanner.h"
+#include <QFileInfo>
+#include <QFont>
+#include <QPointer>
+#include <QRunnable>
+#include <algorithm>
+
+SourceListModel::SourceListModel(QObject *parent):
+    QAbstractListModel(parent),
+    _sources(), _rows(), _sizePool(),
+    _fileIcon(":/icons/file.png"),
+    _folderIcon(":/icons/folder.png")
+{
+    _sizePool.setMaxThreadCount(2); // the disks won't go faster with more
+}
+
+SourceListModel::~SourceListModel()
+{
+    _sizePool.clear();
+    _sizePool.waitForDone();
+}
+
+int SourceListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _sources.size();
+}
+
+QVariant SourceListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= _sources.size())
+        return QVariant();
+
+    const Source &source = _sources.at(index.row());
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        // only asked for the visible rows: that's when we size them
+        if (source.size < 0)
+        {
+            _requestSize(index.row());
+            return source.path;
+        }
+        else if (source.isDir)
+            return tr("%1    (%2 MB, %3 files)").arg(source.path).arg(source.size / sMB).arg(source.nbFiles);
+        else
+            return tr("%1    (%2 MB)").arg(source.path).arg(source.size / sMB);
+
+    case Qt::DecorationRole:
+        return source.isDir ? _folderIcon : _fileIcon;
+
+    case Qt::FontRole:
+        if (source.priority > 0 || source.deadline.isValid())
+        {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        return QVariant();
+
+    case Qt::ToolTipRole:
+    {
+        QString tip;
+        if (source.priority != 0)
+            tip = tr("priority: %1").arg(source.priority);
+        if (source.deadline.isValid())
+            tip += QString("%1%2").arg(tip.isEmpty() ? "" : "\n").arg(tr("deadline: %1").arg(source.deadline.toString("yyyy/MM/dd hh:mm")));
+        return tip.isEmpty() ? QVariant() : tip;
+    }
+
+    case PathRole:     return source.path;
+    case PriorityRole: return source.priority;
+    case DeadlineRole: return source.deadline;
+    default:           return QVariant();
+    }
+}
+
+int SourceListModel::addPaths(const QStringList &paths, bool isDir)
+{
+    QVector<Source> added;
+    for (const QString &path : paths)
+    {
+        if (_rows.contains(path))
+            continue;
+
+        _rows.insert(path, _sources.size() + added.size()); // also skips the duplicates of paths
+        added << Source{path, isDir, 0, QDateTime(), -1, 0, false};
+    }
+    if (added.isEmpty())
+        return 0;
+
+    beginInsertRows(QModelIndex(), _sources.size(), _sources.size() + added.size() - 1);
+    _sources << added;
+    endInsertRows();
+    return added.size();
+}
+
+void SourceListModel::removeSourceRows(QList<int> rows)
+{
+    if (rows.isEmpty())
+        return;
+
+    // contiguous ranges from the end so the rows before aren't moved
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    QVector<QPair<int, int>> ranges; // first, last
+    for (int row : rows)
+    {
+        if (!ranges.isEmpty() && ranges.last().first == row + 1)
+            ranges.last().first = row;
+        else
+            ranges << qMakePair(row, row);
+    }
+
+    if (ranges.size() > sMaxRemovedRanges)
+    {
+        // a scattered selection: one pass instead of moving the rows for each range
+        QVector<bool> removed(_sources.size(), false);
+        for (int row : rows)
+            removed[row] = true;
+
+        beginResetModel();
+        QVector<Source> kept;
+        kept.reserve(_sources.size() - rows.size());
+        for (int row = 0 ; row < _sources.size() ; ++row)
+        {
+            if (!removed.at(row))
+                kept << _sources.at(row);
+        }
+        _sources.swap(kept);
+        _reindex();
+        endResetModel();
+        return;
+    }
+
+    for (const QPair<int, int> &range : ranges)
+    {
+        beginRemoveRows(QModelIndex(), range.first, range.second);
+        _sources.remove(range.first, range.second - range.first + 1);
+        endRemoveRows();
+    }
+    _reindex();
+}
+
+void SourceListModel::clear()
+{
+    _sizePool.clear(); // the ones not started yet
+    beginResetModel();
+    _sources.clear();
+    _rows.clear();
+    endResetModel();
+}
+
+void SourceListModel::setPriority(int row, int priority, const QDateTime &deadline)
+{
+    Source &source  = _sources[row];
+    source.priority = priority;
+    source.deadline = deadline;
+    emit dataChanged(index(row), index(row), {Qt::FontRole, Qt::ToolTipRole, PriorityRole, DeadlineRole});
+}
+
+void SourceListModel::_requestSize(int row) const
+{
+    //! sizes a source in the pool and posts the result back to the model (if it is still there)
+    class SizeTask : public QRunnable
+    {
+    private:
+        QPointer<SourceListModel> _model;
+        const QString             _path;
+        const bool                _isDir;
+
+    public:
+        SizeTask(SourceListModel *model, const QString &path, bool isDir):
+            _model(model), _path(path), _isDir(isDir)
+        {}
+
+        void run() override
+        {
+            int    nbFiles = 1;
+            qint64 size    = _isDir ? DirScanner::folderSize(_path, &nbFiles) : QFileInfo(_path).size();
+            QPointer<SourceListModel> model = _model;
+            QString path = _path;
+            QMetaObject::invokeMethod(model.data(), [model, path, size, nbFiles]{
+                if (model)
+                    model->_sizeComputed(path, size, nbFiles);
+            }, Qt::QueuedConnection);
+        }
+    };
+
+    const Source &source = _sources.at(row);
+    if (source.sizing)
+        return;
+
+    source.sizing = true;
+    _sizePool.start(new SizeTask(const_cast<SourceListModel*>(this), source.path, source.isDir));
+}
+
+void SourceListModel::_sizeComputed(const QString &path, qint64 size, int nbFiles)
+{
+    int row = _rows.value(path, -1);
+    if (row < 0) // removed meanwhile
+        return;
+
+    Source &source = _sources[row];
+    source.size    = size;
+    source.nbFiles = nbFiles;
+    emit dataChanged(index(row), index(row), {Qt::DisplayRole});
+}
+
+void SourceListModel::_reindex()
+{
+    _rows.clear();
+    _rows.reserve(_sources.size());
+    for (int row = 0 ; row < _sources.size() ; ++row)
+        _rows.insert(_sources.at(row).path, row);
+}
@@ -0,0 +1,90 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#ifndef SOURCELISTMODEL_H
+#define SOURCELISTMODEL_H
+#include <QAbstractListModel>
+#include <QDateTime>
+#include <QHash>
+#include <QIcon>
+#include <QThreadPool>
+#include <QVector>
+
+//! source folders of the GUI with their priority, deadline and size
+//! The duplicates are found with a hash index and the sizes are computed in the background only for
+//! the rows the view displays, so it stays responsive with hundreds of thousands of them
+class SourceListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Role {PathRole = Qt::UserRole, PriorityRole, DeadlineRole};
+
+private:
+    struct Source
+    {
+        QString   path;
+        bool      isDir;
+        int       priority;  //!< the higher the sooner
+        QDateTime deadline;
+        qint64    size;      //!< -1 until it is computed
+        int       nbFiles;
+        mutable bool sizing; //!< computation requested
+    };
+
+    QVector<Source>      _sources;
+    QHash<QString, int>  _rows;     //!< row of each path
+    mutable QThreadPool  _sizePool;
+    const QIcon          _fileIcon;
+    const QIcon          _folderIcon;
+
+public:
+    explicit SourceListModel(QObject *parent = nullptr);
+    ~SourceListModel() override; //!< waits for the sizes being computed
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    inline bool contains(const QString &path) const;
+    int  addPaths(const QStringList &paths, bool isDir); //!< skips the ones already there, returns the number added
+    void removeSourceRows(QList<int> rows);
+    void clear();
+
+    inline QString   path(int row)     const;
+    inline int       priority(int row) const;
+    inline QDateTime deadline(int row) const;
+    void setPriority(int row, int priority, const QDateTime &deadline);
+
+private:
+    void _requestSize(int row) const;
+    void _sizeComputed(const QString &path, qint64 size, int nbFiles);
+    void _reindex();
+
+    static constexpr int    sMaxRemovedRanges = 64; //!< above, the model is rebuilt in one go
+    static constexpr qint64 sMB = 1024 * 1024;
+};
+
+bool      SourceListModel::contains(const QString &path) const { return _rows.contains(path); }
+QString   SourceListModel::path(int row)     const { return _sources.at(row).path; }
+int       SourceListModel::priority(int row) const { return _sources.at(row).priority; }
+QDateTime SourceListModel::deadline(int row) const { return _sources.at(row).deadline; }
+
+#endif // SOURCELISTMODEL_H
@@ -0,0 +1,215 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ThroughputModel.h"
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+
+ThroughputModel::ThroughputModel(const QString &path):
+    _path(path), _samples(), _nbLines(0), _fits()
+{
+    for (int level = 0 ; level < 6 ; ++level)
+        _fits[level] = LevelFit{0, 0., 0., 1., 1.};
+}
+
+void ThroughputModel::load()
+{
+    _samples.clear();
+    _nbLines = 0;
+    QFile file(_path);
+    if (file.open(QIODevice::ReadOnly|QIODevice::Text))
+    {
+        QTextStream stream(&file);
+        while (!stream.atEnd())
+        {
+            ThroughputSample sample;
+            if (_parse(stream.readLine(), sample))
+            {
+                _samples << sample;
+                ++_nbLines;
+            }
+        }
+        if (_samples.size() > sMaxSamples)
+            _samples.remove(0, _samples.size() - sMaxSamples);
+    }
+
+    for (int level = 0 ; level < 6 ; ++level)
+        _fit(level);
+}
+
+void ThroughputModel::record(const ThroughputSample &sample)
+{
+    if (sample.inputSize < sMinInputSize || sample.wallMs <= 0)
+        return;
+
+    _samples << sample;
+    if (_samples.size() > sMaxSamples)
+        _samples.removeFirst();
+    _fit(sample.level);
+
+    if (_nbLines >= 2 * sMaxSamples)
+        _rewrite();
+    else
+    {
+        QFile file(_path);
+        bool isNew = !file.exists();
+        if (file.open(QIODevice::WriteOnly|QIODevice::Append|QIODevice::Text))
+        {
+            QTextStream stream(&file);
+            if (isNew)
+                stream << sHeader << "\n";
+            stream << _line(sample) << "\n";
+            ++_nbLines;
+        }
+    }
+}
+
+double ThroughputModel::throughput(int level, int nbProcs, int recoveryPct) const
+{
+    if (!hasModel(level))
+        return 0.;
+
+    const LevelFit &fit = _fits[_levelIdx(level)];
+    double secPerByte = (fit.a + fit.b * std::max(0, nbProcs - 1)) * (1. + recoveryPct / 100.);
+    return secPerByte > 0 ? 1. / secPerByte : 0.;
+}
+
+double ThroughputModel::ratio(int level) const
+{
+    return hasModel(level) ? _fits[_levelIdx(level)].ratio : -1.;
+}
+
+double ThroughputModel::cpuLoad(int level) const
+{
+    return hasModel(level) ? _fits[_levelIdx(level)].cpuLoad : 1.;
+}
+
+int ThroughputModel::bestProcessCount(int level, int maxProcs) const
+{
+    if (!hasModel(level))
+        return 0;
+
+    // no point having more processes than the cpus can run
+    const LevelFit &fit = _fits[_levelIdx(level)];
+    if (fit.cpuLoad > 0)
+        maxProcs = std::min(maxProcs, static_cast<int>(std::ceil(QThread::idealThreadCount() / fit.cpuLoad)));
+
+    int nbProcs = 1;
+    while (nbProcs < maxProcs
+           && (nbProcs + 1) * throughput(level, nbProcs + 1) >= sMinMarginalGain * nbProcs * throughput(level, nbProcs))
+        ++nbProcs;
+    return nbProcs;
+}
+
+void ThroughputModel::_fit(int level)
+{
+    int idx = _levelIdx(level);
+    LevelFit &fit = _fits[idx];
+    fit = LevelFit{0, 0., 0., 1., 1.};
+
+    // weighted sums for the regression of the sec per byte on the number of other processes
+    double sw = 0., sx = 0., sy = 0., sxx = 0., sxy = 0., sIn = 0., sOut = 0., sCpu = 0., sWall = 0.;
+    double weight = 1.;
+    for (int i = _samples.size() - 1 ; i >= 0 ; --i)
+    {
+        const ThroughputSample &sample = _samples.at(i);
+        if (_levelIdx(sample.level) != idx)
+            continue;
+
+        double in = static_cast<double>(sample.inputSize);
+        double x  = std::max(0, sample.nbProcs - 1);
+        double y  = sample.wallMs / 1000. / (in * (1. + sample.recoveryPct / 100.));
+        sw   += weight;
+        sx   += weight * x;
+        sy   += weight * y;
+        sxx  += weight * x * x;
+        sxy  += weight * x * y;
+        sIn  += weight * in;
+        sOut += weight * static_cast<double>(sample.outputSize);
+        if (sample.cpuMs >= 0)
+        {
+            sCpu  += weight * sample.cpuMs;
+            sWall += weight * sample.wallMs;
+        }
+        ++fit.nbSamples;
+        weight *= sDecay;
+    }
+    if (fit.nbSamples == 0)
+        return;
+
+    double meanX = sx / sw, meanY = sy / sw;
+    double varX  = sxx / sw - meanX * meanX;
+    if (varX > 1e-6)
+        fit.b = std::max(0., (sxy / sw - meanX * meanY) / varX); // more processes can't make one faster
+    fit.a = meanY - fit.b * meanX;
+    if (fit.a <= 0) // the runs don't follow the model, fall back on the mean
+    {
+        fit.b = 0.;
+        fit.a = meanY;
+    }
+    fit.ratio = sOut / sIn;
+    if (sWall > 0)
+        fit.cpuLoad = sCpu / sWall;
+}
+
+void ThroughputModel::_rewrite()
+{
+    QFile file(_path);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate|QIODevice::Text))
+        return;
+
+    QTextStream stream(&file);
+    stream << sHeader << "\n";
+    for (const ThroughputSample &sample : _samples)
+        stream << _line(sample) << "\n";
+    _nbLines = _samples.size();
+}
+
+bool ThroughputModel::_parse(const QString &line, ThroughputSample &sample)
+{
+    QStringList fields = line.split(';');
+    if (fields.size() != 9)
+        return false;
+
+    bool ok = true, allOk = true;
+    auto toLong = [&ok, &allOk](const QString &str){ qint64 val = str.toLongLong(&ok); allOk &= ok; return val; };
+    sample.date        = toLong(fields.at(0));
+    sample.level       = static_cast<int>(toLong(fields.at(1)));
+    sample.recoveryPct = static_cast<int>(toLong(fields.at(2)));
+    sample.splitSize   = static_cast<int>(toLong(fields.at(3)));
+    sample.nbProcs     = static_cast<int>(toLong(fields.at(4)));
+    sample.inputSize   = toLong(fields.at(5));
+    sample.outputSize  = toLong(fields.at(6));
+    sample.wallMs      = toLong(fields.at(7));
+    sample.cpuMs       = toLong(fields.at(8));
+    return allOk && sample.inputSize > 0 && sample.wallMs > 0 && sample.nbProcs > 0; // the header fails
+}
+
+QString ThroughputModel::_line(const ThroughputSample &sample)
+{
+    return QString("%1;%2;%3;%4;%5;%6;%7;%8;%9").arg(
+                sample.date).arg(sample.level).arg(sample.recoveryPct).arg(sample.splitSize).arg(
+                sample.nbProcs).arg(sample.inputSize).arg(sample.outputSize).arg(sample.wallMs).arg(sample.cpuMs);
+}
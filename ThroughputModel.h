@@ -0,0 +1,101 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef THROUGHPUTMODEL_H
+#define THROUGHPUTMODEL_H
+#include <QString>
+#include <QVector>
+
+//! measures of a rar run that went well
+struct ThroughputSample
+{
+    qint64 date;        //!< sec since epoch
+    int    level;       //!< compression level
+    int    recoveryPct; //!< 0: no recovery record
+    int    splitSize;   //!< MB, 0: not split
+    int    nbProcs;     //!< rar processes running when it started (itself included)
+    qint64 inputSize;
+    qint64 outputSize;
+    qint64 wallMs;
+    qint64 cpuMs;       //!< -1 if unknown (approximation: cf ExtProcess::_onFinished)
+};
+
+//! history of the rar runs of the host (one csv line each) and the cost model fitted on it.
+//! For each compression level, the time a process needs per input byte grows linearly
+//! with the number of processes sharing the machine: spb(n) = a + b * (n-1)
+//! (weighted least squares, the recent runs count more).
+//! The recovery records are taken into account as extra input.
+//! The cpu time of a run can include some of another child ending at the same time, so the
+//! cpu load is only fitted on the sums over the runs of a level, where these errors mostly cancel.
+class ThroughputModel
+{
+private:
+    struct LevelFit
+    {
+        int    nbSamples;
+        double a;          //!< sec per byte of a process alone
+        double b;          //!< extra sec per byte for each other process
+        double ratio;      //!< output/input
+        double cpuLoad;    //!< cpu time / wall time of a process (rar is multithreaded)
+    };
+
+    const QString            _path;
+    QVector<ThroughputSample> _samples;  //!< oldest first
+    int                      _nbLines;  //!< in the file
+    LevelFit                 _fits[6];
+
+public:
+    explicit ThroughputModel(const QString &path);
+
+    void load();
+    void record(const ThroughputSample &sample);
+
+    inline bool hasModel(int level) const;
+    double throughput(int level, int nbProcs, int recoveryPct = 0) const; //!< bytes per sec of one process, 0 without model
+    double ratio(int level) const; //!< -1 without model
+    double cpuLoad(int level) const; //!< cpu time / wall time of a process, 1 without model
+
+    //! the number of processes after which adding one doesn't bring much, 0 without model
+    int bestProcessCount(int level, int maxProcs) const;
+
+    inline int nbSamples() const;
+
+private:
+    void _fit(int level);
+    void _rewrite();
+
+    static bool _parse(const QString &line, ThroughputSample &sample);
+    static QString _line(const ThroughputSample &sample);
+    static inline int _levelIdx(int level);
+
+    static constexpr const char *sHeader = "date;level;recovery;split;procs;input;output;wall_ms;cpu_ms";
+    static constexpr int    sMaxSamples      = 500;   //!< the file is rewritten with the last ones when it reaches twice that
+    static constexpr int    sMinSamples      = 3;     //!< for a level to have a model
+    static constexpr qint64 sMinInputSize    = 1024 * 1024; //!< smaller runs are mainly rar's startup
+    static constexpr double sDecay           = 0.98;  //!< weight of a run compared to the next one
+    static constexpr double sMinMarginalGain = 1.05;  //!< for bestProcessCount
+};
+
+bool ThroughputModel::hasModel(int level) const { return _fits[_levelIdx(level)].nbSamples >= sMinSamples; }
+int  ThroughputModel::nbSamples() const { return _samples.size(); }
+int  ThroughputModel::_levelIdx(int level) { return level < 0 ? 0 : (level > 5 ? 5 : level); }
+
+#endif // THROUGHPUTMODEL_H
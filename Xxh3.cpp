@@ -0,0 +1,286 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "Xxh3.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+constexpr quint64 PRIME32_1 = 0x9E3779B1U;
+constexpr quint64 PRIME32_2 = 0x85EBCA77U;
+constexpr quint64 PRIME32_3 = 0xC2B2AE3DU;
+constexpr quint64 PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr quint64 PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr quint64 PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr quint64 PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr quint64 PRIME64_5 = 0x27D4EB2F165667C5ULL;
+constexpr quint64 PRIME_MX1 = 0x165667919E3779F9ULL;
+constexpr quint64 PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+constexpr int MIDSIZE_STARTOFFSET  = 3;
+constexpr int MIDSIZE_LASTOFFSET   = 17;
+constexpr int SECRET_SIZE_MIN      = 136;
+constexpr int SECRET_LASTACC_START = 7;
+constexpr int SECRET_MERGEACCS_START = 11;
+
+inline quint64 rotl64(quint64 x, int r) { return (x << r) | (x >> (64 - r)); }
+inline quint64 swap64(quint64 x)
+{
+    return ((x << 56) & 0xff00000000000000ULL) | ((x << 40) & 0x00ff000000000000ULL)
+         | ((x << 24) & 0x0000ff0000000000ULL) | ((x << 8)  & 0x000000ff00000000ULL)
+         | ((x >> 8)  & 0x00000000ff000000ULL) | ((x >> 24) & 0x0000000000ff0000ULL)
+         | ((x >> 40) & 0x000000000000ff00ULL) | ((x >> 56) & 0x00000000000000ffULL);
+}
+} // namespace
+
+Xxh3::Xxh3()
+{
+    reset();
+}
+
+void Xxh3::reset()
+{
+    const quint64 init[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+    std::memcpy(_acc, init, sizeof(_acc));
+    _totalLen   = 0;
+    _nbStripes  = 0;
+    _stripeSize = 0;
+}
+
+void Xxh3::update(const char *data, qint64 len)
+{
+    const uchar *in = reinterpret_cast<const uchar *>(data);
+    size_t remaining = static_cast<size_t>(std::max<qint64>(0, len));
+    if (_totalLen < sMaxShortLen)
+    {
+        size_t nbHead = std::min(remaining, static_cast<size_t>(sMaxShortLen - _totalLen));
+        std::memcpy(_head + _totalLen, in, nbHead);
+    }
+    _totalLen += remaining;
+
+    // a stripe is only consumed when some data follows it: the last byte always goes in the last stripe
+    while (remaining > 0)
+    {
+        if (_stripeSize == sStripeLen)
+        {
+            _consumeStripe(_stripe);
+            std::memcpy(_lastConsumed, _stripe, sStripeLen);
+            _stripeSize = 0;
+        }
+        if (_stripeSize == 0 && remaining > sStripeLen)
+        {
+            while (remaining > sStripeLen)
+            {
+                _consumeStripe(in);
+                in        += sStripeLen;
+                remaining -= sStripeLen;
+            }
+            std::memcpy(_lastConsumed, in - sStripeLen, sStripeLen);
+        }
+        size_t nb = std::min(remaining, static_cast<size_t>(sStripeLen - _stripeSize));
+        std::memcpy(_stripe + _stripeSize, in, nb);
+        _stripeSize += static_cast<int>(nb);
+        in          += nb;
+        remaining   -= nb;
+    }
+}
+
+quint64 Xxh3::digest() const
+{
+    if (_totalLen <= sMaxShortLen)
+        return _hashShort(_head, static_cast<size_t>(_totalLen));
+
+    quint64 acc[8];
+    std::memcpy(acc, _acc, sizeof(acc));
+    uchar lastStripe[64];
+    std::memcpy(lastStripe, _lastConsumed + _stripeSize, static_cast<size_t>(sStripeLen - _stripeSize));
+    std::memcpy(lastStripe + sStripeLen - _stripeSize, _stripe, static_cast<size_t>(_stripeSize));
+    _accumulate(acc, lastStripe, sSecret + sSecretSize - sStripeLen - SECRET_LASTACC_START);
+
+    // merge the accumulators
+    quint64 result = _totalLen * PRIME64_1;
+    const uchar *secret = sSecret + SECRET_MERGEACCS_START;
+    for (int i = 0 ; i < 4 ; ++i)
+        result += _mul128Fold64(acc[2*i] ^ _read64(secret + 16*i), acc[2*i+1] ^ _read64(secret + 16*i + 8));
+    return _avalanche(result);
+}
+
+quint64 Xxh3::hash(const char *data, qint64 len)
+{
+    Xxh3 xxh3;
+    xxh3.update(data, len);
+    return xxh3.digest();
+}
+
+void Xxh3::_consumeStripe(const uchar *stripe)
+{
+    _accumulate(_acc, stripe, sSecret + 8 * _nbStripes);
+    if (++_nbStripes == sStripesPerBlock)
+    {
+        _scramble(_acc, sSecret + sSecretSize - sStripeLen);
+        _nbStripes = 0;
+    }
+}
+
+quint64 Xxh3::_hashShort(const uchar *data, size_t len)
+{
+    const uchar *secret = sSecret;
+    if (len == 0)
+        return _xxh64Avalanche(_read64(secret + 56) ^ _read64(secret + 64));
+    else if (len <= 3)
+    {
+        quint32 combined = (static_cast<quint32>(data[0]) << 16) | (static_cast<quint32>(data[len >> 1]) << 24)
+                | static_cast<quint32>(data[len - 1]) | (static_cast<quint32>(len) << 8);
+        quint64 bitflip = _read32(secret) ^ _read32(secret + 4);
+        return _xxh64Avalanche(combined ^ bitflip);
+    }
+    else if (len <= 8)
+    {
+        quint64 bitflip = _read64(secret + 8) ^ _read64(secret + 16);
+        quint64 input64 = _read32(data + len - 4) + (static_cast<quint64>(_read32(data)) << 32);
+        return _rrmxmx(input64 ^ bitflip, len);
+    }
+    else if (len <= 16)
+    {
+        quint64 inputLo = _read64(data) ^ (_read64(secret + 24) ^ _read64(secret + 32));
+        quint64 inputHi = _read64(data + len - 8) ^ (_read64(secret + 40) ^ _read64(secret + 48));
+        return _avalanche(len + swap64(inputLo) + inputHi + _mul128Fold64(inputLo, inputHi));
+    }
+    else if (len <= 128)
+    {
+        quint64 acc = len * PRIME64_1;
+        if (len > 32)
+        {
+            if (len > 64)
+            {
+                if (len > 96)
+                {
+                    acc += _mix16B(data + 48, secret + 96);
+                    acc += _mix16B(data + len - 64, secret + 112);
+                }
+                acc += _mix16B(data + 32, secret + 64);
+                acc += _mix16B(data + len - 48, secret + 80);
+            }
+            acc += _mix16B(data + 16, secret + 32);
+            acc += _mix16B(data + len - 32, secret + 48);
+        }
+        acc += _mix16B(data, secret);
+        acc += _mix16B(data + len - 16, secret + 16);
+        return _avalanche(acc);
+    }
+    else
+    {
+        quint64 acc = len * PRIME64_1;
+        size_t nbRounds = len / 16;
+        for (size_t i = 0 ; i < 8 ; ++i)
+            acc += _mix16B(data + 16*i, secret + 16*i);
+        acc = _avalanche(acc);
+        for (size_t i = 8 ; i < nbRounds ; ++i)
+            acc += _mix16B(data + 16*i, secret + 16*(i-8) + MIDSIZE_STARTOFFSET);
+        acc += _mix16B(data + len - 16, secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET);
+        return _avalanche(acc);
+    }
+}
+
+void Xxh3::_accumulate(quint64 *acc, const uchar *stripe, const uchar *secret)
+{
+    for (int i = 0 ; i < 8 ; ++i)
+    {
+        quint64 dataVal = _read64(stripe + 8*i);
+        quint64 dataKey = dataVal ^ _read64(secret + 8*i);
+        acc[i ^ 1] += dataVal;
+        acc[i]     += (dataKey & 0xFFFFFFFFULL) * (dataKey >> 32);
+    }
+}
+
+void Xxh3::_scramble(quint64 *acc, const uchar *secret)
+{
+    for (int i = 0 ; i < 8 ; ++i)
+    {
+        quint64 acc64 = acc[i];
+        acc64 ^= acc64 >> 47;
+        acc64 ^= _read64(secret + 8*i);
+        acc[i] = acc64 * PRIME32_1;
+    }
+}
+
+quint64 Xxh3::_mix16B(const uchar *data, const uchar *secret)
+{
+    return _mul128Fold64(_read64(data) ^ _read64(secret), _read64(data + 8) ^ _read64(secret + 8));
+}
+
+quint64 Xxh3::_mul128Fold64(quint64 lhs, quint64 rhs)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+    return static_cast<quint64>(product) ^ static_cast<quint64>(product >> 64);
+#else
+    quint64 loLo  = (lhs & 0xFFFFFFFFULL) * (rhs & 0xFFFFFFFFULL);
+    quint64 hiLo  = (lhs >> 32) * (rhs & 0xFFFFFFFFULL);
+    quint64 loHi  = (lhs & 0xFFFFFFFFULL) * (rhs >> 32);
+    quint64 hiHi  = (lhs >> 32) * (rhs >> 32);
+    quint64 cross = (loLo >> 32) + (hiLo & 0xFFFFFFFFULL) + loHi;
+    quint64 upper = (hiLo >> 32) + (cross >> 32) + hiHi;
+    quint64 lower = (cross << 32) | (loLo & 0xFFFFFFFFULL);
+    return lower ^ upper;
+#endif
+}
+
+quint64 Xxh3::_avalanche(quint64 h)
+{
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    return h ^ (h >> 32);
+}
+
+quint64 Xxh3::_xxh64Avalanche(quint64 h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+quint64 Xxh3::_rrmxmx(quint64 h, quint64 len)
+{
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+const uchar Xxh3::sSecret[sSecretSize] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e
+};
@@ -0,0 +1,84 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef XXH3_H
+#define XXH3_H
+#include <QtGlobal>
+
+//! streaming XXH3 64 bits (seed 0, default secret), same digests than the reference xxhash
+//! scalar implementation, rewritten here to avoid a dependency for a single hash
+class Xxh3
+{
+private:
+    quint64 _acc[8];
+    quint64 _totalLen;
+    int     _nbStripes;       //!< consumed in the current block
+    uchar   _stripe[64];      //!< pending, only consumed once we know more data follows
+    int     _stripeSize;
+    uchar   _lastConsumed[64]; //!< to build the last stripe when the pending one is partial
+    uchar   _head[240];       //!< the short inputs have their own algorithms
+
+public:
+    Xxh3();
+
+    void reset();
+    void update(const char *data, qint64 len);
+    quint64 digest() const;
+
+    static quint64 hash(const char *data, qint64 len);
+
+private:
+    void _consumeStripe(const uchar *stripe);
+
+    static quint64 _hashShort(const uchar *data, size_t len);
+    static void    _accumulate(quint64 *acc, const uchar *stripe, const uchar *secret);
+    static void    _scramble(quint64 *acc, const uchar *secret);
+    static quint64 _mix16B(const uchar *data, const uchar *secret);
+    static quint64 _mul128Fold64(quint64 lhs, quint64 rhs);
+    static quint64 _avalanche(quint64 h);
+    static quint64 _xxh64Avalanche(quint64 h);
+    static quint64 _rrmxmx(quint64 h, quint64 len);
+    static inline quint64 _read64(const uchar *ptr);
+    static inline quint32 _read32(const uchar *ptr);
+
+    static constexpr int sStripeLen     = 64;
+    static constexpr int sSecretSize    = 192;
+    static constexpr int sStripesPerBlock = (sSecretSize - sStripeLen) / 8;
+    static constexpr int sMaxShortLen   = 240;
+
+    static const uchar sSecret[sSecretSize];
+};
+
+quint64 Xxh3::_read64(const uchar *ptr)
+{
+    return  static_cast<quint64>(ptr[0])        | (static_cast<quint64>(ptr[1]) << 8)
+         | (static_cast<quint64>(ptr[2]) << 16) | (static_cast<quint64>(ptr[3]) << 24)
+         | (static_cast<quint64>(ptr[4]) << 32) | (static_cast<quint64>(ptr[5]) << 40)
+         | (static_cast<quint64>(ptr[6]) << 48) | (static_cast<quint64>(ptr[7]) << 56);
+}
+
+quint32 Xxh3::_read32(const uchar *ptr)
+{
+    return  static_cast<quint32>(ptr[0])        | (static_cast<quint32>(ptr[1]) << 8)
+         | (static_cast<quint32>(ptr[2]) << 16) | (static_cast<quint32>(ptr[3]) << 24);
+}
+
+#endif // XXH3_H
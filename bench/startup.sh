@@ -0,0 +1,27 @@
+#!/bin/bash
+# Cold start of scenePacker in command line: average wall time of the invocations
+# that stop right after the parsing (no settings, no logs folder, no GUI).
+#
+# usage: bench/startup.sh [nb_runs] [binaries...]
+#   ex: bench/startup.sh 200 ./scenePacker ./scenePackerCli
+
+NB_RUNS=${1:-100}
+shift
+BINARIES=${@:-./scenePacker}
+
+run_ms() {
+    local start end
+    start=$(date +%s%N)
+    for ((i = 0 ; i < NB_RUNS ; ++i)); do
+        "$@" > /dev/null 2>&1
+    done
+    end=$(date +%s%N)
+    awk -v ns=$((end - start)) -v nb=$NB_RUNS 'BEGIN { printf "%.2f", ns / 1000000 / nb }'
+}
+
+for bin in $BINARIES; do
+    echo "$bin ($NB_RUNS runs):"
+    echo "  --version      : $(run_ms "$bin" --version) ms"
+    echo "  syntax error   : $(run_ms "$bin" --notAnOption) ms"
+    echo "  missing output : $(run_ms "$bin" -i /tmp) ms"
+done
@@ -27,6 +27,7 @@
 #if defined( Q_OS_WIN )
 #include <windows.h>
 #endif
+#if !defined(Q_OS_UNIX)
 void handleShutdown(int signal)
 {
     Q_UNUSED(signal)
@@ -34,12 +35,15 @@ void handleShutdown(int signal)
     std::cout.flush();
     qApp->quit();
 }
+#endif
 
 
 int main(int argc, char *argv[])
 {
+#if !defined(Q_OS_UNIX) // ScenePacker handles them through a pipe on Unix
     signal(SIGINT,  &handleShutdown);// shut down on ctrl-c
     signal(SIGTERM, &handleShutdown);// shut down on killall
+#endif
 
 //    qDebug() << "argc: " << argc;
     ScenePacker app(argc, argv);
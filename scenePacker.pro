@@ -1,8 +1,17 @@
-QT += core gui
+QT += core network
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+# core only build for the scripts: qmake CONFIG+=cli
+# (no GUI libraries to load, so a faster start)
+cli {
+    DEFINES += __CLI_ONLY__
+    TARGET = scenePackerCli
+}
+else {
+    QT += gui
+    greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+    TARGET = scenePacker
+}
 
-TARGET = scenePacker
 TEMPLATE = app
 
 CONFIG += c++14
@@ -37,34 +46,79 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-    About.cpp \
+    BackgroundScanner.cpp \
     CmdOrGuiApp.cpp \
-    CompressionSettings.cpp \
+    Coordinator.cpp \
     Crc32.cpp \
+    DirScanner.cpp \
+    EventLog.cpp \
+    ExtProcess.cpp \
+    FileHasher.cpp \
+    JobServer.cpp \
+    MetricsServer.cpp \
+    NumaTopology.cpp \
+    PackQueue.cpp \
+    RandomGenerator.cpp \
+    RarFailure.cpp \
+    RarStoreWriter.cpp \
+    RunPlanner.cpp \
     ScenePacker.cpp \
-    SignedListWidget.cpp \
-    main.cpp \
-    MainWindow.cpp
+    ThroughputModel.cpp \
+    Xxh3.cpp \
+    main.cpp
 
 HEADERS += \
-    About.h \
+    BackgroundScanner.h \
     CmdOrGuiApp.h \
-    CompressionSettings.h \
+    Coordinator.h \
     Crc32.h \
+    DirScanner.h \
+    EventLog.h \
+    ExtProcess.h \
+    FileHasher.h \
+    JobServer.h \
+    MetricsServer.h \
+    MpmcQueue.h \
+    NumaTopology.h \
+    PackEntry.h \
+    PackJob.h \
+    PackQueue.h \
     PureStaticClass.h \
+    RandomGenerator.h \
+    RarFailure.h \
+    RarStoreWriter.h \
+    RunPlanner.h \
     ScenePacker.h \
-    MainWindow.h \
-    SignedListWidget.h
+    ThroughputModel.h \
+    Xxh3.h
+
+!cli {
+    SOURCES += \
+        About.cpp \
+        CompressionSettings.cpp \
+        MainWindow.cpp \
+        PackStatusModel.cpp \
+        SignedListWidget.cpp \
+        SourceListModel.cpp
 
-FORMS += \
-    About.ui \
-    CompressionSettings.ui \
-    MainWindow.ui
+    HEADERS += \
+        About.h \
+        CompressionSettings.h \
+        MainWindow.h \
+        PackStatusModel.h \
+        SignedListWidget.h \
+        SourceListModel.h
+
+    FORMS += \
+        About.ui \
+        CompressionSettings.ui \
+        MainWindow.ui
+
+    RESOURCES += \
+        resources.qrc
+}
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
-
-RESOURCES += \
-    resources.qrc
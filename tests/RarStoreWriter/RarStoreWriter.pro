@@ -0,0 +1,26 @@
+# round trip of RarStoreWriter against real RAR5 readers (libarchive, and unrar when installed)
+QT += core testlib
+QT -= gui
+
+TARGET = tst_RarStoreWriter
+TEMPLATE = app
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+LIBS += -larchive
+
+SOURCES += \
+    tst_RarStoreWriter.cpp \
+    ../../Crc32.cpp \
+    ../../FileHasher.cpp \
+    ../../RarStoreWriter.cpp \
+    ../../Xxh3.cpp
+
+HEADERS += \
+    ../../Crc32.h \
+    ../../FileHasher.h \
+    ../../PureStaticClass.h \
+    ../../RarFailure.h \
+    ../../RarStoreWriter.h \
+    ../../Xxh3.h
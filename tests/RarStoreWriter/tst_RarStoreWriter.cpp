@@ -0,0 +1,128 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of scenePacker : https://github.com/mbruel/scenePacker
+//
+// scenePacker is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+
+#include "RarStoreWriter.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <archive.h>
+#include <archive_entry.h>
+
+//! stores files of several sizes and reads them back with libarchive (and unrar if it is there)
+class TestRarStoreWriter : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir _dir;
+
+    QString _createFile(const QString &name, int size);
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void unrarTest();
+};
+
+QString TestRarStoreWriter::_createFile(const QString &name, int size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0 ; i < size ; ++i)
+        data[i] = static_cast<char>((i * 31 + i / 4099) & 0xFF);
+
+    QString path = _dir.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != size)
+        return QString();
+    return path;
+}
+
+void TestRarStoreWriter::roundTrip_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::newRow("empty")      << 0;
+    QTest::newRow("one byte")   << 1;
+    QTest::newRow("block - 1")  << 4095;
+    QTest::newRow("block")      << 4096;
+    QTest::newRow("5 MB")       << 5 * 1024 * 1024 + 17;
+}
+
+void TestRarStoreWriter::roundTrip()
+{
+    QFETCH(int, size);
+    QVERIFY(_dir.isValid());
+
+    QString srcPath = _createFile(QString("file_%1.bin").arg(size), size);
+    QVERIFY(!srcPath.isEmpty());
+    QString archivePath = QString("%1.rar").arg(srcPath);
+    QString err;
+    QVERIFY2(RarStoreWriter::store(srcPath, archivePath, err) == RarFailure::Kind::None, qPrintable(err));
+
+    struct archive *reader = archive_read_new();
+    archive_read_support_format_rar5(reader);
+    QCOMPARE(archive_read_open_filename(reader, QFile::encodeName(archivePath).constData(), 10240), ARCHIVE_OK);
+
+    struct archive_entry *entry = nullptr;
+    int res = archive_read_next_header(reader, &entry);
+    QVERIFY2(res == ARCHIVE_OK, archive_error_string(reader));
+    QCOMPARE(QString::fromUtf8(archive_entry_pathname(entry)), QFileInfo(srcPath).fileName());
+    QCOMPARE(archive_entry_size(entry), static_cast<la_int64_t>(size));
+    QCOMPARE(static_cast<qint64>(archive_entry_mtime(entry)), QFileInfo(srcPath).lastModified().toSecsSinceEpoch());
+
+    QByteArray data, buffer(1024 * 1024, Qt::Uninitialized);
+    la_ssize_t nb = 0;
+    while ((nb = archive_read_data(reader, buffer.data(), static_cast<size_t>(buffer.size()))) > 0)
+        data.append(buffer.constData(), static_cast<int>(nb));
+    QVERIFY2(nb == 0, archive_error_string(reader)); // the CRC32 is checked at the end of the data
+
+    QFile src(srcPath);
+    QVERIFY(src.open(QIODevice::ReadOnly));
+    QVERIFY(data == src.readAll());
+
+    QCOMPARE(archive_read_next_header(reader, &entry), ARCHIVE_EOF);
+    archive_read_free(reader);
+}
+
+void TestRarStoreWriter::unrarTest()
+{
+    QString unrar = QStandardPaths::findExecutable("unrar");
+    if (unrar.isEmpty())
+        unrar = QStandardPaths::findExecutable("rar");
+    if (unrar.isEmpty())
+        QSKIP("neither unrar nor rar in the PATH");
+
+    QString srcPath = _createFile("unrar.bin", 3 * 4096 + 5);
+    QString archivePath = QString("%1.rar").arg(srcPath), err;
+    QVERIFY2(RarStoreWriter::store(srcPath, archivePath, err) == RarFailure::Kind::None, qPrintable(err));
+
+    QProcess proc;
+    proc.start(unrar, {"t", "-idq", archivePath});
+    QVERIFY(proc.waitForFinished());
+    QVERIFY2(proc.exitStatus() == QProcess::NormalExit && proc.exitCode() == 0, proc.readAllStandardError().constData());
+}
+
+QTEST_GUILESS_MAIN(TestRarStoreWriter)
+#include "tst_RarStoreWriter.moc"